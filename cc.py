@@ -1,19 +1,36 @@
 # echo-client.py
 
 import socket
+import struct
 import time
 #import mido
 
 HOST = "192.168.50.229"  # The server's hostname or IP address
 PORT = 7777  # The port used by the server
 
+MSG_RANGE = 0x01
+MSG_SPARSE = 0x02
+
+# Messages are a big endian u16 length, type, output and payload, see
+# main/servertask.h. Each one reaches the output as a single update.
+def message(msg_type, payload, output=0):
+    body = bytes([msg_type, output]) + payload
+    return struct.pack(">H", len(body)) + body
+
+def write_range(s, first, values, output=0):
+    s.sendall(message(MSG_RANGE, struct.pack(">H", first) + bytes(values), output))
+
+def write_sparse(s, pairs, output=0):
+    payload = b"".join(struct.pack(">HB", channel, value) for channel, value in pairs)
+    s.sendall(message(MSG_SPARSE, payload, output))
+
 def ramp_up():
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
         s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
         s.connect((HOST, PORT))
         val = 0
         while val <= 255:
-            s.sendall(bytes([101, val]))
+            write_range(s, 101, [val])
             val += 1
             time.sleep(0.02)
 
@@ -23,7 +40,7 @@ def ramp_down():
         s.connect((HOST, PORT))
         val = 255
         while val >= 0:
-            s.sendall(bytes([101, val]))
+            write_range(s, 101, [val])
             val -= 1
             time.sleep(0.02)
 
@@ -31,7 +48,16 @@ def reset():
     with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
         s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
         s.connect((HOST, PORT))
-        s.sendall(bytes([101, 0]))
+        write_range(s, 101, [0])
+
+# Fades a block of fixtures together, every step is one message
+def ramp_block(first=101, count=24):
+    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        s.connect((HOST, PORT))
+        for val in range(256):
+            write_range(s, first, [val] * count)
+            time.sleep(0.02)
 
 #def midicontrol():
 #    with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
@@ -44,7 +70,7 @@ def reset():
 #                print(msg)
 #                channel = msg.control + 100
 #                value = msg.value * 2 # cc's seem to be between 0 and 127
-#                s.sendall(bytes([channel, value]))
+#                write_sparse(s, [(channel, value)])
 
 #reset()
 #midicontrol()
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+uint64_t bench_iterations(uint64_t default_iterations)
+{
+    const char *env = getenv("BENCH_ITERATIONS");
+    if (env != NULL)
+    {
+        uint64_t iterations = strtoull(env, NULL, 10);
+        if (iterations > 0)
+        {
+            return iterations;
+        }
+    }
+    return default_iterations;
+}
+
+void bench_report(const char *name, size_t bytes, uint64_t iterations, uint64_t elapsed_ns)
+{
+    double ns_per_op = (double)elapsed_ns / iterations;
+    printf("%-32s %5zu B %10.1f ns/op %14.0f op/s\n",
+            name, bytes, ns_per_op, 1e9 / ns_per_op);
+}
+
+void bench_consume(const void *p)
+{
+    static const void *volatile sink;
+    sink = p;
+}
+
+size_t bench_sacn_data(uint8_t *buf, uint16_t universe, uint8_t seq, size_t count)
+{
+    memset(buf, 0, BENCH_SACN_HEADER_LEN);
+    buf[1] = 0x10;              // preamble size
+    memcpy(&buf[4], "ASC-E1.17\0\0\0", 12);
+    buf[21] = 0x04;             // root vector, data
+    memset(&buf[22], 0xa5, 16); // CID
+    buf[43] = 0x02;             // framing vector, data
+    buf[108] = 100;             // priority
+    buf[111] = seq;
+    buf[113] = universe >> 8;
+    buf[114] = universe & 0xff;
+    buf[117] = 0x02;            // DMP set property
+    buf[118] = 0xa1;
+    buf[122] = 0x01;            // address increment
+    buf[123] = (count + 1) >> 8;
+    buf[124] = (count + 1) & 0xff;
+    return BENCH_SACN_HEADER_LEN + count;
+}
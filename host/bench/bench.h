@@ -0,0 +1,38 @@
+// Minimal timing harness shared by the host benchmarks
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Monotonic time in nanoseconds
+uint64_t bench_now_ns(void);
+
+// Iteration count for a case, BENCH_ITERATIONS in the environment overrides
+// the default so CI can do quick runs and soak runs can do long ones
+uint64_t bench_iterations(uint64_t default_iterations);
+
+// Prints one result line: case name, payload size, ns per operation and
+// operations per second
+void bench_report(const char *name, size_t bytes, uint64_t iterations, uint64_t elapsed_ns);
+
+// Keeps the compiler from discarding a computed value
+void bench_consume(const void *p);
+
+// Packets for the benchmarks and tests to feed the node. ArtDmx comes from
+// artcodec_encode_dmx, around slots written at buf[ARTCODEC_DMX_HEADER_LEN].
+// This is the same for E1.31: completes a data packet around count slots
+// the caller wrote at buf[BENCH_SACN_HEADER_LEN], start code 0, priority
+// 100, and returns its length.
+#define BENCH_SACN_HEADER_LEN 126
+size_t bench_sacn_data(uint8_t *buf, uint16_t universe, uint8_t seq, size_t count);
+
+#define BENCH_RUN(name, bytes, iterations, body) do {                   \
+        uint64_t bench_iters_ = (iterations);                           \
+        uint64_t bench_start_ = bench_now_ns();                         \
+        for (uint64_t bench_i_ = 0; bench_i_ < bench_iters_; bench_i_++) \
+        {                                                               \
+            body;                                                       \
+        }                                                               \
+        bench_report((name), (bytes), bench_iters_,                     \
+                bench_now_ns() - bench_start_);                         \
+    } while(0)
@@ -0,0 +1,142 @@
+// Art-Net codec: parsing a packet of every OpCode, ArtDmx against the chain
+// of checks handle_artnet used to do, malformed packets, the encoders and
+// the dispatch through handle_artnet of packets the node only ignores.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "route.h"
+
+// The shortest valid packet of an OpCode, with a count of 0
+static size_t build_op(uint8_t *buf, const artcodec_op_t *op)
+{
+    memset(buf, 0, op->min_len);
+    if (op->flags & ARTCODEC_NO_VERSION)
+    {
+        memcpy(buf, "Art-Net\0", 8);
+        buf[8] = op->opcode & 0xff;
+        buf[9] = op->opcode >> 8;
+    }
+    else
+    {
+        artcodec_encode_header(buf, op->opcode);
+    }
+    return op->min_len;
+}
+
+// The ArtDmx checks as handle_artnet made them before the codec
+__attribute__((noinline))
+static const uint8_t *chain_parse(const uint8_t *buf, size_t len, size_t *count)
+{
+    if (len < 13 || memcmp(buf, "Art-Net\0", 8) != 0)
+    {
+        return NULL;
+    }
+    uint16_t opcode = buf[8] | buf[9] << 8;
+    uint16_t protver = buf[10] << 8 | buf[11];
+    if (protver != 14 || opcode != 0x5000 || len < 18)
+    {
+        return NULL;
+    }
+    size_t datalen = buf[16] << 8 | buf[17];
+    if (datalen != len - 18 || datalen > 512)
+    {
+        return NULL;
+    }
+    *count = datalen;
+    return &buf[18];
+}
+
+int main(void)
+{
+    static uint8_t packets[ARTCODEC_OP_COUNT][ARTCODEC_DMX_HEADER_LEN + ARTCODEC_DMX_MAX];
+    static size_t lens[ARTCODEC_OP_COUNT];
+    static uint8_t dmx[ARTCODEC_DMX_HEADER_LEN + ARTCODEC_DMX_MAX];
+    static uint8_t out[ARTCODEC_DMX_HEADER_LEN + ARTCODEC_DMX_MAX];
+    artcodec_packet_t packet;
+
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+    route_init();
+    artpoll_init();
+
+    for (size_t i = 0; i < ARTCODEC_OP_COUNT; i++)
+    {
+        lens[i] = build_op(packets[i], &artcodec_ops[i]);
+        if (artcodec_parse(packets[i], lens[i], &packet) != ARTCODEC_OK || packet.op->index != i)
+        {
+            printf("Op%s not parsed\n", artcodec_ops[i].name);
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < ARTCODEC_DMX_MAX; i++)
+    {
+        dmx[ARTCODEC_DMX_HEADER_LEN + i] = i * 7;
+    }
+    size_t dmx_len = artcodec_encode_dmx(dmx, 1, 0, 0x0123, ARTCODEC_DMX_MAX);
+    size_t count = 0;
+    if (artcodec_parse(dmx, dmx_len, &packet) != ARTCODEC_OK || packet.count != 512 ||
+            chain_parse(dmx, dmx_len, &count) != packet.dmx->data || count != 512)
+    {
+        printf("ArtDmx parsed differently\n");
+        return 1;
+    }
+
+    uint64_t iterations = bench_iterations(10000000);
+
+    BENCH_RUN("parse/artdmx_chain", dmx_len, iterations,
+            { bench_consume(chain_parse(dmx, dmx_len, &count)); });
+    BENCH_RUN("parse/artdmx", dmx_len, iterations,
+            { bench_consume(&(int){ artcodec_parse(dmx, dmx_len, &packet) }); bench_consume(&packet); });
+    BENCH_RUN("parse/every_opcode", 0, iterations,
+            {
+                size_t i = bench_i_ % ARTCODEC_OP_COUNT;
+                bench_consume(&(int){ artcodec_parse(packets[i], lens[i], &packet) });
+                bench_consume(&packet);
+            });
+
+    // Rejected packets: not Art-Net, another protocol version, a lying count
+    static uint8_t bad[3][ARTCODEC_DMX_HEADER_LEN + ARTCODEC_DMX_MAX];
+    for (int i = 0; i < 3; i++)
+    {
+        memcpy(bad[i], dmx, dmx_len);
+    }
+    bad[0][3] = 'x';
+    bad[1][11] = 13;
+    bad[2][17] ^= 2;
+    BENCH_RUN("parse/rejected", dmx_len, iterations,
+            {
+                bench_consume(&(int){ artcodec_parse(bad[bench_i_ % 3], dmx_len, &packet) });
+                bench_consume(&packet);
+            });
+
+    BENCH_RUN("encode/artdmx_header", dmx_len, iterations,
+            { bench_consume(&(size_t){ artcodec_encode_dmx(out, bench_i_, 0, 0x0123, 512) }); bench_consume(out); });
+    BENCH_RUN("encode/diag", 0, iterations,
+            {
+                bench_consume(&(size_t){ artcodec_encode_diag(out, sizeof(out), ARTCODEC_DP_MED, 0,
+                        "ArtDmx truncated (17)") });
+                bench_consume(out);
+            });
+    BENCH_RUN("encode/tod_data_empty", 0, iterations,
+            {
+                bench_consume(&(size_t){ artcodec_encode_tod_data(out, sizeof(out), 0x0123, 1, 1,
+                        0, 0, NULL, 0) });
+                bench_consume(out);
+            });
+    BENCH_RUN("encode/poll_reply", sizeof(artcodec_poll_reply_t), iterations,
+            { artcodec_encode_poll_reply((artcodec_poll_reply_t *)out, 0x0100000a, 1); bench_consume(out); });
+
+    // Parse and table dispatch of a packet with no handler
+    BENCH_RUN("handle/ignored", lens[ARTCODEC_OP_ADDRESS], iterations,
+            handle_artnet(packets[ARTCODEC_OP_ADDRESS], lens[ARTCODEC_OP_ADDRESS], 0));
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Fade kernel against the obvious byte loop, plus the per frame cost of the
+// fade stage in the output latch. host/test/test_fade checks the results.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "fade.h"
+#include "route.h"
+
+static uint8_t from[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t to[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t out[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+
+// Kept out of line so the compiler cannot vectorise the reference across
+// benchmark iterations
+__attribute__((noinline))
+static void blend_bytes(uint8_t *o, const uint8_t *x, const uint8_t *y, uint16_t weight, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        o[i] = (x[i] * (256 - weight) + y[i] * weight) / 256;
+    }
+}
+
+int main(void)
+{
+    size_t len;
+
+    host_log_level = ESP_LOG_ERROR;
+    srand(1);
+    for (size_t i = 0; i < DMX_FRAME_STRIDE; i++)
+    {
+        from[i] = rand();
+        to[i] = rand();
+    }
+
+    uint64_t iterations = bench_iterations(1000000);
+
+    BENCH_RUN("blend/byte_loop", 513, iterations,
+            { blend_bytes(out, from, to, bench_i_ & 0xff, 513); bench_consume(out); });
+    BENCH_RUN("blend/fade_blend", 513, iterations,
+            { fade_blend(out, from, to, bench_i_ & 0xff, 513); bench_consume(out); });
+
+    // Output 0 fed at 25 fps and latched at 40 fps, time is simulated so
+    // every latch lands mid-fade
+    static uint8_t p1[ARTCODEC_DMX_HEADER_LEN + 512], p2[ARTCODEC_DMX_HEADER_LEN + 512];
+    memset(&p1[ARTCODEC_DMX_HEADER_LEN], 0x00, 512);
+    memset(&p2[ARTCODEC_DMX_HEADER_LEN], 0xff, 512);
+    size_t plen = artcodec_encode_dmx(p1, 0, 0, 0, 512);
+    artcodec_encode_dmx(p2, 0, 0, 0, 512);
+    // The slots with the byte before them standing in for the start code
+    const uint8_t *f1 = &p1[ARTCODEC_DMX_HEADER_LEN - 1];
+    const uint8_t *f2 = &p2[ARTCODEC_DMX_HEADER_LEN - 1];
+
+    dmx_buffer_init();
+    route_init();
+    artpoll_init();
+    fade_set(0, true, 0);
+
+    uint32_t now_us = 0;
+    for (int frame = 0; frame < 8; frame++)
+    {
+        now_us += 40000;
+        fade_apply(0, frame & 1 ? f2 : f1, &(size_t){ 513 }, true, now_us);
+    }
+    now_us += 20000;
+
+    BENCH_RUN("fade_apply/mid_fade", 513, iterations,
+            { len = 513; bench_consume(fade_apply(0, f2, &len, false, now_us + (bench_i_ & 0x3fff))); });
+    now_us += 40000;
+    BENCH_RUN("fade_apply/settled", 513, iterations,
+            { len = 513; bench_consume(fade_apply(0, f2, &len, false, now_us)); });
+    BENCH_RUN("fade_apply/new_frame", 513, iterations,
+            { len = 513; bench_consume(fade_apply(0, bench_i_ & 1 ? f2 : f1, &len, true, now_us + bench_i_ * 25000)); });
+
+    // The whole latch with real time, fading on and off
+    handle_artnet(p1, plen, 0x0100000a);
+    fade_set(0, false, 0);
+    BENCH_RUN("latch/no_fade", 513, iterations, bench_consume(dmx_buffer_latch(0, &len)));
+    fade_set(0, true, 1000);
+    handle_artnet(p2, plen, 0x0100000a);
+    BENCH_RUN("latch/fading", 513, iterations, bench_consume(dmx_buffer_latch(0, &len)));
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Hot path benchmarks: ArtDmx parsing, DMX buffer writes and the buffer swap
+// the output worker does once per frame, for a range of packet sizes.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "route.h"
+#include "rxbatch.h"
+#include "sacn.h"
+
+static const size_t sizes[] = { 2, 24, 128, 512 };
+
+// Slots that differ from packet to packet
+static void fill(uint8_t *slots, uint8_t seq, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        slots[i] = (uint8_t)(i * 7 + seq);
+    }
+}
+
+static size_t build_artdmx(uint8_t *buf, uint16_t universe, uint8_t seq, size_t len)
+{
+    fill(&buf[ARTCODEC_DMX_HEADER_LEN], seq, len);
+    return artcodec_encode_dmx(buf, seq, 0, universe, len);
+}
+
+static size_t build_sacn(uint8_t *buf, uint16_t universe, uint8_t seq, size_t len)
+{
+    fill(&buf[BENCH_SACN_HEADER_LEN], seq, len);
+    return bench_sacn_data(buf, universe, seq, len);
+}
+
+int main(void)
+{
+    static uint8_t packet[18 + 512];
+    char name[64];
+    size_t frame_len;
+
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+    route_init();
+    artpoll_init();
+
+    uint64_t iterations = bench_iterations(1000000);
+
+    // Sequence 0 turns the order check off, so replaying one packet is not
+    // dropped as a duplicate
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        size_t len = build_artdmx(packet, 0, 0, sizes[i]);
+        snprintf(name, sizeof(name), "artdmx_parse+write/%zu", sizes[i]);
+        BENCH_RUN(name, len, iterations, handle_artnet(packet, len, 0));
+    }
+
+    // Sequence numbers advance so every packet passes the order check
+    static uint8_t sacn[256][126 + 512];
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        for (int seq = 0; seq < 256; seq++)
+        {
+            build_sacn(sacn[seq], CONFIG_SACN_UNIVERSE + 1, seq, sizes[i]);
+        }
+        snprintf(name, sizeof(name), "sacn_parse+write/%zu", sizes[i]);
+        BENCH_RUN(name, 126 + sizes[i], iterations,
+                handle_sacn(sacn[bench_i_ & 255], 126 + sizes[i]));
+    }
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        build_artdmx(packet, 0, 1, sizes[i]);
+        snprintf(name, sizeof(name), "dmx_write_multiple/%zu", sizes[i]);
+        BENCH_RUN(name, sizes[i], iterations, dmx_write_multiple(1, &packet[18], sizes[i]));
+    }
+
+    size_t len = build_artdmx(packet, 0, 1, 512);
+    BENCH_RUN("artdmx_sequenced/512", len, iterations, {
+        packet[12] = 1 + bench_i_ % 255;
+        handle_artnet(packet, len, 0);
+    });
+    artnet_seq_stats_t seq_stats;
+    artnet_get_seq_stats(&seq_stats);
+    printf("sequence: %u lost, %u reordered, %u duplicates\n",
+            seq_stats.lost, seq_stats.reordered, seq_stats.duplicates);
+
+    len = build_artdmx(packet, 0x1234, 1, 512);
+    BENCH_RUN("artdmx_unrouted_universe", len, iterations, handle_artnet(packet, len, 0));
+
+    // A 32 universe rig where this node listens to DMX_OUTPUT_COUNT of them
+    static uint8_t rig[32][18 + 512];
+    for (uint16_t u = 0; u < 32; u++)
+    {
+        build_artdmx(rig[u], u, 0, 512);
+    }
+    BENCH_RUN("artdmx_32_universe_rig", 18 + 512, iterations,
+            handle_artnet(rig[bench_i_ & 31], 18 + 512, 0));
+
+    BENCH_RUN("route_lookup", 0, iterations,
+            bench_consume((void *)(uintptr_t)route_lookup((uint16_t)bench_i_)));
+
+    BENCH_RUN("dmx_buffer_latch/idle", 0, iterations,
+            bench_consume(dmx_buffer_latch(0, &frame_len)));
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        build_artdmx(packet, 0, 1, sizes[i]);
+        snprintf(name, sizeof(name), "write+latch/%zu", sizes[i]);
+        BENCH_RUN(name, sizes[i], iterations, {
+            dmx_write_multiple(1, &packet[18], sizes[i]);
+            bench_consume(dmx_buffer_latch(0, &frame_len));
+        });
+    }
+
+    // Synchronous mode: a look spread over four universes latched by ArtSync
+    static uint8_t sync[14];
+    artcodec_encode_header(sync, ARTNET_OP_SYNC);
+    BENCH_RUN("artdmx_x4+artsync", 4 * (18 + 512), iterations / 4, {
+        for (int u = 0; u < 4; u++)
+        {
+            handle_artnet(rig[u], 18 + 512, 0);
+        }
+        handle_artnet(sync, sizeof(sync), 0);
+    });
+
+    // Burst after a Wi-Fi stall: four stale frames for each of four
+    // universes, handled one by one and drained as a coalesced batch. The
+    // copies stand in for recvfrom.
+    BENCH_RUN("burst_16x512/per_packet", 16 * (18 + 512), iterations / 16, {
+        for (int i = 0; i < 16; i++)
+        {
+            memcpy(packet, rig[i & 3], 18 + 512);
+            handle_artnet(packet, 18 + 512, 0);
+        }
+    });
+    BENCH_RUN("burst_16x512/rxbatch", 16 * (18 + 512), iterations / 16, {
+        rxbatch_begin();
+        for (int i = 0; i < 16; i++)
+        {
+            memcpy(rxbatch_slot(), rig[i & 3], 18 + 512);
+            rxbatch_push(RXBATCH_ARTNET, 18 + 512, 0);
+        }
+        rxbatch_end();
+    });
+    rxbatch_stats_t stats;
+    rxbatch_get_stats(&stats);
+    printf("rxbatch: %u datagrams in %u batches, %u coalesced\n",
+            stats.datagrams, stats.batches, stats.coalesced);
+
+    // Answering a poll is only queueing the controller, the reply is cached
+    static uint8_t poll[14];
+    artcodec_encode_header(poll, ARTNET_OP_POLL);
+    BENCH_RUN("artpoll", sizeof(poll), iterations, handle_artnet(poll, sizeof(poll), 0));
+
+    return 0;
+}
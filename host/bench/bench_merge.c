@@ -0,0 +1,113 @@
+// Merge kernels against the obvious byte loops, plus the cost of latching a
+// merged frame and of ingesting ArtDmx from two controllers.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "merge.h"
+#include "route.h"
+
+static uint8_t a[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t b[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t owner[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t out[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t ref[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+
+// Kept out of line so the compiler cannot vectorise the reference across
+// benchmark iterations
+__attribute__((noinline))
+static void htp_bytes(uint8_t *o, const uint8_t *x, const uint8_t *y, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        o[i] = x[i] > y[i] ? x[i] : y[i];
+    }
+}
+
+__attribute__((noinline))
+static void ltp_bytes(uint8_t *o, const uint8_t *x, const uint8_t *y, const uint8_t *sel, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        o[i] = sel[i] ? y[i] : x[i];
+    }
+}
+
+int main(void)
+{
+    size_t len;
+
+    host_log_level = ESP_LOG_ERROR;
+    srand(1);
+    for (size_t i = 0; i < DMX_FRAME_STRIDE; i++)
+    {
+        a[i] = rand();
+        b[i] = rand();
+        owner[i] = rand() & 1 ? 0xff : 0x00;
+    }
+
+    // The word kernels must agree with the byte loops
+    merge_htp(out, a, b, 513);
+    htp_bytes(ref, a, b, 513);
+    if (memcmp(out, ref, 513) != 0)
+    {
+        printf("merge_htp disagrees with the byte loop\n");
+        return 1;
+    }
+    merge_ltp(out, a, b, owner, 513);
+    ltp_bytes(ref, a, b, owner, 513);
+    if (memcmp(out, ref, 513) != 0)
+    {
+        printf("merge_ltp disagrees with the byte loop\n");
+        return 1;
+    }
+
+    uint64_t iterations = bench_iterations(1000000);
+
+    BENCH_RUN("htp/byte_loop", 513, iterations, { htp_bytes(out, a, b, 513); bench_consume(out); });
+    BENCH_RUN("htp/merge_htp", 513, iterations, { merge_htp(out, a, b, 513); bench_consume(out); });
+    BENCH_RUN("ltp/byte_loop", 513, iterations, { ltp_bytes(out, a, b, owner, 513); bench_consume(out); });
+    BENCH_RUN("ltp/merge_ltp", 513, iterations, { merge_ltp(out, a, b, owner, 513); bench_consume(out); });
+    BENCH_RUN("ltp/track_changes", 512, iterations,
+            { merge_track_changes(&owner[1], bench_i_ & 1, &a[1], &b[1], 512); bench_consume(owner); });
+
+    // Two controllers on universe 0, merged when the output latches
+    static uint8_t p1[ARTCODEC_DMX_HEADER_LEN + 512], p2[ARTCODEC_DMX_HEADER_LEN + 512];
+    memset(&p1[ARTCODEC_DMX_HEADER_LEN], 0x40, 512);
+    memset(&p2[ARTCODEC_DMX_HEADER_LEN], 0x80, 512);
+    size_t plen = artcodec_encode_dmx(p1, 0, 0, 0, 512);
+    artcodec_encode_dmx(p2, 0, 0, 0, 512);
+
+    dmx_buffer_init();
+    route_init();
+    artpoll_init();
+
+    handle_artnet(p1, plen, 0x0100000a);
+    BENCH_RUN("latch/single_source", 513, iterations, bench_consume(dmx_buffer_latch(0, &len)));
+
+    handle_artnet(p2, plen, 0x0200000a);
+    BENCH_RUN("latch/htp_two_sources", 513, iterations, bench_consume(dmx_buffer_latch(0, &len)));
+    if (dmx_buffer_latch(0, &len)[1] != 0x80)
+    {
+        printf("two sources were not merged HTP\n");
+        return 1;
+    }
+
+    BENCH_RUN("artdmx_two_controllers", plen, iterations,
+            handle_artnet(bench_i_ & 1 ? p2 : p1, plen, bench_i_ & 1 ? 0x0200000a : 0x0100000a));
+
+    merge_set_mode(0, MERGE_LTP);
+    BENCH_RUN("artdmx_two_controllers_ltp", plen, iterations,
+            handle_artnet(bench_i_ & 1 ? p2 : p1, plen, bench_i_ & 1 ? 0x0200000a : 0x0100000a));
+    BENCH_RUN("latch/ltp_two_sources", 513, iterations, bench_consume(dmx_buffer_latch(0, &len)));
+
+    return 0;
+}
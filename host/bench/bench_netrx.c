@@ -0,0 +1,110 @@
+// Zero-copy receive: a full ArtDmx universe taken from the socket path,
+// where the datagram is first copied out of lwIP's buffer into an rxbatch
+// slot, against the netconn path, where it is parsed where lwIP put it.
+// Also the commit on its own, from the work buffer against a frame that
+// was written straight into the output's back buffer.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "netrx.h"
+#include "route.h"
+#include "rxbatch.h"
+
+static uint8_t packet[18 + 512];
+
+static void build_artdmx(void)
+{
+    for (size_t i = 0; i < 512; i++)
+    {
+        packet[ARTCODEC_DMX_HEADER_LEN + i] = (uint8_t)(i * 7 + 3);
+    }
+    // Unsequenced, replays are not duplicates. Port-Address 0, output 0.
+    artcodec_encode_dmx(packet, 0, 0, 0, 512);
+}
+
+static bool latched_ok(uint8_t output)
+{
+    size_t len;
+    const uint8_t *frame = dmx_buffer_latch(output, &len);
+    return len == 513 && frame[0] == 0 && memcmp(&frame[1], &packet[18], 512) == 0;
+}
+
+// What lwip_recvfrom does underneath: the same netbuf, copied out
+static void socket_path(netrx_t *rx)
+{
+    host_netconn_deliver(rx->conn, packet, sizeof(packet), 0x0100000a);
+    rxbatch_begin();
+    struct netbuf *buf;
+    netconn_recv(rx->conn, &buf);
+    size_t len = netbuf_copy(buf, rxbatch_slot(), RXBATCH_SLOT_LEN);
+    netbuf_delete(buf);
+    rxbatch_push(RXBATCH_ARTNET, len, 0x0100000a);
+    // The drain's last recvfrom, finding the queue empty
+    netconn_recv(rx->conn, &buf);
+    rxbatch_end();
+}
+
+static void netconn_path(netrx_t *rx)
+{
+    host_netconn_deliver(rx->conn, packet, sizeof(packet), 0x0100000a);
+    rxbatch_begin();
+    netrx_drain(rx, 32);
+    rxbatch_end();
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+    route_init();
+    artpoll_init();
+    build_artdmx();
+
+    netrx_t rx;
+    netrx_init(NULL);
+    if (!netrx_open(&rx, 6454, RXBATCH_ARTNET))
+    {
+        printf("netconn not opened\n");
+        return 1;
+    }
+
+    socket_path(&rx);
+    if (!latched_ok(0))
+    {
+        printf("socket path frame wrong\n");
+        return 1;
+    }
+    dmx_output_write(0, 0, 1, (const uint8_t[]){ 0 }, 1);
+    dmx_output_commit(0, 0);
+    netconn_path(&rx);
+    if (!latched_ok(0))
+    {
+        printf("netconn path frame wrong\n");
+        return 1;
+    }
+
+    uint64_t iterations = bench_iterations(1000000);
+
+    // Receive to committed output
+    BENCH_RUN("rx/socket", sizeof(packet), iterations, socket_path(&rx));
+    BENCH_RUN("rx/netconn", sizeof(packet), iterations, netconn_path(&rx));
+
+    // The commit alone, output 2 so it is not merged with the above
+    BENCH_RUN("commit/work_buffer", 513, iterations,
+            { dmx_output_write(2, 0, 1, &packet[18], 512); dmx_output_commit(2, 0); });
+    BENCH_RUN("commit/direct", 513, iterations,
+            { dmx_output_write_frame(2, 0, &packet[18], 512); dmx_output_commit(2, 0); });
+    if (!latched_ok(2))
+    {
+        printf("direct commit frame wrong\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Soft patch: a full 512 slot scrambled patch with mixed curves through the
+// fused gather-and-LUT kernel, against the same patch done as a gather pass
+// followed by a curve pass, and the whole commit with and without a patch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "dmxframe.h"
+#include "dmxtask.h"
+#include "merge.h"
+#include "patch.h"
+
+static uint8_t src[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t out[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t ref[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t tmp[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+
+// The patch as plain tables, for the two pass reference
+static uint16_t ref_channel[513];
+static uint8_t ref_lut[513][256];
+
+__attribute__((noinline))
+static void two_pass(uint8_t *o, const uint8_t *s)
+{
+    for (size_t slot = 1; slot <= 512; slot++)
+    {
+        tmp[slot] = s[ref_channel[slot]];
+    }
+    for (size_t slot = 1; slot <= 512; slot++)
+    {
+        o[slot] = ref_lut[slot][tmp[slot]];
+    }
+    o[0] = 0;
+}
+
+// Scrambles output 0: slots in random order, each through gamma, square
+// law or a 60% limit, with the first 8 slots left empty
+static void build_patch(void)
+{
+    uint8_t limit[256];
+    patch_curve_limit(limit, 153);
+    patch_set_curve(PATCH_CURVE_USER, limit);
+
+    uint8_t curves[3][256];
+    uint8_t linear[256];
+    for (int v = 0; v < 256; v++)
+    {
+        linear[v] = v;
+    }
+    // Read the built in curves back through a one slot patch
+    for (int c = 0; c < 3; c++)
+    {
+        uint8_t curve = c == 2 ? PATCH_CURVE_USER : PATCH_CURVE_GAMMA + c;
+        patch_map(1, 1, 1, 1, curve);
+        for (int v = 0; v < 256; v++)
+        {
+            uint8_t frame[513] = { 0 };
+            frame[1] = v;
+            patch_gather(1, out, frame, 513);
+            curves[c][v] = out[1];
+        }
+    }
+    patch_reset(1);
+
+    uint16_t order[512];
+    for (int i = 0; i < 512; i++)
+    {
+        order[i] = i + 1;
+    }
+    for (int i = 511; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        uint16_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    patch_unmap(0, 1, 8);
+    for (uint16_t slot = 1; slot <= 512; slot++)
+    {
+        if (slot <= 8)
+        {
+            ref_channel[slot] = 0;
+            memcpy(ref_lut[slot], linear, 256);
+            continue;
+        }
+        int c = slot % 3;
+        patch_map(0, slot, order[slot - 1], 1, c == 2 ? PATCH_CURVE_USER : PATCH_CURVE_GAMMA + c);
+        ref_channel[slot] = order[slot - 1];
+        memcpy(ref_lut[slot], curves[c], 256);
+    }
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    srand(1);
+
+    dmx_buffer_init();
+    for (size_t i = 1; i < DMX_FRAME_STRIDE; i++)
+    {
+        src[i] = rand();
+    }
+    build_patch();
+
+    if (!patch_active(0) || patch_active(2))
+    {
+        printf("patch activity wrong\n");
+        return 1;
+    }
+    size_t len = patch_gather(0, out, src, 513);
+    two_pass(ref, src);
+    if (len != 513 || memcmp(out, ref, 513) != 0)
+    {
+        printf("patch_gather disagrees with the two pass reference\n");
+        return 1;
+    }
+
+    uint64_t iterations = bench_iterations(1000000);
+
+    BENCH_RUN("copy/memcpy", 513, iterations,
+            { memcpy(out, src, 513); bench_consume(out); });
+    BENCH_RUN("patch/two_pass", 513, iterations,
+            { two_pass(out, src); bench_consume(out); });
+    BENCH_RUN("patch/fused", 513, iterations,
+            { bench_consume(&(size_t){ patch_gather(0, out, src, 513) }); bench_consume(out); });
+
+    // A whole universe written and committed, output 0 patched, 2 one to one
+    BENCH_RUN("commit/one_to_one", 513, iterations,
+            { dmx_output_write(2, 0, 1, &src[1], 512); dmx_output_commit(2, 0); });
+    BENCH_RUN("commit/patched", 513, iterations,
+            { dmx_output_write(0, 0, 1, &src[1], 512); dmx_output_commit(0, 0); });
+
+    const uint8_t *frame = dmx_buffer_latch(0, &len);
+    if (memcmp(frame, ref, 513) != 0)
+    {
+        printf("committed frame is not patched\n");
+        return 1;
+    }
+
+    // What a full patch takes out of a 44 fps frame period
+    uint64_t start = bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        bench_consume(&(size_t){ patch_gather(0, out, src, 513) });
+    }
+    double per_frame_ns = (double)(bench_now_ns() - start) / iterations;
+    uint32_t period_us = dmx_frame_period_us(44);
+    printf("full patch %.0f ns, %.4f%% of a %u us frame\n", per_frame_ns,
+            per_frame_ns / (period_us * 10.0), (unsigned)period_us);
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Compression of synthetic shows and the cost of encoding and decoding them
+// per frame. Three minutes of two universes at 40 fps: dimmer cues
+// crossfading every ten seconds and a second universe of scenes that snap
+// every fifteen, and in the busy show also a colour chase over RGB fixtures
+// and moving heads on smooth 16 bit paths, all changing every frame.
+// Controllers resend unchanged frames, so those are in the input too.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "show.h"
+
+#define SHOW_FPS        40
+#define SHOW_SECONDS    180
+#define SHOW_FRAMES     (SHOW_FPS * SHOW_SECONDS)
+
+static void generate(uint8_t *frame, uint8_t universe, uint32_t n, bool busy)
+{
+    double t = (double)n / SHOW_FPS;
+    memset(frame, 0, 512);
+
+    if (universe == 1)
+    {
+        // Scenes, each a fixed look
+        uint32_t scene = n / (SHOW_FPS * 15);
+        for (int ch = 0; ch < 96; ch++)
+        {
+            frame[ch] = (scene * 37 + ch * 11) % 7 == 0 ? 0 : (scene * 53 + ch * 29) & 0xff;
+        }
+        return;
+    }
+
+    // 24 RGB fixtures, hue chasing along the rig
+    for (int fixture = 0; busy && fixture < 24; fixture++)
+    {
+        double phase = t * 0.5 + fixture / 24.0;
+        for (int c = 0; c < 3; c++)
+        {
+            frame[fixture * 3 + c] = 127.5 + 127.5 * sin(2 * M_PI * (phase + c / 3.0));
+        }
+    }
+    // 8 moving heads, 16 bit pan and tilt on slow figures of eight
+    for (int head = 0; busy && head < 8; head++)
+    {
+        uint16_t pan = 32767.5 + 20000 * sin(t * 0.3 + head);
+        uint16_t tilt = 32767.5 + 12000 * sin(t * 0.6 + head);
+        uint8_t *p = &frame[100 + head * 6];
+        p[0] = pan >> 8;
+        p[1] = pan;
+        p[2] = tilt >> 8;
+        p[3] = tilt;
+        p[4] = 255;         // dimmer
+        p[5] = head * 10;   // gobo
+    }
+    // 16 dimmers, a 3 s crossfade into a new cue every 10 s
+    uint32_t cue = n / (SHOW_FPS * 10);
+    double into = fmod(t, 10.0) / 3.0;
+    into = into > 1.0 ? 1.0 : into;
+    for (int ch = 0; ch < 16; ch++)
+    {
+        double from = ((cue + 1) * 71 + ch * 13) & 0xff;
+        double to = ((cue + 2) * 71 + ch * 13) & 0xff;
+        frame[200 + ch] = from + (to - from) * into;
+    }
+}
+
+static int run(const char *name, bool busy)
+{
+    static show_encoder_t enc;
+    static show_decoder_t dec;
+    static uint8_t frame[512];
+    uint8_t *show = malloc(SHOW_HEADER_LEN + 2 * SHOW_FRAMES * SHOW_RECORD_MAX + 8);
+    if (show == NULL)
+    {
+        return 1;
+    }
+
+    size_t len = show_encoder_init(&enc, 2000, show);
+    uint64_t encode_ns = 0;
+    for (uint32_t n = 0; n < SHOW_FRAMES; n++)
+    {
+        uint32_t t_us = (uint64_t)n * 1000000 / SHOW_FPS;
+        for (uint8_t universe = 0; universe < 2; universe++)
+        {
+            generate(frame, universe, n, busy);
+            uint64_t start = bench_now_ns();
+            len += show_encode_frame(&enc, &show[len], universe, frame, 512, t_us);
+            encode_ns += bench_now_ns() - start;
+        }
+    }
+    len += show_encode_end(&enc, &show[len], (uint64_t)SHOW_FRAMES * 1000000 / SHOW_FPS);
+
+    // Decoding must give back every frame, unchanged ones included
+    if (!show_decoder_init(&dec, show, len))
+    {
+        printf("show header not recognised\n");
+        return 1;
+    }
+    for (uint32_t n = 0; n < SHOW_FRAMES; n++)
+    {
+        uint32_t t_us = (uint64_t)n * 1000000 / SHOW_FPS;
+        uint32_t next_us;
+        uint8_t universe;
+        while (show_next_time(&dec, &next_us) && next_us <= t_us)
+        {
+            if (show_decode_next(&dec, &universe) != SHOW_FRAME)
+            {
+                printf("show ended early at frame %u\n", n);
+                return 1;
+            }
+        }
+        for (universe = 0; universe < 2; universe++)
+        {
+            generate(frame, universe, n, busy);
+            if (dec.count[universe] != 512 || memcmp(dec.frame[universe], frame, 512) != 0)
+            {
+                printf("frame %u of universe %u decoded wrong\n", n, universe);
+                return 1;
+            }
+        }
+    }
+
+    size_t raw = (size_t)2 * SHOW_FRAMES * 512;
+    printf("%s show: %u frames, %zu KB raw, %zu KB encoded (%.1fx), %.1f KB per minute\n",
+            name, 2 * SHOW_FRAMES, raw / 1024, len / 1024, (double)raw / len,
+            len / 1024.0 / (SHOW_SECONDS / 60.0));
+    char case_name[64];
+    snprintf(case_name, sizeof(case_name), "%s/show_encode_frame", name);
+    bench_report(case_name, 512, 2 * SHOW_FRAMES, encode_ns);
+
+    uint64_t passes = bench_iterations(1000000) / 10000;
+    passes = passes ? passes : 1;
+    uint64_t decoded = 0;
+    uint64_t start = bench_now_ns();
+    for (uint64_t pass = 0; pass < passes; pass++)
+    {
+        uint8_t universe;
+        show_decoder_rewind(&dec);
+        while (show_decode_next(&dec, &universe) == SHOW_FRAME)
+        {
+            decoded++;
+        }
+        bench_consume(dec.frame);
+    }
+    snprintf(case_name, sizeof(case_name), "%s/show_decode_next", name);
+    bench_report(case_name, 512, decoded, bench_now_ns() - start);
+    printf("%u of %u frames changed and were stored\n",
+            (unsigned)(decoded / passes), 2 * SHOW_FRAMES);
+
+    free(show);
+    return 0;
+}
+
+int main(void)
+{
+    return run("cues", false) || run("busy", true);
+}
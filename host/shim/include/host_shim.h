@@ -0,0 +1,318 @@
+// Thin stand-in for the parts of ESP-IDF and FreeRTOS the bridge core uses,
+// so artnet.c and dmxtask.c can be compiled and measured on a Linux host.
+// Semaphores are pthread mutexes, tasks are detached threads and all
+// peripheral calls (GPIO, UART) are no-ops that report success.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "sdkconfig.h"
+
+// esp_err.h
+
+typedef int esp_err_t;
+
+#define ESP_OK          0
+#define ESP_FAIL        -1
+#define ESP_ERR_TIMEOUT 0x107
+
+#define ESP_ERROR_CHECK(x) do {                                         \
+        esp_err_t err_rc_ = (x);                                        \
+        if (err_rc_ != ESP_OK) {                                        \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: %d at %s:%d\n",    \
+                    err_rc_, __FILE__, __LINE__);                       \
+            abort();                                                    \
+        }                                                               \
+    } while(0)
+
+// esp_log.h
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+// Messages above this level are dropped, benchmarks lower it to keep the
+// hot path free of stdio
+extern esp_log_level_t host_log_level;
+
+void host_log(esp_log_level_t level, const char *tag, const char *fmt, ...);
+
+#define ESP_LOGE(tag, ...) host_log(ESP_LOG_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) host_log(ESP_LOG_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) host_log(ESP_LOG_INFO, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) host_log(ESP_LOG_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) host_log(ESP_LOG_VERBOSE, tag, __VA_ARGS__)
+
+// esp_system.h
+
+uint32_t esp_random(void);
+
+// esp_timer.h
+
+int64_t esp_timer_get_time(void);
+
+// rom/ets_sys.h
+
+void ets_delay_us(uint32_t us);
+
+// freertos
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          pdTRUE
+#define portMAX_DELAY   ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// Added to xTaskGetTickCount, tests move it forward to run out timeouts
+extern TickType_t host_tick_offset;
+
+#define configMAX_PRIORITIES 25
+#define tskIDLE_PRIORITY     0
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct {
+    pthread_t thread;
+} StaticTask_t;
+
+typedef StaticTask_t *TaskHandle_t;
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name,
+        uint32_t stack_depth, void *param, UBaseType_t priority,
+        StackType_t *stack, StaticTask_t *task_buffer);
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn,
+        const char *name, uint32_t stack_depth, void *param,
+        UBaseType_t priority, StackType_t *stack, StaticTask_t *task_buffer,
+        BaseType_t core);
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount(void);
+
+typedef struct {
+    pthread_mutex_t mutex;
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+typedef void *QueueHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+typedef struct {
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_MUTEX_INITIALIZER }
+
+#define taskENTER_CRITICAL(mux) pthread_mutex_lock(&(mux)->mutex)
+#define taskEXIT_CRITICAL(mux)  pthread_mutex_unlock(&(mux)->mutex)
+#define portENTER_CRITICAL(mux) taskENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)  taskEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_ISR(mux) taskENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux)  taskEXIT_CRITICAL(mux)
+
+// driver/gpio.h
+
+typedef enum {
+    GPIO_NUM_4 = 4,
+    GPIO_NUM_13 = 13,
+    GPIO_NUM_16 = 16,
+    GPIO_NUM_17 = 17,
+    GPIO_NUM_22 = 22,
+    GPIO_NUM_23 = 23,
+    GPIO_NUM_25 = 25,
+    GPIO_NUM_26 = 26,
+} gpio_num_t;
+
+typedef enum {
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+} gpio_mode_t;
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+void gpio_pad_select_gpio(uint32_t gpio);
+
+// driver/uart.h
+
+typedef enum {
+    UART_NUM_0,
+    UART_NUM_1,
+    UART_NUM_2,
+    UART_NUM_MAX,
+} uart_port_t;
+
+typedef enum { UART_DATA_8_BITS = 3 } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0 } uart_parity_t;
+typedef enum { UART_STOP_BITS_2 = 3 } uart_stop_bits_t;
+typedef enum { UART_HW_FLOWCTRL_DISABLE = 0 } uart_hw_flowcontrol_t;
+
+#define UART_SIGNAL_TXD_INV (1 << 5)
+#define UART_PIN_NO_CHANGE  (-1)
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+} uart_config_t;
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *config);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size,
+        int tx_buffer_size, int queue_size, QueueHandle_t *uart_queue,
+        int intr_alloc_flags);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx, int rx, int rts, int cts);
+esp_err_t uart_set_line_inverse(uart_port_t uart_num, uint32_t inverse_mask);
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks);
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size);
+
+typedef void *uart_isr_handle_t;
+
+esp_err_t uart_isr_register(uart_port_t uart_num, void (*fn)(void *), void *arg,
+        int intr_alloc_flags, uart_isr_handle_t *handle);
+
+// hal/uart_ll.h, register level access used from the DMX interrupts
+
+typedef struct {
+    uart_port_t port;
+} uart_dev_t;
+
+extern uart_dev_t host_uart_dev[UART_NUM_MAX];
+
+#define UART_LL_GET_HW(num) (&host_uart_dev[(num)])
+
+#define UART_INTR_TXFIFO_EMPTY  (1 << 1)
+#define UART_INTR_TX_DONE       (1 << 14)
+#define UART_LL_INTR_MASK       0x7ffff
+
+void uart_ll_inverse_signal(uart_dev_t *hw, uint32_t inv_mask);
+uint32_t uart_ll_get_txfifo_len(uart_dev_t *hw);
+void uart_ll_write_txfifo(uart_dev_t *hw, const uint8_t *buf, uint32_t wr_len);
+void uart_ll_set_txfifo_empty_thr(uart_dev_t *hw, uint16_t empty_thrhd);
+void uart_ll_ena_intr_mask(uart_dev_t *hw, uint32_t mask);
+void uart_ll_disable_intr_mask(uart_dev_t *hw, uint32_t mask);
+void uart_ll_clr_intsts_mask(uart_dev_t *hw, uint32_t mask);
+uint32_t uart_ll_get_intsts_mask(uart_dev_t *hw);
+
+// hal/cpu_hal.h, nanoseconds stand in for CPU cycles
+
+uint32_t cpu_hal_get_cycle_count(void);
+
+// driver/timer.h
+
+typedef enum { TIMER_GROUP_0, TIMER_GROUP_1 } timer_group_t;
+typedef enum { TIMER_0, TIMER_1 } timer_idx_t;
+typedef enum { TIMER_COUNT_DOWN, TIMER_COUNT_UP } timer_count_dir_t;
+typedef enum { TIMER_PAUSE, TIMER_START } timer_start_t;
+typedef enum { TIMER_ALARM_DIS, TIMER_ALARM_EN } timer_alarm_t;
+typedef enum { TIMER_AUTORELOAD_DIS, TIMER_AUTORELOAD_EN } timer_autoreload_t;
+
+typedef struct {
+    timer_alarm_t alarm_en;
+    timer_start_t counter_en;
+    timer_count_dir_t counter_dir;
+    timer_autoreload_t auto_reload;
+    uint32_t divider;
+} timer_config_t;
+
+typedef bool (*timer_isr_t)(void *);
+
+esp_err_t timer_init(timer_group_t group, timer_idx_t idx, const timer_config_t *config);
+esp_err_t timer_set_counter_value(timer_group_t group, timer_idx_t idx, uint64_t value);
+esp_err_t timer_get_counter_value(timer_group_t group, timer_idx_t idx, uint64_t *value);
+esp_err_t timer_isr_callback_add(timer_group_t group, timer_idx_t idx,
+        timer_isr_t isr, void *arg, int intr_alloc_flags);
+esp_err_t timer_start(timer_group_t group, timer_idx_t idx);
+uint64_t timer_group_get_counter_value_in_isr(timer_group_t group, timer_idx_t idx);
+void timer_group_set_alarm_value_in_isr(timer_group_t group, timer_idx_t idx, uint64_t value);
+void timer_group_enable_alarm_in_isr(timer_group_t group, timer_idx_t idx);
+
+// lwip/api.h, the netconn calls of zero-copy receive. There is no stack
+// behind it: host_netconn_deliver queues a datagram as lwIP would and the
+// netbuf references the caller's memory, like a pbuf payload would.
+
+typedef int8_t err_t;
+typedef uint16_t u16_t;
+
+#define ERR_OK          0
+#define ERR_MEM         -1
+#define ERR_VAL         -6
+#define ERR_WOULDBLOCK  -7
+
+typedef struct {
+    uint32_t addr;
+} ip_addr_t;
+
+extern const ip_addr_t host_ip_addr_any;
+#define IP_ADDR_ANY (&host_ip_addr_any)
+#define ip_addr_get_ip4_u32(ipaddr) ((ipaddr)->addr)
+#define ip_addr_set_ip4_u32(ipaddr, val) ((ipaddr)->addr = (val))
+
+enum netconn_type { NETCONN_UDP = 0x20 };
+enum netconn_evt { NETCONN_EVT_RCVPLUS, NETCONN_EVT_RCVMINUS, NETCONN_EVT_SENDPLUS,
+    NETCONN_EVT_SENDMINUS, NETCONN_EVT_ERROR };
+enum netconn_igmp { NETCONN_JOIN, NETCONN_LEAVE };
+
+struct netconn;
+typedef void (*netconn_callback)(struct netconn *conn, enum netconn_evt evt, u16_t len);
+
+struct netbuf {
+    const void *data;
+    u16_t len;
+    ip_addr_t addr;
+    struct netbuf *next;
+};
+
+struct netconn {
+    netconn_callback callback;
+    struct netbuf *head;
+    struct netbuf *tail;
+    u16_t port;
+    bool nonblocking;
+};
+
+struct netconn *netconn_new_with_callback(enum netconn_type type, netconn_callback callback);
+err_t netconn_delete(struct netconn *conn);
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, u16_t port);
+err_t netconn_join_leave_group(struct netconn *conn, const ip_addr_t *multiaddr,
+        const ip_addr_t *netif_addr, enum netconn_igmp join_or_leave);
+err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf);
+err_t netconn_sendto(struct netconn *conn, struct netbuf *buf, const ip_addr_t *addr, u16_t port);
+#define netconn_set_nonblocking(conn, val) ((conn)->nonblocking = (val))
+
+struct netbuf *netbuf_new(void);
+void netbuf_delete(struct netbuf *buf);
+err_t netbuf_ref(struct netbuf *buf, const void *dataptr, u16_t size);
+err_t netbuf_data(struct netbuf *buf, void **dataptr, u16_t *len);
+u16_t netbuf_copy_partial(const struct netbuf *buf, void *dataptr, u16_t len, u16_t offset);
+#define netbuf_len(buf) ((buf)->len)
+#define netbuf_fromaddr(buf) (&(buf)->addr)
+#define netbuf_copy(buf, dataptr, len) netbuf_copy_partial(buf, dataptr, len, 0)
+
+// Host only: queues a datagram on conn and runs its callback as lwIP's
+// thread would. False when the netbuf pool is exhausted, like a full
+// receive mailbox.
+bool host_netconn_deliver(struct netconn *conn, const void *data, size_t len, uint32_t source_ip);
@@ -0,0 +1,42 @@
+// Host build defaults for the options declared in main/Kconfig.projbuild
+#pragma once
+
+#define CONFIG_LED_PIN 13
+#define CONFIG_LED_STRIP_LENGTH 170
+#define CONFIG_LEDS_PER_ROUND 60
+#define CONFIG_PIXEL_ENABLE 0
+#define CONFIG_PIXEL_FIRST_OUTPUT 1
+#define CONFIG_PIXEL_REFRESH_HZ 40
+#define CONFIG_ESP_WIFI_SSID "myssid"
+#define CONFIG_ESP_WIFI_PASSWORD "mypassword"
+#define CONFIG_ESP_MAXIMUM_RETRY 5
+#define CONFIG_SERVER_ENABLE 0
+#define CONFIG_SERVER_PORT 7777
+#define CONFIG_SERVER_KEEPALIVE_IDLE 5
+#define CONFIG_SERVER_KEEPALIVE_INTERVAL 5
+#define CONFIG_SERVER_KEEPALIVE_COUNT 3
+
+// More outputs than the device default so routing across outputs is exercised
+#define CONFIG_DMX_OUTPUT_COUNT 4
+#define CONFIG_ARTNET_UNIVERSE 0
+#define CONFIG_DMX_PORTS 2
+#define CONFIG_DMX_MERGE_LTP 0
+#define CONFIG_SACN_ENABLE 1
+#define CONFIG_SACN_UNIVERSE 1
+#define CONFIG_ARTNET_ZERO_COPY 0
+#define CONFIG_DMX_ADAPTIVE_LENGTH 0
+#define CONFIG_DMX_REFRESH_HZ 40
+#define CONFIG_DMX_BREAK_US 184
+#define CONFIG_DMX_MAB_US 24
+#define CONFIG_DMX_INPUT 0
+#define CONFIG_DMX_PATCH_OFFSET 0
+#define CONFIG_DMX_PATCH_CURVE 0
+#define CONFIG_DMX_FADE 0
+#define CONFIG_DMX_FADE_MS 0
+#define CONFIG_DMX_PLAYOUT 1
+#define CONFIG_DMX_PLAYOUT_MS 0
+#define CONFIG_DMX_PLAYOUT_DEPTH 8
+#define CONFIG_SHOW_ENABLE 0
+#define CONFIG_SHOW_KEYFRAME_MS 2000
+#define CONFIG_LATENCY_SUMMARY_S 0
+#define CONFIG_TRACE_RING_BITS 9
@@ -0,0 +1,458 @@
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_shim.h"
+#include "common.h"
+#include "looktask.h"
+#include "wifitask.h"
+
+// Defined by main.c on the device
+enum state_ state = STATE_IDLE;
+
+// wifitask.c on the device, the host's network is always up
+void wifi_wait_connected(void)
+{
+}
+
+// looktask.c on the device, the host has no NVS to restore from
+void look_restore(void)
+{
+}
+
+esp_log_level_t host_log_level = ESP_LOG_INFO;
+TickType_t host_tick_offset = 0;
+
+static const char level_letter[] = "NEWIDV";
+
+void host_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    if (level > host_log_level)
+    {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%c (%s) ", level_letter[level], tag);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t esp_random(void)
+{
+    return (uint32_t)random();
+}
+
+void ets_delay_us(uint32_t us)
+{
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+}
+
+struct task_start {
+    TaskFunction_t fn;
+    void *param;
+};
+
+static void *task_trampoline(void *arg)
+{
+    struct task_start start = *(struct task_start *)arg;
+    free(arg);
+    start.fn(start.param);
+    return NULL;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name,
+        uint32_t stack_depth, void *param, UBaseType_t priority,
+        StackType_t *stack, StaticTask_t *task_buffer)
+{
+    struct task_start *start = malloc(sizeof(*start));
+    start->fn = fn;
+    start->param = param;
+    if (pthread_create(&task_buffer->thread, NULL, task_trampoline, start) != 0)
+    {
+        free(start);
+        return NULL;
+    }
+    pthread_detach(task_buffer->thread);
+    return task_buffer;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn,
+        const char *name, uint32_t stack_depth, void *param,
+        UBaseType_t priority, StackType_t *stack, StaticTask_t *task_buffer,
+        BaseType_t core)
+{
+    return xTaskCreateStatic(fn, name, stack_depth, param, priority, stack,
+            task_buffer);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    ets_delay_us(ticks * portTICK_PERIOD_MS * 1000);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL)
+    {
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000) + host_tick_offset;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+    pthread_mutex_init(&buffer->mutex, NULL);
+    return buffer;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        return pthread_mutex_lock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    if (ticks == 0)
+    {
+        return pthread_mutex_trylock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks / 1000;
+    deadline.tv_nsec += (ticks % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    return pthread_mutex_timedlock(&sem->mutex, &deadline) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pthread_mutex_unlock(&sem->mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+uint32_t cpu_hal_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    return ESP_OK;
+}
+
+void gpio_pad_select_gpio(uint32_t gpio)
+{
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size,
+        int tx_buffer_size, int queue_size, QueueHandle_t *uart_queue,
+        int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx, int rx, int rts, int cts)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_set_line_inverse(uart_port_t uart_num, uint32_t inverse_mask)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks)
+{
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    return (int)size;
+}
+
+esp_err_t uart_isr_register(uart_port_t uart_num, void (*fn)(void *), void *arg,
+        int intr_alloc_flags, uart_isr_handle_t *handle)
+{
+    return ESP_OK;
+}
+
+uart_dev_t host_uart_dev[UART_NUM_MAX];
+
+void uart_ll_inverse_signal(uart_dev_t *hw, uint32_t inv_mask)
+{
+}
+
+uint32_t uart_ll_get_txfifo_len(uart_dev_t *hw)
+{
+    return 128;
+}
+
+void uart_ll_write_txfifo(uart_dev_t *hw, const uint8_t *buf, uint32_t wr_len)
+{
+}
+
+void uart_ll_set_txfifo_empty_thr(uart_dev_t *hw, uint16_t empty_thrhd)
+{
+}
+
+void uart_ll_ena_intr_mask(uart_dev_t *hw, uint32_t mask)
+{
+}
+
+void uart_ll_disable_intr_mask(uart_dev_t *hw, uint32_t mask)
+{
+}
+
+void uart_ll_clr_intsts_mask(uart_dev_t *hw, uint32_t mask)
+{
+}
+
+uint32_t uart_ll_get_intsts_mask(uart_dev_t *hw)
+{
+    return 0;
+}
+
+static uint64_t host_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+esp_err_t timer_init(timer_group_t group, timer_idx_t idx, const timer_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t timer_set_counter_value(timer_group_t group, timer_idx_t idx, uint64_t value)
+{
+    return ESP_OK;
+}
+
+esp_err_t timer_get_counter_value(timer_group_t group, timer_idx_t idx, uint64_t *value)
+{
+    *value = host_now_us();
+    return ESP_OK;
+}
+
+esp_err_t timer_isr_callback_add(timer_group_t group, timer_idx_t idx,
+        timer_isr_t isr, void *arg, int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t timer_start(timer_group_t group, timer_idx_t idx)
+{
+    return ESP_OK;
+}
+
+uint64_t timer_group_get_counter_value_in_isr(timer_group_t group, timer_idx_t idx)
+{
+    return host_now_us();
+}
+
+void timer_group_set_alarm_value_in_isr(timer_group_t group, timer_idx_t idx, uint64_t value)
+{
+}
+
+void timer_group_enable_alarm_in_isr(timer_group_t group, timer_idx_t idx)
+{
+}
+
+const ip_addr_t host_ip_addr_any = { 0 };
+
+// Fixed pools like lwIP's memp, so the zero-copy path costs no malloc
+#define HOST_NETCONNS 4
+#define HOST_NETBUFS  32
+
+static struct netconn host_netconns[HOST_NETCONNS];
+static bool host_netconn_used[HOST_NETCONNS];
+static struct netbuf host_netbufs[HOST_NETBUFS];
+static struct netbuf *host_netbuf_free = NULL;
+static bool host_netbufs_ready = false;
+static pthread_mutex_t host_lwip_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct netbuf *netbuf_new(void)
+{
+    pthread_mutex_lock(&host_lwip_lock);
+    if (!host_netbufs_ready)
+    {
+        for (size_t i = 0; i < HOST_NETBUFS; i++)
+        {
+            host_netbufs[i].next = host_netbuf_free;
+            host_netbuf_free = &host_netbufs[i];
+        }
+        host_netbufs_ready = true;
+    }
+    struct netbuf *buf = host_netbuf_free;
+    if (buf != NULL)
+    {
+        host_netbuf_free = buf->next;
+        memset(buf, 0, sizeof(*buf));
+    }
+    pthread_mutex_unlock(&host_lwip_lock);
+    return buf;
+}
+
+void netbuf_delete(struct netbuf *buf)
+{
+    if (buf == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&host_lwip_lock);
+    buf->next = host_netbuf_free;
+    host_netbuf_free = buf;
+    pthread_mutex_unlock(&host_lwip_lock);
+}
+
+err_t netbuf_ref(struct netbuf *buf, const void *dataptr, u16_t size)
+{
+    buf->data = dataptr;
+    buf->len = size;
+    return ERR_OK;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **dataptr, u16_t *len)
+{
+    *dataptr = (void *)buf->data;
+    *len = buf->len;
+    return ERR_OK;
+}
+
+u16_t netbuf_copy_partial(const struct netbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    if (offset >= buf->len)
+    {
+        return 0;
+    }
+    u16_t n = buf->len - offset < len ? buf->len - offset : len;
+    memcpy(dataptr, (const uint8_t *)buf->data + offset, n);
+    return n;
+}
+
+struct netconn *netconn_new_with_callback(enum netconn_type type, netconn_callback callback)
+{
+    pthread_mutex_lock(&host_lwip_lock);
+    struct netconn *conn = NULL;
+    for (size_t i = 0; i < HOST_NETCONNS; i++)
+    {
+        if (!host_netconn_used[i])
+        {
+            host_netconn_used[i] = true;
+            conn = &host_netconns[i];
+            memset(conn, 0, sizeof(*conn));
+            conn->callback = callback;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&host_lwip_lock);
+    return conn;
+}
+
+err_t netconn_delete(struct netconn *conn)
+{
+    struct netbuf *buf;
+    while (netconn_recv(conn, &buf) == ERR_OK)
+    {
+        netbuf_delete(buf);
+    }
+    pthread_mutex_lock(&host_lwip_lock);
+    host_netconn_used[conn - host_netconns] = false;
+    pthread_mutex_unlock(&host_lwip_lock);
+    return ERR_OK;
+}
+
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, u16_t port)
+{
+    conn->port = port;
+    return ERR_OK;
+}
+
+err_t netconn_join_leave_group(struct netconn *conn, const ip_addr_t *multiaddr,
+        const ip_addr_t *netif_addr, enum netconn_igmp join_or_leave)
+{
+    return ERR_OK;
+}
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf)
+{
+    pthread_mutex_lock(&host_lwip_lock);
+    struct netbuf *buf = conn->head;
+    if (buf != NULL)
+    {
+        conn->head = buf->next;
+        if (conn->head == NULL)
+        {
+            conn->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&host_lwip_lock);
+    // Blocking receive is not emulated, nothing would ever deliver
+    *new_buf = buf;
+    return buf != NULL ? ERR_OK : ERR_WOULDBLOCK;
+}
+
+err_t netconn_sendto(struct netconn *conn, struct netbuf *buf, const ip_addr_t *addr, u16_t port)
+{
+    return ERR_OK;
+}
+
+bool host_netconn_deliver(struct netconn *conn, const void *data, size_t len, uint32_t source_ip)
+{
+    struct netbuf *buf = netbuf_new();
+    if (buf == NULL)
+    {
+        return false;
+    }
+    netbuf_ref(buf, data, len);
+    buf->addr.addr = source_ip;
+    pthread_mutex_lock(&host_lwip_lock);
+    if (conn->tail != NULL)
+    {
+        conn->tail->next = buf;
+    }
+    else
+    {
+        conn->head = buf;
+    }
+    conn->tail = buf;
+    pthread_mutex_unlock(&host_lwip_lock);
+    if (conn->callback != NULL)
+    {
+        conn->callback(conn, NETCONN_EVT_RCVPLUS, len);
+    }
+    return true;
+}
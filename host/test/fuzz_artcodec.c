@@ -0,0 +1,318 @@
+// Fuzz target for the Art-Net codec and handle_artnet behind it. With
+// clang it also builds for libFuzzer (fuzz_artcodec_libfuzzer, run by
+// hand); the ctest runs the standalone driver, which mutates a valid
+// packet of every OpCode: bytes flipped, counts rewritten, packets cut
+// short and run on. Every input sits in a heap buffer of exactly its size
+// and the codec is built with AddressSanitizer where the compiler has it,
+// so a read past the packet fails the run. Parsed packets are also held to
+// the table: nothing accepted shorter than its OpCode's fixed part or its
+// own count.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "route.h"
+
+#define PACKET_MAX 1024
+
+static void fail(const char *what, const uint8_t *data, size_t size)
+{
+    printf("FAILED: %s, %zu byte input:", what, size);
+    for (size_t i = 0; i < size && i < 32; i++)
+    {
+        printf(" %02x", data[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+    abort();
+}
+
+static void init_once(void)
+{
+    static bool done = false;
+    if (!done)
+    {
+        host_log_level = ESP_LOG_NONE;
+        dmx_buffer_init();
+        route_init();
+        artpoll_init();
+        done = true;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    init_once();
+    uint8_t *buf = malloc(size > 0 ? size : 1);
+    memcpy(buf, data, size);
+
+    artcodec_packet_t packet;
+    artcodec_status_t status = artcodec_parse(buf, size, &packet);
+    const artcodec_op_t *op = packet.op;
+    if (status == ARTCODEC_OK)
+    {
+        if (op == NULL || size < op->min_len || packet.raw != buf)
+        {
+            fail("accepted without its fixed part", buf, size);
+        }
+        size_t end = op->min_len + packet.count * op->count_unit;
+        if (op->count_size != 0 &&
+                (packet.count > op->count_max || end > size ||
+                 (op->flags & ARTCODEC_EXACT && end != size)))
+        {
+            fail("accepted with a count the packet does not hold", buf, size);
+        }
+        // Everything the packet says it carries is there to read
+        uint8_t sum = 0;
+        for (size_t i = 0; i < end; i++)
+        {
+            sum += packet.raw[i];
+        }
+        volatile uint8_t sink = sum;
+        (void)sink;
+    }
+    else if (status == ARTCODEC_TRUNCATED && (op == NULL || size >= op->min_len))
+    {
+        fail("truncated but long enough", buf, size);
+    }
+    else if (status == ARTCODEC_SHORT && size >= ARTCODEC_HEADER_LEN)
+    {
+        fail("short but has a header", buf, size);
+    }
+
+    handle_artnet(buf, size, 0x0100000a);
+    free(buf);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+static uint8_t seeds[ARTCODEC_OP_COUNT + 4][PACKET_MAX];
+static size_t seed_lens[ARTCODEC_OP_COUNT + 4];
+static size_t seed_count = 0;
+
+static void add_seed(const uint8_t *packet, size_t len)
+{
+    memcpy(seeds[seed_count], packet, len);
+    seed_lens[seed_count++] = len;
+}
+
+// The shortest packet of every OpCode, plus ones with data behind them
+static void build_seeds(void)
+{
+    uint8_t packet[PACKET_MAX];
+    for (size_t i = 0; i < ARTCODEC_OP_COUNT; i++)
+    {
+        const artcodec_op_t *op = &artcodec_ops[i];
+        memset(packet, 0, op->min_len);
+        artcodec_encode_header(packet, op->opcode);
+        if (op->flags & ARTCODEC_NO_VERSION)
+        {
+            memset(&packet[10], 0, 2);
+        }
+        add_seed(packet, op->min_len);
+    }
+
+    for (size_t i = 0; i < ARTCODEC_DMX_MAX; i++)
+    {
+        packet[ARTCODEC_DMX_HEADER_LEN + i] = i;
+    }
+    add_seed(packet, artcodec_encode_dmx(packet, 1, 0, CONFIG_ARTNET_UNIVERSE, ARTCODEC_DMX_MAX));
+    add_seed(packet, artcodec_encode_diag(packet, sizeof(packet), ARTCODEC_DP_LOW, 0, "hello"));
+    const uint8_t uids[3][6] = { { 1 }, { 2 }, { 3 } };
+    add_seed(packet, artcodec_encode_tod_data(packet, sizeof(packet), CONFIG_ARTNET_UNIVERSE, 1,
+            1, 3, 0, (const uint8_t *)uids, 3));
+    artcodec_tod_request_t *request = (artcodec_tod_request_t *)packet;
+    memset(packet, 0, sizeof(*request) + 4);
+    artcodec_encode_header(packet, ARTNET_OP_TOD_REQUEST);
+    request->add_count = 4;
+    request->address[0] = CONFIG_ARTNET_UNIVERSE & 0xff;
+    add_seed(packet, sizeof(*request) + 4);
+}
+
+static size_t mutate(uint8_t *packet, size_t len)
+{
+    switch (rand() % 5)
+    {
+        case 0:
+            // A few bytes anywhere, mostly in the header and fixed fields
+            for (int n = 1 + rand() % 4; n > 0 && len > 0; n--)
+            {
+                size_t at = rand() % 2 ? rand() % (len < 32 ? len : 32) : rand() % len;
+                packet[at] ^= 1 << (rand() % 8);
+            }
+            return len;
+        case 1:
+            return len > 0 ? rand() % len : 0;
+        case 2:
+        {
+            size_t more = 1 + rand() % 64;
+            if (len + more > PACKET_MAX)
+            {
+                more = PACKET_MAX - len;
+            }
+            for (size_t i = 0; i < more; i++)
+            {
+                packet[len + i] = rand();
+            }
+            return len + more;
+        }
+        case 3:
+        {
+            // The count field of whatever OpCode this is, set to anything
+            const artcodec_op_t *op = len >= 10 ? artcodec_op(packet[8] | packet[9] << 8) : NULL;
+            if (op != NULL && op->count_size != 0 && op->count_at + op->count_size <= len)
+            {
+                packet[op->count_at] = rand();
+                packet[op->count_at + op->count_size - 1] = rand();
+            }
+            return len;
+        }
+        default:
+        {
+            // Another OpCode over the same body
+            if (len >= 10)
+            {
+                uint16_t opcode = artcodec_ops[rand() % ARTCODEC_OP_COUNT].opcode;
+                packet[8] = opcode & 0xff;
+                packet[9] = opcode >> 8;
+            }
+            return len;
+        }
+    }
+}
+
+// What the encoders write parses back as what went in
+static bool round_trip(void)
+{
+    static uint8_t packet[PACKET_MAX];
+    artcodec_packet_t parsed;
+
+    size_t len = artcodec_encode_dmx(packet, 7, 0, 0x0123, 23);
+    if (artcodec_parse(packet, len, &parsed) != ARTCODEC_OK || parsed.count != 24 ||
+            parsed.dmx->sequence != 7 || parsed.dmx->data[23] != 0 ||
+            artcodec_port_address(parsed.dmx->net, parsed.dmx->sub_uni) != 0x0123)
+    {
+        printf("ArtDmx does not round trip\n");
+        return false;
+    }
+
+    len = artcodec_encode_diag(packet, sizeof(artcodec_diag_t) + 8, ARTCODEC_DP_HIGH, 2,
+            "a long diagnostic");
+    if (artcodec_parse(packet, len, &parsed) != ARTCODEC_OK || parsed.count != 8 ||
+            parsed.diag->priority != ARTCODEC_DP_HIGH || parsed.diag->logical_port != 2 ||
+            strcmp(parsed.diag->data, "a long ") != 0)
+    {
+        printf("ArtDiagData does not round trip\n");
+        return false;
+    }
+
+    const uint8_t uids[2][6] = { { 0x7f, 0xf0, 1, 2, 3, 4 }, { 0x7f, 0xf0, 5, 6, 7, 8 } };
+    const uint8_t *uid_bytes = (const uint8_t *)uids;
+    len = artcodec_encode_tod_data(packet, sizeof(packet), 0x0123, 2, 1, 2, 0, uid_bytes, 2);
+    if (artcodec_parse(packet, len, &parsed) != ARTCODEC_OK || parsed.count != 2 ||
+            parsed.tod_data->net != 0x01 || parsed.tod_data->address != 0x23 ||
+            parsed.tod_data->port != 2 || memcmp(parsed.tod_data->tod, uids, 12) != 0 ||
+            artcodec_encode_tod_data(packet, len - 1, 0x0123, 2, 1, 2, 0, uid_bytes, 2) != 0)
+    {
+        printf("ArtTodData does not round trip\n");
+        return false;
+    }
+
+    artcodec_encode_poll_reply((artcodec_poll_reply_t *)packet, 0x0100000a, 3);
+    if (artcodec_parse(packet, sizeof(artcodec_poll_reply_t), &parsed) != ARTCODEC_OK ||
+            parsed.op->index != ARTCODEC_OP_POLL_REPLY || parsed.poll_reply->bind_index != 3 ||
+            parsed.poll_reply->port[0] != (ARTNET_PORT & 0xff))
+    {
+        printf("ArtPollReply does not round trip\n");
+        return false;
+    }
+
+    // Every OpCode finds its own entry in the lookup table
+    for (size_t i = 0; i < ARTCODEC_OP_COUNT; i++)
+    {
+        if (artcodec_op(artcodec_ops[i].opcode) != &artcodec_ops[i])
+        {
+            printf("Op%s shares a lookup slot\n", artcodec_ops[i].name);
+            return false;
+        }
+    }
+
+    // artpoll's replies are well formed, and carry an address set from
+    // another task once the network task reads them
+    uint32_t ip = 0x0a00000a;
+    artpoll_set_ip(ip);
+    const uint8_t *replies;
+    size_t count = artpoll_replies(&replies);
+    if (memcmp(((const artcodec_poll_reply_t *)replies)->ip, &ip, 4) != 0)
+    {
+        printf("ArtPollReply does not carry the address set\n");
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (artcodec_parse(&replies[i * ARTPOLL_REPLY_LEN], ARTPOLL_REPLY_LEN, &parsed) != ARTCODEC_OK)
+        {
+            printf("ArtPollReply %zu does not parse\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 300000;
+    srand(1);
+    init_once();
+    build_seeds();
+    if (!round_trip())
+    {
+        return 1;
+    }
+
+    static uint8_t packet[PACKET_MAX];
+    uint32_t statuses[ARTCODEC_TOO_LONG + 1] = { 0 };
+    for (long i = 0; i < iterations; i++)
+    {
+        size_t seed = rand() % seed_count;
+        size_t len = seed_lens[seed];
+        memcpy(packet, seeds[seed], len);
+        for (int n = 1 + rand() % 3; n > 0; n--)
+        {
+            len = mutate(packet, len);
+        }
+        artcodec_packet_t parsed;
+        statuses[artcodec_parse(packet, len, &parsed)]++;
+        LLVMFuzzerTestOneInput(packet, len);
+    }
+
+    printf("%ld inputs:", iterations);
+    for (int status = 0; status <= ARTCODEC_TOO_LONG; status++)
+    {
+        printf(" %s %u,", artcodec_status_name(status), (unsigned)statuses[status]);
+    }
+    printf("\n");
+    // Every outcome should have come up, or the mutations miss a check
+    for (int status = 0; status <= ARTCODEC_TOO_LONG; status++)
+    {
+        if (statuses[status] == 0)
+        {
+            printf("no input came out %s\n", artcodec_status_name(status));
+            return 1;
+        }
+    }
+    printf("art-net codec ok\n");
+    return 0;
+}
+
+#endif
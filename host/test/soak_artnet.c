@@ -0,0 +1,266 @@
+// End to end soak of the host build: the real artnet_worker() on its UDP
+// socket, fed over loopback by the load generator in a child process, with
+// the outputs latched at the DMX refresh rate the way the frame engine
+// does. Every report interval, and at the end, prints what was sent and
+// received, what the sequence guard and batching dropped, the send to
+// latch latency, frames going backwards at the outputs and the CPU time
+// the node spent per datagram.
+//
+//   soak_artnet [-d seconds] [-i report seconds] [-n universes] [-r rate]
+//               [-s slots] [-l loss %] [-o reorder %] [-b burst]
+//
+// Fails when frames went backwards, or when nothing was injected and
+// datagrams still went missing. Exits 77 (skipped) when the Art-Net port
+// is taken.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "host_shim.h"
+#include "common.h"
+
+#include "artnet.h"
+#include "dmxtask.h"
+#include "latency.h"
+#include "loadgen.h"
+#include "rxbatch.h"
+
+// Send to latch latency histogram, 100 us buckets up to a second
+#define LATENCY_BUCKET_US   100
+#define LATENCY_BUCKETS     10000
+
+typedef struct {
+    loadgen_stats_t stats;
+    atomic_bool stop;
+} shared_t;
+
+typedef struct {
+    uint64_t latched;           // new frames seen at the outputs
+    uint64_t backwards;         // frame counter lower than the one before
+    uint64_t latency_sum_us;
+    uint32_t latency_max_us;
+    uint64_t buckets[LATENCY_BUCKETS];
+} outputs_t;
+
+extern enum state_ state;
+
+static outputs_t outputs;
+static uint32_t last_counter[DMX_OUTPUT_COUNT];
+static bool seen[DMX_OUTPUT_COUNT];
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t cpu_us(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void latch_outputs(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        size_t len;
+        const uint8_t *frame = dmx_buffer_latch(output, &len);
+        if (len < 1 + LOADGEN_STAMP_LEN)
+        {
+            continue;
+        }
+        uint32_t counter = le32(&frame[1]);
+        if (seen[output] && counter == last_counter[output])
+        {
+            continue;
+        }
+        if (seen[output] && (int32_t)(counter - last_counter[output]) < 0)
+        {
+            outputs.backwards++;
+        }
+        seen[output] = true;
+        last_counter[output] = counter;
+
+        uint32_t latency = loadgen_now_us() - le32(&frame[5]);
+        outputs.latched++;
+        outputs.latency_sum_us += latency;
+        outputs.latency_max_us = latency > outputs.latency_max_us ? latency : outputs.latency_max_us;
+        uint32_t bucket = latency / LATENCY_BUCKET_US;
+        outputs.buckets[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    }
+}
+
+static uint32_t latency_p99_us(void)
+{
+    uint64_t rank = outputs.latched - outputs.latched / 100;
+    uint64_t seen_count = 0;
+    for (uint32_t bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    {
+        seen_count += outputs.buckets[bucket];
+        if (seen_count >= rank && seen_count > 0)
+        {
+            uint32_t p99 = (bucket + 1) * LATENCY_BUCKET_US;
+            return p99 < outputs.latency_max_us ? p99 : outputs.latency_max_us;
+        }
+    }
+    return 0;
+}
+
+static void report(const shared_t *shared, uint64_t elapsed_s, uint64_t cpu_start_us)
+{
+    rxbatch_stats_t rx;
+    artnet_seq_stats_t seq;
+    rxbatch_get_stats(&rx);
+    artnet_get_seq_stats(&seq);
+    uint64_t sent = atomic_load(&shared->stats.sent);
+
+    printf("%6llu s  sent %llu  received %u  missing %lld  injected loss %llu reorder %llu\n"
+            "         sequence lost %u reordered %u duplicates %u  coalesced %u\n"
+            "         latched %llu  backwards %llu  latency mean %llu us p99 %u us max %u us  cpu %.2f us/datagram\n",
+            (unsigned long long)elapsed_s, (unsigned long long)sent, (unsigned)rx.datagrams,
+            (long long)(sent - rx.datagrams),
+            (unsigned long long)atomic_load(&shared->stats.dropped),
+            (unsigned long long)atomic_load(&shared->stats.reordered),
+            (unsigned)seq.lost, (unsigned)seq.reordered, (unsigned)seq.duplicates,
+            (unsigned)rx.coalesced,
+            (unsigned long long)outputs.latched, (unsigned long long)outputs.backwards,
+            (unsigned long long)(outputs.latched ? outputs.latency_sum_us / outputs.latched : 0),
+            latency_p99_us(), outputs.latency_max_us,
+            rx.datagrams ? (double)(cpu_us() - cpu_start_us) / rx.datagrams : 0.0);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    loadgen_config_t config = {
+        .port = 6454,
+        .first_universe = CONFIG_ARTNET_UNIVERSE,
+        .universes = 2 * DMX_OUTPUT_COUNT,
+        .rate_hz = 44,
+        .slots = 512,
+        .sequence = true,
+        .seed = 1,
+        .duration_s = 10,
+    };
+    config.target_ip = inet_addr("127.0.0.1");
+    uint32_t interval_s = 60;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:i:n:r:s:l:o:b:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd': config.duration_s = atoi(optarg); break;
+            case 'i': interval_s = atoi(optarg); break;
+            case 'n': config.universes = atoi(optarg); break;
+            case 'r': config.rate_hz = atoi(optarg); break;
+            case 's': config.slots = atoi(optarg); break;
+            case 'l': config.loss = atof(optarg) / 100; break;
+            case 'o': config.reorder = atof(optarg) / 100; break;
+            case 'b': config.burst = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-i report seconds] [-n universes] "
+                        "[-r rate] [-s slots] [-l loss%%] [-o reorder%%] [-b burst]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (config.duration_s == 0 || interval_s == 0 || config.rate_hz == 0 ||
+            config.slots < LOADGEN_STAMP_LEN || config.slots > 512 || config.slots % 2)
+    {
+        fprintf(stderr, "need a duration, an interval, a rate and an even slot count of 8 to 512\n");
+        return 2;
+    }
+
+    host_log_level = ESP_LOG_WARN;
+    shared_t *shared = mmap(NULL, sizeof(shared_t), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    memset(shared, 0, sizeof(*shared));
+
+    dmx_buffer_init();
+    latency_reset();
+    artnet_task_start();
+    usleep(200000);
+    if (state == STATE_ERROR)
+    {
+        printf("Art-Net port %d not available, skipping\n", config.port);
+        return 77;
+    }
+
+    // The generator's CPU time stays out of the node's
+    pid_t child = fork();
+    if (child == 0)
+    {
+        config.duration_s = 0;
+        _exit(loadgen_run(&config, &shared->stats, &shared->stop) == 0 ? 0 : 1);
+    }
+
+    uint64_t cpu_start_us = cpu_us();
+    struct timespec start, next;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    next = start;
+    uint64_t period_ns = 1000000000ull / CONFIG_DMX_REFRESH_HZ;
+    uint64_t frames = (uint64_t)config.duration_s * CONFIG_DMX_REFRESH_HZ;
+    uint64_t report_every = (uint64_t)interval_s * CONFIG_DMX_REFRESH_HZ;
+
+    for (uint64_t frame = 1; frame <= frames; frame++)
+    {
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        latch_outputs();
+        if (frame % report_every == 0 && frame != frames)
+        {
+            report(shared, frame / CONFIG_DMX_REFRESH_HZ, cpu_start_us);
+        }
+    }
+
+    // Let the last datagrams in before the final count
+    atomic_store(&shared->stop, true);
+    waitpid(child, NULL, 0);
+    usleep(100000);
+    latch_outputs();
+    report(shared, config.duration_s, cpu_start_us);
+    host_log_level = ESP_LOG_INFO;
+    latency_log_summary();
+
+    rxbatch_stats_t rx;
+    rxbatch_get_stats(&rx);
+    uint64_t sent = atomic_load(&shared->stats.sent);
+    bool injected = config.loss > 0 || config.reorder > 0;
+    if (outputs.backwards != 0)
+    {
+        printf("FAIL: frames went backwards at the outputs\n");
+        return 1;
+    }
+    if (!injected && sent != rx.datagrams)
+    {
+        printf("FAIL: %lld datagrams went missing\n", (long long)(sent - rx.datagrams));
+        return 1;
+    }
+    if (outputs.latched == 0)
+    {
+        printf("FAIL: nothing reached the outputs\n");
+        return 1;
+    }
+    return 0;
+}
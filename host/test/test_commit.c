@@ -0,0 +1,293 @@
+// Drives one output's two merge sources through a random mix of whole
+// frame, partial and sparse writes, commits, latches and source changes,
+// in HTP and LTP mode and with a patch, and checks every latched frame
+// against a plain model of the work buffers. Whole frames written straight
+// into the triple buffer must never show differently from frames that went
+// through the work buffer. A short frame through a patch stays short.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_shim.h"
+
+#include "dmxtask.h"
+#include "merge.h"
+#include "patch.h"
+
+#define OUTPUT      1
+#define STEPS       50000
+
+typedef struct {
+    uint8_t work[513];
+    size_t len;
+    uint8_t committed[513];
+    size_t committed_len;
+} model_source_t;
+
+static model_source_t model[MERGE_SOURCES];
+static uint8_t model_owner[513];
+// Channel shown on slot n is n - model_shift. Ownership of a shifted
+// output's slots is taken on each commit.
+static size_t model_shift = 0;
+static uint8_t model_slot_owner[513];
+static uint8_t model_active = 0;
+static const uint32_t keys[MERGE_SOURCES] = { 0x0100000a, 0x0200000a };
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void model_reset(uint8_t source)
+{
+    memset(model[source].work, 0, 513);
+    model[source].len = 513;
+}
+
+static void model_write(uint8_t source, size_t first, const uint8_t *values, size_t count)
+{
+    model_source_t *m = &model[source];
+    if (merge_get_mode(OUTPUT) == MERGE_LTP && model_active != 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (m->work[first + i] != values[i])
+            {
+                model_owner[first + i] = source ? 0xff : 0x00;
+            }
+        }
+    }
+    memcpy(&m->work[first], values, count);
+    if (first + count > m->len)
+    {
+        m->len = first + count;
+    }
+}
+
+static void model_commit(uint8_t source)
+{
+    model_source_t *m = &model[source];
+    if (model_shift != 0 && merge_get_mode(OUTPUT) == MERGE_LTP)
+    {
+        for (size_t slot = 0; slot < 513; slot++)
+        {
+            model_slot_owner[slot] = slot > model_shift ? model_owner[slot - model_shift] : 0;
+        }
+    }
+    if (patch_active(OUTPUT))
+    {
+        m->committed_len = patch_gather(OUTPUT, m->committed, m->work, m->len);
+#if !CONFIG_DMX_ADAPTIVE_LENGTH
+        memset(&m->committed[m->committed_len], 0, 513 - m->committed_len);
+        m->committed_len = 513;
+#endif
+    }
+    else
+    {
+        memcpy(m->committed, m->work, m->len);
+        m->committed_len = m->len;
+    }
+    model_active |= 1 << source;
+}
+
+static void check_latch(void)
+{
+    size_t len;
+    const uint8_t *frame = dmx_buffer_latch(OUTPUT, &len);
+    if (model_active == 0)
+    {
+        return;
+    }
+    uint8_t expected[513] = { 0 };
+    size_t expected_len;
+    if (model_active != 0x03)
+    {
+        model_source_t *m = &model[model_active == 0x02 ? 1 : 0];
+        memcpy(expected, m->committed, m->committed_len);
+        expected_len = m->committed_len;
+    }
+    else
+    {
+        model_source_t *a = &model[0];
+        model_source_t *b = &model[1];
+        expected_len = a->committed_len > b->committed_len ? a->committed_len : b->committed_len;
+        for (size_t slot = 0; slot < expected_len; slot++)
+        {
+            uint8_t va = slot < a->committed_len ? a->committed[slot] : 0;
+            uint8_t vb = slot < b->committed_len ? b->committed[slot] : 0;
+            if (slot >= a->committed_len || slot >= b->committed_len)
+            {
+                expected[slot] = va | vb;
+            }
+            else if (merge_get_mode(OUTPUT) == MERGE_LTP)
+            {
+                uint8_t owner = model_shift != 0 ? model_slot_owner[slot] : model_owner[slot];
+                expected[slot] = owner ? vb : va;
+            }
+            else
+            {
+                expected[slot] = va > vb ? va : vb;
+            }
+        }
+    }
+    expected[0] = 0;
+    check(len == expected_len && memcmp(frame, expected, len) == 0, "latched frame differs from the model");
+}
+
+// A frame shorter than the patch through it: a curve alone keeps its
+// length, an offset makes it longer by as much, and a slot showing a
+// channel the source did not send does not make it longer
+static void check_short(uint16_t offset, uint8_t curve, size_t sent)
+{
+    uint8_t src[513] = { 0 };
+    uint8_t out[513];
+    memset(&src[1], 0xff, sent);
+    patch_unmap(OUTPUT, 1, 512);
+    patch_map(OUTPUT, 1 + offset, 1, 512 - offset, curve);
+    size_t len = patch_gather(OUTPUT, out, src, sent + 1);
+    check(len == offset + sent + 1, "patched short frame has the wrong length");
+    // Full level is full level through every built in curve
+    for (size_t slot = 1; slot < len; slot++)
+    {
+        uint8_t expected = slot > offset ? 0xff : 0x00;
+        check(out[slot] == expected, "patched short frame shows the wrong slots");
+    }
+    patch_map(OUTPUT, 400, 100, 1, curve);
+    len = patch_gather(OUTPUT, out, src, sent + 1);
+    check(len == offset + sent + 1, "unsent channel makes a patched frame longer");
+    patch_reset(OUTPUT);
+}
+
+static void claim(uint8_t source)
+{
+    int claimed = dmx_source_claim(OUTPUT, keys[source]);
+    check(claimed == source, "source claimed in the wrong slot");
+}
+
+static void step(uint8_t source)
+{
+    uint8_t values[512];
+    int op = rand() % 16;
+    if (op < 6)
+    {
+        // Mostly full frames, some short ones
+        size_t count = op < 4 ? 512 : 1 + rand() % 512;
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = rand() % 4 == 0 ? rand() : 0x40;
+        }
+        dmx_output_write_frame(OUTPUT, source, values, count);
+        model_write(source, 1, values, count);
+    }
+    else if (op < 8)
+    {
+        size_t first = 1 + rand() % 512;
+        size_t count = 1 + rand() % (513 - first);
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = rand();
+        }
+        dmx_output_write(OUTPUT, source, first, values, count);
+        model_write(source, first, values, count);
+    }
+    else if (op < 9)
+    {
+        uint16_t channels[8];
+        for (size_t i = 0; i < 8; i++)
+        {
+            channels[i] = 1 + rand() % 512;
+            values[i] = rand();
+        }
+        dmx_output_write_sparse(OUTPUT, source, channels, values, 8);
+        for (size_t i = 0; i < 8; i++)
+        {
+            model_write(source, channels[i], &values[i], 1);
+        }
+    }
+    else if (op < 13)
+    {
+        // Also commits with nothing new written since the last one
+        dmx_output_commit(OUTPUT, source);
+        model_commit(source);
+    }
+    else if (op < 15)
+    {
+        check_latch();
+    }
+    else if (rand() % 64 == 0)
+    {
+        // The sender goes away and the slot starts over
+        merge_release(OUTPUT, keys[source]);
+        model_active &= ~(1 << source);
+        claim(source);
+        model_reset(source);
+    }
+}
+
+static void run(const char *name, uint8_t sources)
+{
+    int before = failures;
+    for (int i = 0; i < STEPS; i++)
+    {
+        step(rand() % sources);
+    }
+    check_latch();
+    printf("%s: %s\n", name, failures == before ? "ok" : "FAILED");
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    srand(1);
+    dmx_buffer_init();
+    for (uint8_t source = 0; source < MERGE_SOURCES; source++)
+    {
+        claim(source);
+        model_reset(source);
+    }
+
+    run("one source", 1);
+    run("htp", 2);
+
+    merge_set_mode(OUTPUT, MERGE_LTP);
+    memcpy(model_owner, merge_ltp_owner(OUTPUT), sizeof(model_owner));
+    run("ltp", 2);
+    merge_set_mode(OUTPUT, MERGE_HTP);
+
+    // Every slot through a curve, then slots shifted up by 8
+    patch_map(OUTPUT, 1, 1, 512, PATCH_CURVE_SQUARE);
+    run("patched", 2);
+    patch_unmap(OUTPUT, 1, 512);
+    patch_map(OUTPUT, 9, 1, 504, PATCH_CURVE_LINEAR);
+    run("shifted", 1);
+    merge_set_mode(OUTPUT, MERGE_LTP);
+    memcpy(model_owner, merge_ltp_owner(OUTPUT), sizeof(model_owner));
+    model_shift = 8;
+    run("shifted ltp", 2);
+    model_shift = 0;
+    merge_set_mode(OUTPUT, MERGE_HTP);
+    patch_reset(OUTPUT);
+    run("unpatched again", 2);
+
+    int before = failures;
+    check_short(0, PATCH_CURVE_GAMMA, 24);
+    check_short(8, PATCH_CURVE_LINEAR, 24);
+    printf("short frame through a patch: %s\n", failures == before ? "ok" : "FAILED");
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("dmx commit ok\n");
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Runs the console's patch and merge commands and checks what the output
+// then transmits, and that malformed commands change nothing.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_shim.h"
+
+#include "control.h"
+#include "dmxtask.h"
+#include "merge.h"
+#include "patch.h"
+
+#define OUTPUT      1
+#define KEY         0x0100000a
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void run(const char *line, control_result_t expected)
+{
+    char what[96];
+    snprintf(what, sizeof(what), "'%s' gave the wrong result", line);
+    check(control_run(line) == expected, what);
+}
+
+// Channel n at n, so every slot tells which channel it shows
+static const uint8_t *send(size_t *len)
+{
+    uint8_t values[512];
+    for (size_t i = 0; i < sizeof(values); i++)
+    {
+        values[i] = i + 1;
+    }
+    int source = dmx_source_claim(OUTPUT, KEY);
+    dmx_output_write_frame(OUTPUT, source, values, sizeof(values));
+    dmx_output_commit(OUTPUT, source);
+    return dmx_buffer_latch(OUTPUT, len);
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+
+    size_t len;
+    const uint8_t *frame;
+
+    run("patch 1 9 1 504", CONTROL_OK);
+    frame = send(&len);
+    check(patch_active(OUTPUT) && frame[8] == 8 && frame[9] == 1 && frame[512] == (uint8_t)504,
+            "shifted patch not applied");
+
+    run("curve 3 128", CONTROL_OK);
+    run("patch 1 1 1 512 3", CONTROL_OK);
+    frame = send(&len);
+    check(frame[1] == 1 && frame[255] == 128, "user curve not applied");
+
+    run("unpatch 1 1 8", CONTROL_OK);
+    frame = send(&len);
+    check(frame[8] == 0 && frame[9] == 5, "slots not unpatched");
+
+    run("unpatch 1", CONTROL_OK);
+    frame = send(&len);
+    check(!patch_active(OUTPUT) && frame[9] == 9, "default patch not restored");
+
+    run("merge 1 ltp", CONTROL_OK);
+    check(merge_get_mode(OUTPUT) == MERGE_LTP, "merge mode not set");
+    run("merge 1 htp", CONTROL_OK);
+    check(merge_get_mode(OUTPUT) == MERGE_HTP, "merge mode not set back");
+
+    run("patch 1 9 1", CONTROL_FAILED);
+    run("patch 9 1 1 1", CONTROL_FAILED);
+    run("patch 1 500 1 20", CONTROL_FAILED);
+    run("patch 1 1 1 1 8", CONTROL_FAILED);
+    run("curve 2 100", CONTROL_FAILED);
+    run("merge 1 max", CONTROL_FAILED);
+    run("unpatch 1 1", CONTROL_FAILED);
+    run("stats", CONTROL_UNKNOWN);
+    check(!patch_active(OUTPUT) && merge_get_mode(OUTPUT) == MERGE_HTP,
+            "refused command changed something");
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("control ok\n");
+    return 0;
+}
@@ -0,0 +1,305 @@
+// Runs the DMX frame engine against a simulated UART and timer on a virtual
+// microsecond clock, with UART interrupts taking a while to be serviced, and
+// checks the line timing it produces: break and mark after break lengths,
+// break to break period, no gaps or underruns inside a frame and every
+// latched byte making it onto the wire in order.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "dmxframe.h"
+
+#define SLOT_US         44      // 11 bits at 250 kbaud
+#define FIFO_SIZE       128
+#define FIFO_THRESHOLD  16
+#define SIM_FRAMES      200
+#define IRQ_LATENCY_US  5       // UART interrupt entry to handler
+
+typedef struct {
+    uint64_t now;
+    bool timer_armed;
+    uint64_t timer_deadline;
+
+    uint8_t fifo[FIFO_SIZE];
+    size_t fifo_count;
+    bool shifting;
+    uint64_t shift_end;
+    bool refill_enabled;
+    bool done_enabled;
+    bool break_on;
+    bool irq_pending;
+    uint64_t irq_due;
+
+    // Frame source
+    uint8_t frame[513];
+    size_t frame_len;
+    uint32_t latched;
+
+    // What the line did during the current frame
+    uint64_t break_start;
+    uint64_t break_end;
+    uint64_t first_byte_start;
+    uint64_t last_byte_end;
+    size_t bytes_on_wire;
+    uint32_t frame_seq;
+    uint64_t prev_break_start;
+    uint32_t frames_checked;
+
+    const char *failure;
+} sim_t;
+
+static void fail(sim_t *sim, const char *what)
+{
+    if (sim->failure == NULL)
+    {
+        sim->failure = what;
+        printf("  at t=%llu us: %s\n", (unsigned long long)sim->now, what);
+    }
+}
+
+static void sim_set_break(void *ctx, bool on)
+{
+    sim_t *sim = ctx;
+    if (on && (sim->shifting || sim->fifo_count != 0))
+    {
+        fail(sim, "break while data is still shifting out");
+    }
+    sim->break_on = on;
+    if (on)
+    {
+        sim->break_start = sim->now;
+    }
+    else
+    {
+        sim->break_end = sim->now;
+    }
+}
+
+static void start_shift(sim_t *sim)
+{
+    if (sim->bytes_on_wire == 0)
+    {
+        sim->first_byte_start = sim->now;
+    }
+    else if (sim->now != sim->last_byte_end)
+    {
+        fail(sim, "gap between slots, FIFO underran");
+    }
+    sim->shifting = true;
+    sim->shift_end = sim->now + SLOT_US;
+}
+
+static size_t sim_fifo_write(void *ctx, const uint8_t *data, size_t len)
+{
+    sim_t *sim = ctx;
+    size_t n = FIFO_SIZE - sim->fifo_count;
+    if (len < n)
+    {
+        n = len;
+    }
+    if (sim->break_on)
+    {
+        fail(sim, "data queued during break");
+    }
+    memcpy(&sim->fifo[sim->fifo_count], data, n);
+    sim->fifo_count += n;
+    if (!sim->shifting && sim->fifo_count > 0)
+    {
+        start_shift(sim);
+    }
+    return n;
+}
+
+static void sim_enable_tx_events(void *ctx, bool refill, bool done)
+{
+    sim_t *sim = ctx;
+    sim->refill_enabled = refill;
+    sim->done_enabled = done;
+}
+
+static void sim_arm_timer(void *ctx, uint64_t deadline_us)
+{
+    sim_t *sim = ctx;
+    sim->timer_armed = true;
+    sim->timer_deadline = deadline_us;
+}
+
+static const uint8_t *sim_next_frame(void *ctx, size_t *len)
+{
+    sim_t *sim = ctx;
+    sim->latched++;
+    sim->frame[0] = 0;
+    for (size_t i = 1; i < sim->frame_len; i++)
+    {
+        sim->frame[i] = (uint8_t)(sim->latched + i);
+    }
+    *len = sim->frame_len;
+    return sim->frame;
+}
+
+static const dmx_frame_hal_t sim_hal = {
+    .set_break = sim_set_break,
+    .fifo_write = sim_fifo_write,
+    .enable_tx_events = sim_enable_tx_events,
+    .arm_timer = sim_arm_timer,
+    .next_frame = sim_next_frame,
+};
+
+static void check_frame(sim_t *sim, const dmx_frame_timing_t *timing, uint64_t expected_period)
+{
+    if (sim->break_end - sim->break_start < timing->break_us)
+    {
+        fail(sim, "break too short");
+    }
+    if (sim->first_byte_start - sim->break_end < timing->mab_us)
+    {
+        fail(sim, "mark after break too short");
+    }
+    if (sim->bytes_on_wire != sim->frame_len)
+    {
+        fail(sim, "wrong number of slots on the wire");
+    }
+    if (sim->prev_break_start != 0 &&
+            sim->break_start - sim->prev_break_start != expected_period)
+    {
+        fail(sim, "break to break period off");
+    }
+    sim->prev_break_start = sim->break_start;
+    sim->frames_checked++;
+}
+
+static bool run(uint32_t period_us, size_t slots, uint32_t break_us, uint32_t mab_us)
+{
+    static sim_t sim;
+    dmx_frame_engine_t engine;
+    dmx_frame_timing_t timing = {
+        .break_us = break_us,
+        .mab_us = mab_us,
+        .period_us = period_us,
+    };
+
+    memset(&sim, 0, sizeof(sim));
+    sim.now = 1000;
+    sim.frame_len = slots + 1;
+
+    // The last stop bit is only seen one interrupt latency later
+    uint64_t frame_time = break_us + mab_us + (uint64_t)sim.frame_len * SLOT_US
+        + IRQ_LATENCY_US;
+    uint64_t expected_period = frame_time > timing.period_us ? frame_time : timing.period_us;
+
+    dmx_frame_init(&engine, &sim_hal, &sim, &timing);
+    dmx_frame_start(&engine, sim.now);
+
+    while (engine.frames < SIM_FRAMES && sim.failure == NULL)
+    {
+        // Level triggered UART interrupts, serviced after a latency
+        bool refill = sim.refill_enabled && sim.fifo_count < FIFO_THRESHOLD;
+        bool done = sim.done_enabled && sim.fifo_count == 0 && !sim.shifting;
+        if (!refill && !done)
+        {
+            sim.irq_pending = false;
+        }
+        else if (!sim.irq_pending)
+        {
+            sim.irq_pending = true;
+            sim.irq_due = sim.now + IRQ_LATENCY_US;
+        }
+        if (sim.irq_pending && sim.irq_due <= sim.now)
+        {
+            sim.irq_pending = false;
+            if (done)
+            {
+                uint32_t frames = engine.frames;
+                dmx_frame_on_tx_done(&engine, sim.now);
+                if (engine.frames != frames)
+                {
+                    check_frame(&sim, &timing, expected_period);
+                    sim.bytes_on_wire = 0;
+                }
+            }
+            else
+            {
+                dmx_frame_on_fifo_empty(&engine, sim.now);
+            }
+            continue;
+        }
+
+        // Advance to whatever happens next: interrupt, wire or timer
+        uint64_t next = UINT64_MAX;
+        if (sim.irq_pending)
+        {
+            next = sim.irq_due;
+        }
+        if (sim.shifting && sim.shift_end < next)
+        {
+            next = sim.shift_end;
+        }
+        if (sim.timer_armed && sim.timer_deadline < next)
+        {
+            next = sim.timer_deadline;
+        }
+
+        if (next == UINT64_MAX)
+        {
+            fail(&sim, "engine stalled, nothing armed");
+        }
+        else if (sim.irq_pending && next == sim.irq_due)
+        {
+            sim.now = next;
+        }
+        else if (sim.shifting && next == sim.shift_end)
+        {
+            sim.now = sim.shift_end;
+            if (sim.fifo[0] != sim.frame[sim.bytes_on_wire])
+            {
+                fail(&sim, "slot value differs from latched frame");
+            }
+            memmove(sim.fifo, &sim.fifo[1], --sim.fifo_count);
+            sim.bytes_on_wire++;
+            sim.last_byte_end = sim.now;
+            sim.shifting = false;
+            if (sim.fifo_count > 0)
+            {
+                start_shift(&sim);
+            }
+        }
+        else
+        {
+            sim.now = sim.timer_deadline;
+            sim.timer_armed = false;
+            dmx_frame_on_timer(&engine, sim.now);
+        }
+    }
+
+    double hz = 1e6 / expected_period;
+    printf("%7u us target, %3zu slots, break %u us, MAB %u us: %u frames, "
+            "period %llu us (%.1f Hz) %s\n",
+            period_us, slots, break_us, mab_us, sim.frames_checked,
+            (unsigned long long)expected_period, hz,
+            sim.failure == NULL ? "ok" : "FAIL");
+    return sim.failure == NULL;
+}
+
+int main(void)
+{
+    bool ok = true;
+
+    // The old busy-wait worker timings, now at the configured rate
+    ok &= run(dmx_frame_period_us(40), 512, 184, 24);
+    // Full universe asked to go faster than the wire allows
+    ok &= run(dmx_frame_period_us(44), 512, 184, 24);
+    // Spec minimum break and mark after break
+    ok &= run(dmx_frame_period_us(44), 512, 92, 12);
+    // Short frames are bound by the period, not the wire
+    ok &= run(dmx_frame_period_us(44), 24, 176, 12);
+    ok &= run(dmx_frame_period_us(1), 512, 184, 24);
+    // Adaptive length: 24 channels at the 1204 us DMX512 minimum frame time
+    // are bound by the wire, 4 channels by the minimum frame time
+    ok &= run(1204, 24, 176, 12);
+    ok &= run(1204, 4, 92, 12);
+    ok &= run(1204, 0, 92, 12);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+// Feeds the DMX receiver a desk's output as the UART interrupt would hand it
+// over, in FIFO sized chunks between breaks, on a virtual microsecond clock,
+// and checks every frame arrives intact and that only changes and the
+// keepalive are sent on as ArtDmx. Also covers the framing corner cases:
+// alternate start codes, short and odd length frames, overruns and the
+// input going quiet.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dmxin.h"
+#include "dmxrx.h"
+
+#define FRAME_US        22700   // a full frame at 44 fps
+#define KEEPALIVE_US    1000000
+#define SIM_US          10000000
+#define FADE_START_US   2000000
+#define FADE_END_US     4000000
+#define PORT_ADDRESS    0x0123
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// A frame as it comes off the line, in the chunks the RX FIFO interrupts
+// would deliver
+static bool feed(dmx_rx_t *rx, const uint8_t *frame, size_t len, uint32_t now)
+{
+    bool published = dmx_rx_on_break(rx, now);
+    size_t done = 0;
+    while (done < len)
+    {
+        size_t chunk = 1 + rand() % 60;
+        if (chunk > len - done)
+        {
+            chunk = len - done;
+        }
+        published |= dmx_rx_on_data(rx, &frame[done], chunk);
+        done += chunk;
+    }
+    return published;
+}
+
+static void check_packet(const uint8_t *packet, size_t len, const uint8_t *frame, size_t frame_len)
+{
+    size_t length = packet[16] << 8 | packet[17];
+    check(memcmp(packet, "Art-Net\0\x00\x50\x00\x0e", 12) == 0, "bad ArtDmx header");
+    check(packet[14] == (PORT_ADDRESS & 0xff) && packet[15] == PORT_ADDRESS >> 8, "wrong Port-Address");
+    check(len == DMXIN_HEADER_LEN + length && length % 2 == 0 && length >= frame_len - 1,
+            "bad ArtDmx length");
+    check(memcmp(&packet[DMXIN_HEADER_LEN], &frame[1], frame_len - 1) == 0, "slots not sent as received");
+}
+
+static void test_desk_stream(void)
+{
+    dmx_rx_t rx;
+    dmxin_t in;
+    dmx_rx_init(&rx);
+    dmxin_init(&in, PORT_ADDRESS, KEEPALIVE_US);
+
+    uint8_t frame[513] = { 0 };
+    uint32_t changes = 0;
+    uint32_t sends = 0;
+    uint32_t last_send = 0;
+    uint32_t max_gap = 0;
+    uint8_t last_seq = 0;
+
+    for (uint32_t now = FRAME_US; now < SIM_US; now += FRAME_US)
+    {
+        // A fader moves for two seconds, the rest of the time the look is static
+        if (now >= FADE_START_US && now < FADE_END_US)
+        {
+            frame[7] = (now - FADE_START_US) * 255 / (FADE_END_US - FADE_START_US);
+            changes++;
+        }
+
+        check(feed(&rx, frame, sizeof(frame), now), "full frame not published");
+        size_t len;
+        uint32_t break_us;
+        const uint8_t *received = dmx_rx_take(&rx, &len, &break_us);
+        check(received != NULL && len == sizeof(frame) && break_us == now, "frame not taken");
+        if (received == NULL)
+        {
+            continue;
+        }
+        check(memcmp(received, frame, len) == 0, "frame corrupted");
+
+        size_t packet_len = dmxin_frame(&in, received, len, now);
+        if (packet_len != 0)
+        {
+            check_packet(in.packet, packet_len, frame, sizeof(frame));
+            check(in.packet[12] == (last_seq == 255 ? 1 : last_seq + 1), "sequence not incremented");
+            last_seq = in.packet[12];
+            if (sends != 0 && now - last_send > max_gap)
+            {
+                max_gap = now - last_send;
+            }
+            last_send = now;
+            sends++;
+        }
+    }
+
+    printf("desk stream: %u frames, %u changed, %u keepalives, %u suppressed, longest gap %u us\n",
+            (unsigned)in.stats.frames, (unsigned)in.stats.changed, (unsigned)in.stats.keepalives,
+            (unsigned)in.stats.suppressed, (unsigned)max_gap);
+    check(rx.stats.frames == in.stats.frames && rx.stats.errors == 0, "frames lost in the receiver");
+    // The first frame and every fader step that moved it
+    check(in.stats.changed <= changes + 1 && in.stats.changed > changes / 2, "changes not sent");
+    check(max_gap < KEEPALIVE_US + FRAME_US, "keepalive late");
+    // About one a second through the 8 static seconds
+    check(in.stats.keepalives >= 5 && in.stats.keepalives <= 8, "wrong keepalive count");
+    check(sends < in.stats.frames / 3, "unchanged frames not suppressed");
+}
+
+static void test_framing(void)
+{
+    dmx_rx_t rx;
+    dmxin_t in;
+    dmx_rx_init(&rx);
+    dmxin_init(&in, PORT_ADDRESS, KEEPALIVE_US);
+    size_t len;
+    uint32_t break_us;
+
+    // Nothing is captured before the first break
+    uint8_t frame[513] = { 0 };
+    check(!dmx_rx_on_data(&rx, frame, sizeof(frame)), "data before a break published");
+
+    // A short frame is only complete at the next break
+    frame[1] = 10;
+    frame[24] = 24;
+    check(!feed(&rx, frame, 25, 1000), "short frame published early");
+    check(dmx_rx_take(&rx, &len, &break_us) == NULL, "short frame taken early");
+    check(dmx_rx_on_break(&rx, 2000), "short frame not published at the break");
+    const uint8_t *received = dmx_rx_take(&rx, &len, &break_us);
+    check(received != NULL && len == 25 && break_us == 1000, "short frame wrong");
+
+    // 24 slots go out as is, 23 are padded to an even length
+    size_t packet_len = dmxin_frame(&in, received, len, 2000);
+    check(packet_len == DMXIN_HEADER_LEN + 24, "short frame length");
+    check_packet(in.packet, packet_len, frame, 25);
+    frame[23] = 23;
+    dmx_rx_on_data(&rx, frame, 24);
+    dmx_rx_on_break(&rx, 4000);
+    received = dmx_rx_take(&rx, &len, &break_us);
+    packet_len = dmxin_frame(&in, received, len, 4000);
+    check(packet_len == DMXIN_HEADER_LEN + 24 && in.packet[DMXIN_HEADER_LEN + 23] == 0,
+            "odd frame not padded");
+
+    // Alternate start codes, runts and overruns are dropped
+    uint8_t text[32] = { 0x17, 'h', 'i' };
+    dmx_rx_on_data(&rx, text, sizeof(text));
+    check(!dmx_rx_on_break(&rx, 6000), "alternate start code published");
+    dmx_rx_on_data(&rx, frame, 1);
+    check(!dmx_rx_on_break(&rx, 7000), "runt published");
+    dmx_rx_on_data(&rx, frame, 100);
+    dmx_rx_on_error(&rx);
+    dmx_rx_on_data(&rx, frame, 100);
+    check(!dmx_rx_on_break(&rx, 8000), "frame with an overrun published");
+    check(dmx_rx_take(&rx, &len, &break_us) == NULL, "dropped frame taken");
+    check(rx.stats.alternate == 1 && rx.stats.runts == 1 && rx.stats.errors == 1,
+            "dropped frames not counted");
+
+    // Only the newest of several frames is taken
+    for (uint8_t i = 1; i <= 3; i++)
+    {
+        frame[1] = i;
+        feed(&rx, frame, sizeof(frame), 10000 * i);
+    }
+    received = dmx_rx_take(&rx, &len, &break_us);
+    check(received != NULL && received[1] == 3 && break_us == 30000, "newest frame not taken");
+}
+
+static void test_input_loss(void)
+{
+    dmxin_t in;
+    dmxin_init(&in, PORT_ADDRESS, KEEPALIVE_US);
+    uint8_t frame[513] = { 0 };
+
+    check(dmxin_next_due(&in, 0) == UINT32_MAX, "keepalive due before any input");
+    check(dmxin_frame(&in, frame, sizeof(frame), 1000) != 0, "first frame not sent");
+    check(dmxin_next_due(&in, 1000) == KEEPALIVE_US, "wrong keepalive time");
+    check(dmxin_poll(&in, 500000) == 0, "keepalive early");
+    check(dmxin_poll(&in, 1001000) != 0, "keepalive not sent");
+
+    // The line went quiet at 1 ms, sending stops once that counts as loss
+    uint32_t due = dmxin_next_due(&in, 1001000);
+    check(due == DMXIN_LOSS_US + 1000 - 1001000, "loss not scheduled");
+    check(dmxin_poll(&in, 1001000 + due) == 0 && !dmxin_live(&in), "input loss not detected");
+    check(dmxin_next_due(&in, 3000000) == UINT32_MAX && dmxin_poll(&in, 3000000) == 0,
+            "keepalive after input loss");
+
+    // The same look coming back is sent at once
+    check(dmxin_frame(&in, frame, sizeof(frame), 4000000) != 0, "returning input not sent");
+    check(in.stats.losses == 1 && in.stats.keepalives == 2, "loss counted wrong");
+}
+
+int main(void)
+{
+    srand(1);
+
+    test_desk_stream();
+    test_framing();
+    test_input_loss();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("dmx input ok\n");
+    return 0;
+}
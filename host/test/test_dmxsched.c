@@ -0,0 +1,380 @@
+// Runs several DMX ports off the one scheduler timer against simulated
+// UARTs on a virtual microsecond clock, as dmxtask.c drives UART2 and
+// UART1. Every port is held to the line timing test_dmxframe checks for a
+// single one: break and mark after break lengths, break to break period,
+// no gaps inside a frame and every latched byte on the wire in order. On
+// top the breaks have to stay staggered by their share of the period, so
+// the ports overlap on the wire instead of refilling their FIFOs at the
+// same moments.
+//
+// Reports the slots per second all ports put on the wire and the host CPU
+// time spent in each port's engine and its share of the timer.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "dmxframe.h"
+#include "dmxsched.h"
+
+#define SLOT_US         44      // 11 bits at 250 kbaud
+#define FIFO_SIZE       128
+#define FIFO_THRESHOLD  16
+#define SIM_FRAMES      200
+#define IRQ_LATENCY_US  5       // UART interrupt entry to handler
+
+typedef struct {
+    uint8_t index;
+    dmx_frame_engine_t engine;
+
+    uint8_t fifo[FIFO_SIZE];
+    size_t fifo_count;
+    bool shifting;
+    uint64_t shift_end;
+    bool refill_enabled;
+    bool done_enabled;
+    bool break_on;
+    bool irq_pending;
+    uint64_t irq_due;
+
+    uint8_t frame[513];
+    size_t frame_len;
+    uint32_t latched;
+
+    uint64_t break_start;
+    uint64_t break_end;
+    uint64_t first_byte_start;
+    uint64_t last_byte_end;
+    size_t bytes_on_wire;
+    uint64_t prev_break_start;
+    uint64_t first_break;
+    uint32_t frames_checked;
+    uint64_t slots;
+    uint64_t cpu_ns;
+} port_t;
+
+static uint64_t now;
+static bool timer_armed;
+static uint64_t timer_deadline;
+static uint32_t timer_arms;
+static dmx_sched_t sched;
+static port_t ports[DMX_SCHED_PORTS];
+static const char *failure;
+
+static void fail(port_t *port, const char *what)
+{
+    if (failure == NULL)
+    {
+        failure = what;
+        printf("  port %u at t=%llu us: %s\n", port->index, (unsigned long long)now, what);
+    }
+}
+
+static void sim_set_break(void *ctx, bool on)
+{
+    port_t *port = ctx;
+    if (on && (port->shifting || port->fifo_count != 0))
+    {
+        fail(port, "break while data is still shifting out");
+    }
+    port->break_on = on;
+    if (on)
+    {
+        port->break_start = now;
+    }
+    else
+    {
+        port->break_end = now;
+    }
+}
+
+static void start_shift(port_t *port)
+{
+    if (port->bytes_on_wire == 0)
+    {
+        port->first_byte_start = now;
+    }
+    else if (now != port->last_byte_end)
+    {
+        fail(port, "gap between slots, FIFO underran");
+    }
+    port->shifting = true;
+    port->shift_end = now + SLOT_US;
+}
+
+static size_t sim_fifo_write(void *ctx, const uint8_t *data, size_t len)
+{
+    port_t *port = ctx;
+    size_t n = FIFO_SIZE - port->fifo_count;
+    if (len < n)
+    {
+        n = len;
+    }
+    if (port->break_on)
+    {
+        fail(port, "data queued during break");
+    }
+    memcpy(&port->fifo[port->fifo_count], data, n);
+    port->fifo_count += n;
+    if (!port->shifting && port->fifo_count > 0)
+    {
+        start_shift(port);
+    }
+    return n;
+}
+
+static void sim_enable_tx_events(void *ctx, bool refill, bool done)
+{
+    port_t *port = ctx;
+    port->refill_enabled = refill;
+    port->done_enabled = done;
+}
+
+static void sim_arm_port(void *ctx, uint64_t deadline_us)
+{
+    port_t *port = ctx;
+    dmx_sched_arm(&sched, port->index, deadline_us);
+}
+
+static void sim_arm_timer(void *ctx, uint64_t deadline_us)
+{
+    timer_armed = true;
+    timer_deadline = deadline_us;
+    timer_arms++;
+}
+
+static const uint8_t *sim_next_frame(void *ctx, size_t *len)
+{
+    port_t *port = ctx;
+    port->latched++;
+    port->frame[0] = 0;
+    for (size_t i = 1; i < port->frame_len; i++)
+    {
+        port->frame[i] = (uint8_t)(port->latched + i + port->index);
+    }
+    *len = port->frame_len;
+    return port->frame;
+}
+
+static const dmx_frame_hal_t sim_hal = {
+    .set_break = sim_set_break,
+    .fifo_write = sim_fifo_write,
+    .enable_tx_events = sim_enable_tx_events,
+    .arm_timer = sim_arm_port,
+    .next_frame = sim_next_frame,
+};
+
+// break_start and break_end are the frame's own, the next break may have
+// begun already when the engine saw the frame finish
+static void check_frame(port_t *port, const dmx_frame_timing_t *timing, uint64_t expected_period,
+        uint64_t offset, uint64_t break_start, uint64_t break_end)
+{
+    if (break_end - break_start < timing->break_us)
+    {
+        fail(port, "break too short");
+    }
+    if (port->first_byte_start - break_end < timing->mab_us)
+    {
+        fail(port, "mark after break too short");
+    }
+    if (port->bytes_on_wire != port->frame_len)
+    {
+        fail(port, "wrong number of slots on the wire");
+    }
+    if (port->prev_break_start != 0 &&
+            break_start - port->prev_break_start != expected_period)
+    {
+        fail(port, "break to break period off");
+    }
+    // Against port 0's frame of the same number
+    if (break_start - ports[0].first_break - (uint64_t)port->frames_checked * expected_period
+            != offset)
+    {
+        fail(port, "break not staggered");
+    }
+    port->slots += port->bytes_on_wire;
+    port->prev_break_start = break_start;
+    port->frames_checked++;
+}
+
+// Services the port's UART interrupt if it is due, true if it was
+static bool service_uart(port_t *port, const dmx_frame_timing_t *timing,
+        uint64_t expected_period, uint64_t offset)
+{
+    bool refill = port->refill_enabled && port->fifo_count < FIFO_THRESHOLD;
+    bool done = port->done_enabled && port->fifo_count == 0 && !port->shifting;
+    if (!refill && !done)
+    {
+        port->irq_pending = false;
+        return false;
+    }
+    if (!port->irq_pending)
+    {
+        port->irq_pending = true;
+        port->irq_due = now + IRQ_LATENCY_US;
+    }
+    if (port->irq_due > now)
+    {
+        return false;
+    }
+
+    port->irq_pending = false;
+    uint64_t break_start = port->break_start;
+    uint64_t break_end = port->break_end;
+    uint64_t start = bench_now_ns();
+    uint32_t frames = port->engine.frames;
+    if (done)
+    {
+        dmx_frame_on_tx_done(&port->engine, now);
+    }
+    else
+    {
+        dmx_frame_on_fifo_empty(&port->engine, now);
+    }
+    port->cpu_ns += bench_now_ns() - start;
+    if (port->engine.frames != frames)
+    {
+        check_frame(port, timing, expected_period, offset, break_start, break_end);
+        port->bytes_on_wire = 0;
+    }
+    return true;
+}
+
+static void shift_byte(port_t *port)
+{
+    if (port->fifo[0] != port->frame[port->bytes_on_wire])
+    {
+        fail(port, "slot value differs from latched frame");
+    }
+    memmove(port->fifo, &port->fifo[1], --port->fifo_count);
+    port->bytes_on_wire++;
+    port->last_byte_end = now;
+    port->shifting = false;
+    if (port->fifo_count > 0)
+    {
+        start_shift(port);
+    }
+}
+
+static bool run(uint8_t count, uint32_t period_us, size_t slots)
+{
+    dmx_frame_timing_t timing = {
+        .break_us = 184,
+        .mab_us = 24,
+        .period_us = period_us,
+    };
+    uint64_t frame_time = timing.break_us + timing.mab_us + (uint64_t)(slots + 1) * SLOT_US
+        + IRQ_LATENCY_US;
+    uint64_t expected_period = frame_time > period_us ? frame_time : period_us;
+
+    now = 1000;
+    timer_armed = false;
+    timer_arms = 0;
+    failure = NULL;
+    dmx_sched_init(&sched, sim_arm_timer, NULL);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        port_t *port = &ports[i];
+        memset(port, 0, sizeof(*port));
+        port->index = i;
+        port->frame_len = slots + 1;
+        dmx_frame_init(&port->engine, &sim_hal, port, &timing);
+        dmx_sched_add(&sched, &port->engine);
+    }
+    dmx_sched_start(&sched, now, period_us);
+    ports[0].first_break = ports[0].break_start;
+
+    while (ports[count - 1].frames_checked < SIM_FRAMES && failure == NULL)
+    {
+        bool serviced = false;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            serviced |= service_uart(&ports[i], &timing, expected_period,
+                    (uint64_t)period_us * i / count);
+        }
+        if (serviced)
+        {
+            continue;
+        }
+
+        // Advance to whatever happens next: an interrupt, a wire or the timer
+        uint64_t next = timer_armed ? timer_deadline : UINT64_MAX;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (ports[i].irq_pending && ports[i].irq_due < next)
+            {
+                next = ports[i].irq_due;
+            }
+            if (ports[i].shifting && ports[i].shift_end < next)
+            {
+                next = ports[i].shift_end;
+            }
+        }
+        if (next == UINT64_MAX)
+        {
+            fail(&ports[0], "stalled, nothing armed");
+            break;
+        }
+        now = next;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (ports[i].shifting && ports[i].shift_end == now)
+            {
+                shift_byte(&ports[i]);
+            }
+        }
+        if (timer_armed && timer_deadline == now)
+        {
+            timer_armed = false;
+            uint8_t due = 0;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                due |= (sched.deadline_us[i] <= now) << i;
+            }
+            uint64_t start = bench_now_ns();
+            dmx_sched_on_timer(&sched, now);
+            uint64_t elapsed = bench_now_ns() - start;
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (due & 1 << i)
+                {
+                    ports[i].cpu_ns += elapsed / __builtin_popcount(due);
+                }
+            }
+        }
+    }
+
+    uint64_t wire_us = now - 1000;
+    uint32_t frames = ports[count - 1].frames_checked ? ports[count - 1].frames_checked : 1;
+    uint64_t total = 0;
+    printf("%u port%s, %5u us target, %3zu slots: ", count, count > 1 ? "s" : " ",
+            period_us, slots);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        total += ports[i].slots;
+    }
+    printf("%.0f slots/s, %u timer alarms a frame, CPU a frame per port:",
+            total * 1e6 / wire_us, (unsigned)(timer_arms / frames));
+    for (uint8_t i = 0; i < count; i++)
+    {
+        printf(" %.0f ns", (double)ports[i].cpu_ns / frames);
+    }
+    printf(" %s\n", failure == NULL ? "ok" : "FAIL");
+    return failure == NULL;
+}
+
+int main(void)
+{
+    bool ok = true;
+    for (uint8_t count = 1; count <= DMX_SCHED_PORTS; count++)
+    {
+        ok &= run(count, dmx_frame_period_us(40), 512);
+        // Bound by the wire, the stagger has to hold without any slack
+        ok &= run(count, dmx_frame_period_us(44), 512);
+        // Short frames, the timer is busier than the UARTs
+        ok &= run(count, 1204, 24);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Checks the fade stage: the blend kernel against the obvious byte loop at
+// every weight, a fade that is halfway at half the received interval, and
+// a frame that gets shorter, whose dropped slots fade out and then leave
+// the output.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_shim.h"
+
+#include "control.h"
+#include "dmxtask.h"
+#include "fade.h"
+
+#define OUTPUT      0
+#define INTERVAL_US 40000
+
+static uint8_t from[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t to[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t out[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t ref[DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void test_blend(void)
+{
+    int before = failures;
+    srand(1);
+    for (size_t i = 0; i < DMX_FRAME_STRIDE; i++)
+    {
+        from[i] = rand();
+        to[i] = rand();
+    }
+    for (uint16_t weight = 0; weight <= 256; weight++)
+    {
+        fade_blend(out, from, to, weight, 513);
+        for (size_t i = 0; i < 513; i++)
+        {
+            ref[i] = (from[i] * (256 - weight) + to[i] * weight) / 256;
+        }
+        if (memcmp(out, ref, 513) != 0)
+        {
+            check(false, "fade_blend disagrees with the byte loop");
+            break;
+        }
+    }
+    fade_blend(out, from, to, 0, 513);
+    check(memcmp(out, from, 513) == 0, "fade_blend does not start at the source");
+    fade_blend(out, from, to, 256, 513);
+    check(memcmp(out, to, 513) == 0, "fade_blend does not reach the target");
+    printf("blend: %s\n", failures == before ? "ok" : "FAILED");
+}
+
+static void frame_of(uint8_t *frame, uint8_t level, size_t len)
+{
+    frame[0] = 0x00;
+    memset(&frame[1], level, len - 1);
+}
+
+// Time is simulated, frames every INTERVAL_US
+static void test_apply(void)
+{
+    int before = failures;
+    static uint8_t dark[513], bright[513];
+    frame_of(dark, 0x00, 513);
+    frame_of(bright, 0xff, 513);
+    check(control_run("fade 0 auto") == CONTROL_OK && fade_enabled(OUTPUT),
+            "fade not turned on");
+
+    uint32_t now_us = 0;
+    size_t len;
+    for (int frame = 0; frame < 8; frame++)
+    {
+        now_us += INTERVAL_US;
+        len = 513;
+        fade_apply(OUTPUT, frame & 1 ? bright : dark, &len, true, now_us);
+    }
+    len = 513;
+    uint8_t mid = fade_apply(OUTPUT, bright, &len, false, now_us + INTERVAL_US / 2)[1];
+    check(mid >= 0x70 && mid <= 0x90, "fade is not halfway at half the interval");
+
+    // 512 bright slots followed by a 24 slot frame
+    static uint8_t short_frame[25];
+    frame_of(short_frame, 0x40, sizeof(short_frame));
+    now_us += INTERVAL_US;
+    len = sizeof(short_frame);
+    const uint8_t *frame = fade_apply(OUTPUT, short_frame, &len, true, now_us);
+    check(len == 513, "dropped slots do not fade out");
+    len = sizeof(short_frame);
+    frame = fade_apply(OUTPUT, short_frame, &len, false, now_us + INTERVAL_US / 2);
+    check(len == 513 && frame[100] > 0 && frame[100] < 0xff, "dropped slots not mid-fade");
+    len = sizeof(short_frame);
+    frame = fade_apply(OUTPUT, short_frame, &len, false, now_us + 2 * INTERVAL_US);
+    check(len == sizeof(short_frame) && frame[24] == 0x40, "frame did not shrink once settled");
+
+    check(control_run("fade 0 500") == CONTROL_OK && fade_enabled(OUTPUT),
+            "fixed fade not set");
+    check(control_run("fade 0 off") == CONTROL_OK && !fade_enabled(OUTPUT),
+            "fade not turned off");
+    check(control_run("fade 0 slow") == CONTROL_FAILED, "bad fade time accepted");
+    printf("apply: %s\n", failures == before ? "ok" : "FAILED");
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+
+    test_blend();
+    test_apply();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("fade ok\n");
+    return 0;
+}
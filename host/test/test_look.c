@@ -0,0 +1,215 @@
+// Checks the power on look: when the save policy writes to flash while a
+// desk fades, holds and runs a chase or the flash write fails, that a
+// restored look is on the wire from the first latch and hands over to a
+// live source without being merged into it, and that snapshots match what
+// the output transmits.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_shim.h"
+
+#include "dmxtask.h"
+#include "look.h"
+#include "merge.h"
+
+#define CHECK_MS        1000
+#define INTERVAL_MS     60000
+#define KEY_A           0x0100000a
+#define KEY_B           0x0200000a
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Runs the tracker over a stretch of time, look(t) giving the look at each
+// check, and returns how many saves it asked for
+typedef void (*look_fn)(uint8_t *frame, uint32_t now_ms);
+
+static uint32_t run(look_tracker_t *tracker, look_fn look, uint32_t from_ms, uint32_t to_ms,
+        uint32_t *last_save_ms)
+{
+    uint8_t frame[513];
+    uint32_t saves = 0;
+    for (uint32_t now = from_ms; now < to_ms; now += CHECK_MS)
+    {
+        look(frame, now);
+        if (look_tracker_check(tracker, frame, sizeof(frame), now))
+        {
+            look_tracker_saved(tracker, true, now);
+            saves++;
+            *last_save_ms = now;
+        }
+    }
+    return saves;
+}
+
+static void look_static(uint8_t *frame, uint32_t now_ms)
+{
+    memset(frame, 0, 513);
+    frame[1] = 200;
+}
+
+// A five second fade starting at 10 s, then still
+static void look_fade(uint8_t *frame, uint32_t now_ms)
+{
+    look_static(frame, now_ms);
+    uint32_t t = now_ms < 10000 ? 0 : now_ms > 15000 ? 5000 : now_ms - 10000;
+    frame[2] = t * 255 / 5000;
+}
+
+// A step every three seconds
+static void look_chase(uint8_t *frame, uint32_t now_ms)
+{
+    memset(frame, 0, 513);
+    frame[1 + (now_ms / 3000) % 8] = 255;
+}
+
+static void test_save_policy(void)
+{
+    look_tracker_t tracker;
+    uint8_t frame[513];
+    uint32_t last_save = 0;
+
+    // Coming back up with the stored look changes nothing
+    look_static(frame, 0);
+    look_tracker_init(&tracker, look_hash(frame, sizeof(frame)), INTERVAL_MS, 0);
+    check(run(&tracker, look_static, 0, 120000, &last_save) == 0, "unchanged look saved");
+
+    // A fade is saved once, when it has held still for the settle time
+    look_tracker_init(&tracker, look_hash(frame, sizeof(frame)), INTERVAL_MS, 0);
+    uint32_t saves = run(&tracker, look_fade, 0, 120000, &last_save);
+    check(saves == 1, "fade not saved exactly once");
+    check(last_save >= 15000 + LOOK_SETTLE_MS && last_save <= 15000 + LOOK_SETTLE_MS + CHECK_MS,
+            "fade not saved once settled");
+
+    // Steps that each hold past the settle time are rate limited
+    saves = run(&tracker, look_chase, 120000, 720000, &last_save);
+    printf("chase: %u saves in 10 minutes\n", (unsigned)saves);
+    check(saves >= 9 && saves <= 10, "chase saves not rate limited");
+
+    // A failed write is tried again once the interval is up, not before
+    look_tracker_init(&tracker, 0, INTERVAL_MS, 0);
+    uint32_t tries = 0;
+    uint32_t last_try = 0;
+    for (uint32_t now = 0; now < 3 * INTERVAL_MS; now += CHECK_MS)
+    {
+        look_static(frame, now);
+        if (look_tracker_check(&tracker, frame, sizeof(frame), now))
+        {
+            check(tries == 0 || now - last_try >= INTERVAL_MS, "failed write retried too soon");
+            // The first two writes fail
+            look_tracker_saved(&tracker, tries >= 2, now);
+            tries++;
+            last_try = now;
+        }
+    }
+    check(tries == 3, "failed write not retried");
+
+    // Changes every check never settle
+    look_tracker_init(&tracker, 0, INTERVAL_MS, 0);
+    for (uint32_t now = 0; now < 60000; now += CHECK_MS)
+    {
+        memset(frame, 0, sizeof(frame));
+        frame[1] = now / CHECK_MS;
+        check(!look_tracker_check(&tracker, frame, sizeof(frame), now), "moving look saved");
+    }
+}
+
+static bool latched(uint8_t output, const uint8_t *expected, size_t expected_len)
+{
+    size_t len;
+    const uint8_t *frame = dmx_buffer_latch(output, &len);
+    return len == expected_len && memcmp(frame, expected, len) == 0;
+}
+
+static void test_takeover(void)
+{
+    uint8_t look[513] = { 0 };
+    uint8_t live[513] = { 0 };
+    uint8_t snapshot[DMX_FRAME_STRIDE];
+    memset(&look[1], 0xc0, 512);
+    memset(&live[1], 0x10, 512);
+
+    look_apply(0, look, sizeof(look));
+    check(latched(0, look, sizeof(look)), "restored look not latched");
+    check(dmx_output_snapshot(0, snapshot) == 513 && memcmp(snapshot, look, 513) == 0,
+            "restored look not in the snapshot");
+
+    // Claiming the output lets go of the look, which stays up until the
+    // live source commits and is not merged into it after
+    int source = dmx_source_claim(0, KEY_A);
+    check(source >= 0, "live source not claimed");
+    check(latched(0, look, sizeof(look)), "look dropped before live data");
+    check(dmx_output_snapshot(0, snapshot) == 0, "look still saved once let go");
+    dmx_output_write_frame(0, source, &live[1], 512);
+    dmx_output_commit(0, source);
+    check(latched(0, live, sizeof(live)), "live data merged with the look");
+    check(dmx_output_snapshot(0, snapshot) == 513 && memcmp(snapshot, live, 513) == 0,
+            "live data not in the snapshot");
+}
+
+static void test_snapshot_merge(void)
+{
+    uint8_t a[513] = { 0 };
+    uint8_t b[257] = { 0 };
+    uint8_t snapshot[DMX_FRAME_STRIDE];
+    for (size_t i = 1; i < sizeof(a); i++)
+    {
+        a[i] = i * 7;
+    }
+    for (size_t i = 1; i < sizeof(b); i++)
+    {
+        b[i] = i * 13;
+    }
+
+    for (int ltp = 0; ltp < 2; ltp++)
+    {
+        merge_set_mode(1, ltp ? MERGE_LTP : MERGE_HTP);
+        int source_a = dmx_source_claim(1, KEY_A);
+        int source_b = dmx_source_claim(1, KEY_B);
+        dmx_output_write_frame(1, source_a, &a[1], 512);
+        dmx_output_commit(1, source_a);
+        dmx_output_write(1, source_b, 1, &b[1], 256);
+        dmx_output_commit(1, source_b);
+        // Moves a few channels so LTP hands them to b
+        b[3]++;
+        b[200]++;
+        dmx_output_write(1, source_b, 1, &b[1], 256);
+        dmx_output_commit(1, source_b);
+
+        size_t len;
+        const uint8_t *frame = dmx_buffer_latch(1, &len);
+        check(dmx_output_snapshot(1, snapshot) == len && memcmp(snapshot, frame, len) == 0,
+                ltp ? "LTP snapshot differs from the output" : "HTP snapshot differs from the output");
+        merge_release(1, KEY_A);
+        merge_release(1, KEY_B);
+    }
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+
+    test_save_policy();
+    test_takeover();
+    test_snapshot_merge();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("look ok\n");
+    return 0;
+}
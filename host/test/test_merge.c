@@ -0,0 +1,115 @@
+// Checks merge source timeouts: of two sources on an output, the one that
+// goes silent loses its slot after MERGE_SOURCE_TIMEOUT_MS even while the
+// other keeps sending, its values leave the output and a new source can
+// take the slot. Locally written values never time out.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_shim.h"
+
+#include "dmxtask.h"
+#include "merge.h"
+
+#define OUTPUT      1
+#define KEY_A       0x0100000a
+#define KEY_B       0x0200000a
+#define KEY_C       0x0300000a
+#define STEP_MS     500
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static int send(uint32_t key, uint8_t channel, uint8_t value)
+{
+    int source = dmx_source_claim(OUTPUT, key);
+    if (source >= 0)
+    {
+        uint8_t values[512] = { 0 };
+        values[channel - 1] = value;
+        dmx_output_write_frame(OUTPUT, source, values, sizeof(values));
+        dmx_output_commit(OUTPUT, source);
+    }
+    return source;
+}
+
+static uint8_t latched(uint8_t channel)
+{
+    size_t len;
+    const uint8_t *frame = dmx_buffer_latch(OUTPUT, &len);
+    return channel < len ? frame[channel] : 0;
+}
+
+// Source A keeps sending through the whole stretch, B only at its start
+static void test_silent_source(bool second_silent)
+{
+    uint32_t live = second_silent ? KEY_A : KEY_B;
+    uint8_t live_channel = second_silent ? 1 : 2;
+    uint8_t silent_channel = second_silent ? 2 : 1;
+    int before = failures;
+
+    check(send(KEY_A, 1, 100) == 0, "first source not in slot 0");
+    check(send(KEY_B, 2, 200) == 1, "second source not in slot 1");
+    check(merge_active(OUTPUT) == 0x03 && latched(1) == 100 && latched(2) == 200,
+            "two sources not merged");
+
+    for (uint32_t ms = 0; ms <= MERGE_SOURCE_TIMEOUT_MS + STEP_MS; ms += STEP_MS)
+    {
+        host_tick_offset += STEP_MS;
+        send(live, live_channel, live_channel == 1 ? 100 : 200);
+    }
+    int slot = second_silent ? 1 : 0;
+    check(!(merge_active(OUTPUT) & 1 << slot), "silent source still active");
+    check(latched(silent_channel) == 0, "silent source still on the output");
+    check(latched(live_channel) != 0, "live source lost");
+    check(send(KEY_C, 3, 50) == slot, "new source did not take the silent one's slot");
+
+    merge_release(OUTPUT, KEY_A);
+    merge_release(OUTPUT, KEY_B);
+    merge_release(OUTPUT, KEY_C);
+    printf("%s source silent: %s\n", second_silent ? "second" : "first",
+            failures == before ? "ok" : "FAILED");
+}
+
+// The TCP server and CLI write only when something changes
+static void test_local_source(void)
+{
+    int before = failures;
+    check(send(MERGE_KEY_LOCAL, 1, 100) == 0, "local source not in slot 0");
+    host_tick_offset += MERGE_SOURCE_TIMEOUT_MS + STEP_MS;
+    check(send(KEY_A, 2, 200) == 1, "network source not in slot 1");
+    check(merge_active(OUTPUT) == 0x03 && latched(1) == 100,
+            "local source timed out");
+
+    merge_release(OUTPUT, MERGE_KEY_LOCAL);
+    merge_release(OUTPUT, KEY_A);
+    printf("local source idle: %s\n", failures == before ? "ok" : "FAILED");
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+
+    test_silent_source(true);
+    test_silent_source(false);
+    test_local_source();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("merge timeout ok\n");
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Checks the WS2812 encoder against a bit at a time reference: item timing
+// and level bits, GRB order on the wire, a strip spanning universes fed
+// through ingest and the output latch like pixeltask.c does, dark pixels
+// past the end of short frames and the reset item ending every frame.
+// Then measures encoding a universe of 170 pixels, which has to stay far
+// below the 5.1 ms the strip takes to shift it in.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "ingest.h"
+#include "pixel.h"
+
+#define STRIP           400     // three universes, the last one partly
+#define FIRST_OUTPUT    1
+#define WIRE_NS         ((uint64_t)PIXEL_ITEMS(PIXEL_PER_UNIVERSE) * PIXEL_ITEM_NS)
+
+static pixel_item_t items[PIXEL_ITEMS(STRIP)];
+static pixel_item_t expected[PIXEL_ITEMS(STRIP)];
+
+// One item per bit, most significant first, in G, R, B order
+static size_t reference_encode(pixel_item_t *out, const uint8_t *rgb, size_t count)
+{
+    static const int order[3] = { 1, 0, 2 };
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            uint8_t value = rgb[i * 3 + order[c]];
+            for (int bit = 7; bit >= 0; bit--)
+            {
+                bool one = value >> bit & 1;
+                out[n++] = (one ? PIXEL_T1H : PIXEL_T0H) | 1u << 15 |
+                    (uint32_t)(one ? PIXEL_T1L : PIXEL_T0L) << 16;
+            }
+        }
+    }
+    return n;
+}
+
+// Both halves low, together at least the latch time
+static bool check_reset(void)
+{
+    pixel_item_t reset = PIXEL_ITEM_RESET;
+    uint32_t ticks = (reset & 0x7fff) + (reset >> 16 & 0x7fff);
+    if (reset & (1u << 15 | 1u << 31) || ticks * 25 < PIXEL_RESET_US * 1000)
+    {
+        printf("FAIL: reset item is not %d us low\n", PIXEL_RESET_US);
+        return false;
+    }
+    return true;
+}
+
+static bool check_bytes(void)
+{
+    uint8_t rgb[256 * 3];
+    for (int i = 0; i < 256 * 3; i++)
+    {
+        rgb[i] = i / 3;
+    }
+    size_t n = pixel_encode(items, rgb, 256);
+    if (n != PIXEL_ITEMS(256) || reference_encode(expected, rgb, 256) != n ||
+            memcmp(items, expected, n * sizeof(pixel_item_t)) != 0)
+    {
+        printf("FAIL: byte values encode differently from the reference\n");
+        return false;
+    }
+
+    // 1.25 us a bit, high first and low after, as rmt_item32_t has it
+    pixel_item_t item = items[PIXEL_ITEMS(0xff) + 0];
+    if ((item & 0x7fff) != PIXEL_T1H || !(item >> 15 & 1) ||
+            (item >> 16 & 0x7fff) != PIXEL_T1L || item >> 31 != 0 ||
+            (PIXEL_T0H + PIXEL_T0L) * 25 != PIXEL_ITEM_NS ||
+            (PIXEL_T1H + PIXEL_T1L) * 25 != PIXEL_ITEM_NS)
+    {
+        printf("FAIL: item timing\n");
+        return false;
+    }
+
+    // Green goes out first
+    const uint8_t pixel[3] = { 0x00, 0x80, 0x00 };
+    pixel_encode(items, pixel, 1);
+    if ((items[0] & 0x7fff) != PIXEL_T1H || (items[8] & 0x7fff) != PIXEL_T0H)
+    {
+        printf("FAIL: not in GRB order\n");
+        return false;
+    }
+    return true;
+}
+
+static bool check_strip(void)
+{
+    static uint8_t slots[3][512];
+    static uint8_t rgb[STRIP * 3];
+    // The last frame ends inside pixel 13, the rest of its pixels are dark
+    const size_t counts[3] = { 512, 510, 40 };
+    for (int u = 0; u < 3; u++)
+    {
+        for (size_t i = 0; i < counts[u]; i++)
+        {
+            slots[u][i] = rand();
+        }
+        ingest_dmx(1 << (FIRST_OUTPUT + u), 0x0a000001, slots[u], counts[u], false);
+    }
+    memcpy(&rgb[0], slots[0], 510);
+    memcpy(&rgb[510], slots[1], 510);
+    memcpy(&rgb[1020], slots[2], 40);
+
+    const uint8_t *latched[3];
+    size_t latched_counts[3];
+    for (int u = 0; u < 3; u++)
+    {
+        size_t len;
+        const uint8_t *frame = dmx_buffer_latch(FIRST_OUTPUT + u, &len);
+        latched[u] = &frame[1];
+        latched_counts[u] = len - 1;
+    }
+    size_t n = pixel_encode_strip(items, STRIP, latched, latched_counts);
+    if (n != PIXEL_ITEMS(STRIP) || reference_encode(expected, rgb, STRIP) != n ||
+            memcmp(items, expected, n * sizeof(pixel_item_t)) != 0)
+    {
+        printf("FAIL: strip across universes encodes differently from the reference\n");
+        return false;
+    }
+    return true;
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+    artpoll_init();
+    pixel_init();
+    srand(1);
+    if (!check_reset() || !check_bytes() || !check_strip())
+    {
+        return 1;
+    }
+
+    static uint8_t universe[512];
+    for (int i = 0; i < 512; i++)
+    {
+        universe[i] = rand();
+    }
+    const uint8_t *slots[1] = { universe };
+    const size_t counts[1] = { 512 };
+    uint64_t iterations = bench_iterations(20000);
+
+    uint64_t start = bench_now_ns();
+    BENCH_RUN("pixel/universe_170px", 510, iterations,
+            { pixel_encode_strip(items, PIXEL_PER_UNIVERSE, slots, counts); bench_consume(items); });
+    uint64_t lut_ns = (bench_now_ns() - start) / iterations;
+    start = bench_now_ns();
+    BENCH_RUN("pixel/universe_170px_bitwise", 510, iterations,
+            { reference_encode(items, universe, PIXEL_PER_UNIVERSE); bench_consume(items); });
+    uint64_t bitwise_ns = (bench_now_ns() - start) / iterations;
+
+    printf("170 px encoded in %llu ns, %.1f Mpx/s, %.3f%% of the %llu us on the wire\n",
+            (unsigned long long)lut_ns, PIXEL_PER_UNIVERSE * 1e3 / (lut_ns ? lut_ns : 1),
+            lut_ns * 100.0 / WIRE_NS, (unsigned long long)(WIRE_NS / 1000));
+    // Loose enough for a loaded CI host, the table has to keep its lead
+    // over the bit loop and the encode a tiny fraction of the wire time
+    if (lut_ns >= bitwise_ns || lut_ns * 100 > WIRE_NS)
+    {
+        printf("FAIL: encoding a universe takes %llu ns, %llu ns a bit at a time\n",
+                (unsigned long long)lut_ns, (unsigned long long)bitwise_ns);
+        return 1;
+    }
+    printf("pixel encoder ok\n");
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Feeds the jitter buffer a 25 fps stream delivered in Wi-Fi style clumps,
+// on a virtual microsecond clock, and checks the frames come out in order,
+// paced at the sender's rate, without late frames once the schedule has
+// settled. Also covers a second stream, a pause, queue overflow and the
+// console command.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_shim.h"
+
+#include "control.h"
+#include "playout.h"
+
+#define SENDER_US       40400   // 25 fps from a slightly slow clock
+#define CLUMP_US        120000  // frames held back and delivered together
+#define JITTER_US       6000
+#define DELAY_MS        150
+#define SIM_US          30000000
+#define SETTLE_US       5000000
+#define KEY_A           0x0100000a
+#define KEY_B           0x0200000a
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void test_clumped_stream(void)
+{
+    uint8_t slots[4] = { 0 };
+    uint32_t next_send = 0;
+    uint8_t sent_seq = 0;
+    uint8_t expected_seq = 0;
+    uint32_t last_release = 0;
+    uint32_t min_gap = UINT32_MAX, max_gap = 0;
+    uint32_t late_before = 0;
+    bool settled = false;
+
+    playout_set_delay(0, DELAY_MS);
+
+    // Frames in flight, each held until the end of the clump it was sent in
+    // and the whole clump delivered with the same jitter
+    uint32_t in_flight[16];
+    uint8_t in_flight_seq[16];
+    size_t flying = 0;
+    uint32_t clump_jitter = 0;
+
+    for (uint32_t now = 0; now < SIM_US; now += 100)
+    {
+        if (now >= next_send)
+        {
+            if (flying == 0)
+            {
+                clump_jitter = rand() % JITTER_US;
+            }
+            in_flight[flying] = (next_send / CLUMP_US + 1) * CLUMP_US + clump_jitter;
+            in_flight_seq[flying++] = sent_seq++;
+            next_send += SENDER_US;
+        }
+        while (flying > 0 && in_flight[0] <= now)
+        {
+            slots[0] = in_flight_seq[0];
+            playout_push(0, KEY_A, slots, sizeof(slots), now, now);
+            flying--;
+            for (size_t i = 0; i < flying; i++)
+            {
+                in_flight[i] = in_flight[i + 1];
+                in_flight_seq[i] = in_flight_seq[i + 1];
+            }
+        }
+
+        if (!settled && now >= SETTLE_US)
+        {
+            playout_stats_t stats;
+            playout_get_stats(0, &stats);
+            late_before = stats.late;
+            settled = true;
+        }
+
+        const playout_frame_t *frame;
+        while ((frame = playout_pop(0, now)) != NULL)
+        {
+            check(frame->slots[0] == expected_seq, "frames released out of order");
+            expected_seq = frame->slots[0] + 1;
+            if (settled)
+            {
+                uint32_t gap = now - last_release;
+                min_gap = gap < min_gap ? gap : min_gap;
+                max_gap = gap > max_gap ? gap : max_gap;
+            }
+            last_release = now;
+        }
+    }
+
+    playout_stats_t stats;
+    playout_get_stats(0, &stats);
+    printf("clumped stream: %u frames, %u late (%u settled), interval %u us, max depth %u, "
+            "release gaps %u..%u us\n",
+            (unsigned)stats.frames, (unsigned)stats.late, (unsigned)(stats.late - late_before),
+            (unsigned)stats.interval_us, (unsigned)stats.max_depth,
+            (unsigned)min_gap, (unsigned)max_gap);
+    check(stats.late == late_before, "late frames once settled");
+    check(stats.overflows == 0, "queue overflowed");
+    check(stats.interval_us > SENDER_US - 1000 && stats.interval_us < SENDER_US + 1000,
+            "frame interval estimate off");
+    check(min_gap > SENDER_US - 8000 && max_gap < SENDER_US + 8000,
+            "releases not paced at the sender's rate");
+    playout_set_delay(0, 0);
+}
+
+static void test_second_stream_and_pause(void)
+{
+    uint8_t slots[1] = { 0 };
+    playout_set_delay(1, DELAY_MS);
+
+    check(playout_push(1, KEY_A, slots, 1, 0, 0), "first stream not buffered");
+    check(!playout_push(1, KEY_B, slots, 1, 1000, 1000), "second stream buffered");
+    check(playout_pop(1, 1000) == NULL, "frame released before its delay");
+    check(playout_next_due(1000) == DELAY_MS * 1000 - 1000, "wrong time to next frame");
+    check(playout_pop(1, DELAY_MS * 1000) != NULL, "frame not released at its delay");
+
+    // After a pause the other stream may take over
+    check(playout_push(1, KEY_B, slots, 1, 3000000, 3000000), "stream not taken over after a pause");
+
+    playout_stats_t stats;
+    playout_get_stats(1, &stats);
+    check(stats.resyncs == 2, "resync not counted");
+
+    for (int i = 0; i < PLAYOUT_DEPTH + 3; i++)
+    {
+        playout_push(1, KEY_B, slots, 1, 3000000 + i, 3000000 + i);
+    }
+    playout_get_stats(1, &stats);
+    check(stats.overflows == 4 && stats.depth == PLAYOUT_DEPTH, "overflow not handled");
+
+    playout_set_delay(1, 0);
+    check(!playout_enabled(1) && playout_next_due(3000000) == UINT32_MAX, "disabling left frames queued");
+}
+
+static void test_console(void)
+{
+    check(control_run("playout 2 80") == CONTROL_OK && playout_enabled(2),
+            "console did not set the delay");
+    check(control_run("playout 2 5000") == CONTROL_FAILED, "delay out of range accepted");
+    check(control_run("playout 2 0") == CONTROL_OK && !playout_enabled(2),
+            "console did not turn the buffer off");
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    srand(1);
+    playout_init();
+
+    test_clumped_stream();
+    test_second_stream_and_pause();
+    test_console();
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("playout ok\n");
+    return 0;
+}
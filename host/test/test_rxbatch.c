@@ -0,0 +1,141 @@
+// Checks which frame survives when a batch holds several frames of one
+// sender and universe: the newest by sequence number, also when an older
+// one arrives last and across the wrap, and never sACN preview data or an
+// alternate start code. Frames coalesced away do not count as lost.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "route.h"
+#include "rxbatch.h"
+
+#define SACN_OUTPUT     1
+#define SACN_OFS_OPTIONS    112
+#define SACN_OFS_START_CODE 125
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Port-Address 0, output 0, every slot at seq
+static void push_artdmx(uint8_t seq, uint32_t source_ip)
+{
+    uint8_t *buf = rxbatch_slot();
+    memset(&buf[ARTCODEC_DMX_HEADER_LEN], seq, 512);
+    size_t len = artcodec_encode_dmx(buf, seq, 0, 0, 512);
+    rxbatch_push(RXBATCH_ARTNET, len, source_ip);
+}
+
+static void push_sacn(uint8_t seq, uint8_t value, uint8_t options, uint8_t start_code)
+{
+    uint8_t *buf = rxbatch_slot();
+    memset(&buf[BENCH_SACN_HEADER_LEN], value, 512);
+    size_t len = bench_sacn_data(buf, CONFIG_SACN_UNIVERSE + SACN_OUTPUT, seq, 512);
+    buf[SACN_OFS_OPTIONS] = options;
+    buf[SACN_OFS_START_CODE] = start_code;
+    rxbatch_push(RXBATCH_SACN, len, 0x0200000a);
+}
+
+static uint8_t latched(uint8_t output)
+{
+    size_t len;
+    const uint8_t *frame = dmx_buffer_latch(output, &len);
+    return len == 513 ? frame[1] : 0;
+}
+
+// Each case from its own sender, so the sequence check starts afresh
+static void artdmx_batch(const uint8_t *seqs, size_t count, uint32_t source_ip)
+{
+    rxbatch_begin();
+    for (size_t i = 0; i < count; i++)
+    {
+        push_artdmx(seqs[i], source_ip);
+    }
+    rxbatch_end();
+}
+
+static void artdmx_pair(uint8_t first, uint8_t second, uint8_t expected, uint32_t source_ip)
+{
+    char what[64];
+    rxbatch_begin();
+    push_artdmx(first, source_ip);
+    push_artdmx(second, source_ip);
+    rxbatch_end();
+    snprintf(what, sizeof(what), "ArtDmx %d then %d", first, second);
+    check(latched(0) == expected, what);
+    dmx_source_release(0, source_ip);
+}
+
+int main(void)
+{
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+    route_init();
+    artpoll_init();
+
+    rxbatch_stats_t stats;
+    artdmx_pair(20, 21, 21, 0x0100000a);
+    artdmx_pair(6, 5, 6, 0x0300000a);
+    artdmx_pair(255, 1, 1, 0x0400000a);
+    artdmx_pair(1, 255, 1, 0x0500000a);
+    rxbatch_get_stats(&stats);
+    check(stats.coalesced == 4, "not every pair coalesced");
+    printf("artdmx: %s\n", failures == 0 ? "ok" : "FAILED");
+
+    // A burst, in and out of order, then one frame really lost
+    int before = failures;
+    artnet_seq_stats_t seq;
+    artnet_get_seq_stats(&seq);
+    uint32_t lost = seq.lost;
+    artdmx_batch((const uint8_t[]){ 10 }, 1, 0x0600000a);
+    artdmx_batch((const uint8_t[]){ 11, 12, 13 }, 3, 0x0600000a);
+    artdmx_batch((const uint8_t[]){ 16, 14, 15 }, 3, 0x0600000a);
+    artnet_get_seq_stats(&seq);
+    check(seq.lost == lost, "coalesced frames counted lost");
+    artdmx_batch((const uint8_t[]){ 18 }, 1, 0x0600000a);
+    artnet_get_seq_stats(&seq);
+    check(seq.lost == lost + 1, "lost frame not counted");
+    check(latched(0) == 18, "ArtDmx burst");
+    dmx_source_release(0, 0x0600000a);
+    printf("artdmx loss: %s\n", failures == before ? "ok" : "FAILED");
+
+    before = failures;
+    rxbatch_begin();
+    push_sacn(40, 0x40, 0, 0x00);
+    push_sacn(39, 0x39, 0, 0x00);
+    push_sacn(41, 0x41, 0x80, 0x00);
+    push_sacn(42, 0x42, 0, 0xdd);
+    rxbatch_end();
+    check(latched(SACN_OUTPUT) == 0x40, "sACN older, preview or start code frame output");
+
+    rxbatch_begin();
+    push_sacn(255, 0x55, 0, 0x00);
+    push_sacn(0, 0x56, 0, 0x00);
+    rxbatch_end();
+    check(latched(SACN_OUTPUT) == 0x56, "sACN sequence wrap");
+    printf("sacn: %s\n", failures == before ? "ok" : "FAILED");
+
+    if (failures != 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("rxbatch coalescing ok\n");
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Stress test for the writer -> DMX output hand-over: one thread commits
+// frames through the public write API as fast as it can while another
+// latches frames like the output interrupts do. Every frame carries its
+// sequence number and a pattern derived from it, so a torn frame (slots from
+// two commits) or a step back in time is detected. The latch must also stay
+// fast under contention since it runs on the output's deadline: it must
+// never block (a voluntary context switch inside the latch fails the test)
+// and its latency must stay bounded. Samples during which the host scheduler
+// preempted the reader are left out, that is not waiting for the writer. The
+// bound is checked on the 99.9th percentile since hypervisor stalls on
+// virtualised CI hosts show up in the maximum, which is only reported.
+
+#define _GNU_SOURCE
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "bench.h"
+#include "host_shim.h"
+
+#include "dmxtask.h"
+
+#define FRAMES          2000000
+#define LATCH_BOUND_NS  20000   // p99.9, orders of magnitude below a frame
+#define HISTOGRAM_STEP  100     // ns per latency bucket
+#define HISTOGRAM_SIZE  1000
+
+static uint64_t histogram[HISTOGRAM_SIZE + 1];
+
+static atomic_bool writer_done = false;
+
+static void context_switches(long *voluntary, long *involuntary)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    *voluntary = usage.ru_nvcsw;
+    *involuntary = usage.ru_nivcsw;
+}
+
+static void fill_frame(uint8_t *slots, uint32_t seq)
+{
+    memcpy(slots, &seq, sizeof(seq));
+    for (size_t i = sizeof(seq); i < 512; i++)
+    {
+        slots[i] = (uint8_t)(seq * 31 + i);
+    }
+}
+
+static void *writer(void *arg)
+{
+    uint8_t slots[512];
+    int source = dmx_source_claim(0, 1);
+    for (uint32_t seq = 1; seq <= FRAMES; seq++)
+    {
+        fill_frame(slots, seq);
+        // Two halves, the commit must still publish them as one frame
+        dmx_output_write(0, source, 1, slots, 256);
+        dmx_output_write(0, source, 257, &slots[256], 256);
+        dmx_output_commit(0, source);
+    }
+    atomic_store(&writer_done, true);
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t writer_thread;
+    uint64_t latches = 0, blocked = 0, preempted = 0, new_frames = 0, torn = 0, stale = 0;
+    uint64_t worst_ns = 0, total_ns = 0;
+    uint32_t last_seq = 0;
+
+    host_log_level = ESP_LOG_ERROR;
+    dmx_buffer_init();
+    pthread_create(&writer_thread, NULL, writer, NULL);
+
+    while (!atomic_load(&writer_done))
+    {
+        size_t len;
+        long voluntary_before, involuntary_before, voluntary, involuntary;
+        context_switches(&voluntary_before, &involuntary_before);
+        uint64_t start = bench_now_ns();
+        const uint8_t *frame = dmx_buffer_latch(0, &len);
+        uint64_t elapsed = bench_now_ns() - start;
+        context_switches(&voluntary, &involuntary);
+
+        latches++;
+        if (voluntary != voluntary_before)
+        {
+            blocked++;
+        }
+        else if (involuntary != involuntary_before)
+        {
+            preempted++;
+        }
+        else
+        {
+            total_ns += elapsed;
+            size_t bucket = elapsed / HISTOGRAM_STEP;
+            histogram[bucket < HISTOGRAM_SIZE ? bucket : HISTOGRAM_SIZE]++;
+            if (elapsed > worst_ns)
+            {
+                worst_ns = elapsed;
+            }
+        }
+
+        uint32_t seq;
+        memcpy(&seq, &frame[1], sizeof(seq));
+        if (seq == 0)
+        {
+            continue;   // nothing committed yet
+        }
+        if (seq < last_seq)
+        {
+            stale++;
+        }
+        if (seq != last_seq)
+        {
+            new_frames++;
+        }
+        last_seq = seq;
+
+        for (size_t i = sizeof(seq); i < 512; i++)
+        {
+            if (frame[1 + i] != (uint8_t)(seq * 31 + i))
+            {
+                torn++;
+                break;
+            }
+        }
+    }
+    pthread_join(writer_thread, NULL);
+
+    printf("latches %llu, new frames %llu, torn %llu, stale %llu\n",
+            (unsigned long long)latches, (unsigned long long)new_frames,
+            (unsigned long long)torn, (unsigned long long)stale);
+    uint64_t samples = latches - preempted - blocked;
+    uint64_t seen = 0;
+    size_t p999 = 0;
+    while (p999 < HISTOGRAM_SIZE && (seen += histogram[p999]) * 1000 < samples * 999)
+    {
+        p999++;
+    }
+    uint64_t p999_ns = (uint64_t)(p999 + 1) * HISTOGRAM_STEP;
+
+    printf("latch mean %.1f ns, p99.9 < %llu ns, worst %llu ns (%llu preempted samples left out)\n",
+            (double)total_ns / samples, (unsigned long long)p999_ns,
+            (unsigned long long)worst_ns, (unsigned long long)preempted);
+
+    if (torn != 0 || stale != 0 || new_frames == 0)
+    {
+        printf("FAIL: torn or out of order frames\n");
+        return 1;
+    }
+    if (blocked != 0)
+    {
+        printf("FAIL: latch blocked %llu times\n", (unsigned long long)blocked);
+        return 1;
+    }
+    if (p999_ns > LATCH_BOUND_NS)
+    {
+        printf("FAIL: latch p99.9 above %d ns\n", LATCH_BOUND_NS);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Sends ArtDmx at a node, see loadgen.h for what goes in the frames.
+//
+//   artnet_load [-t ip] [-p port] [-u first universe] [-n universes]
+//               [-r rate Hz] [-s slots] [-l loss %] [-o reorder %]
+//               [-b burst frames] [-d seconds] [-S]
+//
+// -S sends unsequenced frames (sequence 0). Without -d it runs until
+// interrupted and prints what it sent every ten seconds.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <pthread.h>
+
+#include "loadgen.h"
+
+static atomic_bool stop;
+
+static void on_signal(int sig)
+{
+    atomic_store(&stop, true);
+}
+
+static void print_stats(const loadgen_stats_t *stats, uint64_t elapsed_s)
+{
+    printf("%llu s: %llu generated, %llu sent, %llu dropped, %llu reordered, %llu send errors\n",
+            (unsigned long long)elapsed_s,
+            (unsigned long long)atomic_load(&stats->generated),
+            (unsigned long long)atomic_load(&stats->sent),
+            (unsigned long long)atomic_load(&stats->dropped),
+            (unsigned long long)atomic_load(&stats->reordered),
+            (unsigned long long)atomic_load(&stats->send_errors));
+    fflush(stdout);
+}
+
+typedef struct {
+    loadgen_config_t config;
+    loadgen_stats_t stats;
+    int result;
+} run_t;
+
+static void *run(void *arg)
+{
+    run_t *r = arg;
+    r->result = loadgen_run(&r->config, &r->stats, &stop);
+    atomic_store(&stop, true);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static run_t r = {
+        .config = {
+            .port = 6454,
+            .universes = 1,
+            .rate_hz = 44,
+            .slots = 512,
+            .sequence = true,
+            .seed = 1,
+        },
+    };
+    r.config.target_ip = inet_addr("127.0.0.1");
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:p:u:n:r:s:l:o:b:d:S")) != -1)
+    {
+        switch (opt)
+        {
+            case 't': r.config.target_ip = inet_addr(optarg); break;
+            case 'p': r.config.port = atoi(optarg); break;
+            case 'u': r.config.first_universe = atoi(optarg); break;
+            case 'n': r.config.universes = atoi(optarg); break;
+            case 'r': r.config.rate_hz = atoi(optarg); break;
+            case 's': r.config.slots = atoi(optarg); break;
+            case 'l': r.config.loss = atof(optarg) / 100; break;
+            case 'o': r.config.reorder = atof(optarg) / 100; break;
+            case 'b': r.config.burst = atoi(optarg); break;
+            case 'd': r.config.duration_s = atoi(optarg); break;
+            case 'S': r.config.sequence = false; break;
+            default:
+                fprintf(stderr, "usage: %s [-t ip] [-p port] [-u universe] [-n universes] "
+                        "[-r rate] [-s slots] [-l loss%%] [-o reorder%%] [-b burst] [-d seconds] [-S]\n",
+                        argv[0]);
+                return 2;
+        }
+    }
+    if (r.config.universes == 0 || r.config.rate_hz == 0 ||
+            r.config.slots < LOADGEN_STAMP_LEN || r.config.slots > 512 || r.config.slots % 2)
+    {
+        fprintf(stderr, "need at least one universe, a rate and an even slot count of 8 to 512\n");
+        return 2;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, run, &r);
+    uint64_t elapsed = 0;
+    while (!atomic_load(&stop))
+    {
+        sleep(1);
+        if (++elapsed % 10 == 0)
+        {
+            print_stats(&r.stats, elapsed);
+        }
+    }
+    pthread_join(thread, NULL);
+    print_stats(&r.stats, elapsed);
+    return r.result == 0 ? 0 : 1;
+}
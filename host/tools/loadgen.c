@@ -0,0 +1,173 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "loadgen.h"
+
+#define ARTDMX_HEADER_LEN 18
+
+typedef struct {
+    uint8_t data[ARTDMX_HEADER_LEN + 512];
+    size_t len;
+} packet_t;
+
+uint32_t loadgen_now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static void build(packet_t *packet, const loadgen_config_t *config, uint16_t universe,
+        uint32_t counter, uint8_t seq)
+{
+    uint8_t *p = packet->data;
+    memcpy(p, "Art-Net\0\0\x50\0\x0e", 12);
+    p[12] = config->sequence ? seq : 0;
+    p[13] = 0;
+    p[14] = universe & 0xff;
+    p[15] = universe >> 8;
+    p[16] = config->slots >> 8;
+    p[17] = config->slots & 0xff;
+
+    uint8_t *slots = &p[ARTDMX_HEADER_LEN];
+    put_le32(&slots[0], counter);
+    put_le32(&slots[4], loadgen_now_us());
+    // Every slot changes every frame, nothing downstream can skip work
+    memset(&slots[LOADGEN_STAMP_LEN], counter & 0xff, config->slots - LOADGEN_STAMP_LEN);
+    packet->len = ARTDMX_HEADER_LEN + config->slots;
+}
+
+static void transmit(int sock, const struct sockaddr_in *dest, const packet_t *packet,
+        loadgen_stats_t *stats)
+{
+    if (sendto(sock, packet->data, packet->len, 0, (const struct sockaddr *)dest,
+                sizeof(*dest)) < 0)
+    {
+        atomic_fetch_add(&stats->send_errors, 1);
+        return;
+    }
+    atomic_fetch_add(&stats->sent, 1);
+}
+
+int loadgen_run(const loadgen_config_t *config, loadgen_stats_t *stats, const atomic_bool *stop)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    int broadcast = 1;
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port),
+        .sin_addr.s_addr = config->target_ip,
+    };
+
+    uint32_t burst = config->burst > 1 ? config->burst : 1;
+    size_t held_max = (size_t)config->universes * (burst + 1);
+    packet_t *held = malloc(held_max * sizeof(packet_t));
+    // One frame per universe waiting to be sent after its successor
+    packet_t *swapped = malloc(config->universes * sizeof(packet_t));
+    bool *swapping = calloc(config->universes, sizeof(bool));
+    uint32_t *counters = calloc(config->universes, sizeof(uint32_t));
+    if (held == NULL || swapped == NULL || swapping == NULL || counters == NULL)
+    {
+        close(sock);
+        return -1;
+    }
+
+    unsigned seed = config->seed;
+    size_t held_count = 0;
+    uint64_t period_ns = 1000000000ull / config->rate_hz;
+    uint64_t ticks = config->duration_s ? (uint64_t)config->duration_s * config->rate_hz : 0;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (uint64_t tick = 0; (ticks == 0 || tick < ticks) && !atomic_load(stop); tick++)
+    {
+        for (uint16_t u = 0; u < config->universes; u++)
+        {
+            uint32_t counter = counters[u]++;
+            atomic_fetch_add(&stats->generated, 1);
+            if ((double)rand_r(&seed) / RAND_MAX < config->loss)
+            {
+                atomic_fetch_add(&stats->dropped, 1);
+                continue;
+            }
+
+            packet_t *packet = &held[held_count];
+            // Sequence runs 1..255, 0 is reserved for unsequenced data
+            build(packet, config, config->first_universe + u, counter, counter % 255 + 1);
+            if (swapping[u])
+            {
+                // The successor goes first, then the frame held back
+                held[++held_count] = swapped[u];
+                swapping[u] = false;
+                held_count++;
+            }
+            else if ((double)rand_r(&seed) / RAND_MAX < config->reorder)
+            {
+                swapped[u] = *packet;
+                swapping[u] = true;
+                atomic_fetch_add(&stats->reordered, 1);
+            }
+            else
+            {
+                held_count++;
+            }
+        }
+
+        if ((tick + 1) % burst == 0)
+        {
+            for (size_t i = 0; i < held_count; i++)
+            {
+                transmit(sock, &dest, &held[i], stats);
+            }
+            held_count = 0;
+        }
+
+        next.tv_nsec += period_ns;
+        while (next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    for (size_t i = 0; i < held_count; i++)
+    {
+        transmit(sock, &dest, &held[i], stats);
+    }
+    for (uint16_t u = 0; u < config->universes; u++)
+    {
+        if (swapping[u])
+        {
+            transmit(sock, &dest, &swapped[u], stats);
+        }
+    }
+    free(held);
+    free(swapped);
+    free(swapping);
+    free(counters);
+    close(sock);
+    return 0;
+}
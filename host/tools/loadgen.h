@@ -0,0 +1,46 @@
+// ArtDmx load generator shared by the artnet_load tool and the soak
+// harness. Sends every universe at a fixed rate, optionally dropping,
+// swapping and bunching up packets the way a bad Wi-Fi link does.
+//
+// Each frame carries its own provenance in the first slots, so the far end
+// can tell which frame it is looking at and how old it is:
+//
+//   slots 0-3   frame counter of the universe, little endian
+//   slots 4-7   send time in microseconds, CLOCK_MONOTONIC, little endian
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOADGEN_STAMP_LEN 8
+
+typedef struct {
+    uint32_t target_ip;         // network byte order
+    uint16_t port;
+    uint16_t first_universe;
+    uint16_t universes;
+    uint32_t rate_hz;           // frames per second per universe
+    uint16_t slots;             // LOADGEN_STAMP_LEN to 512, even
+    double loss;                // probability a frame is not sent
+    double reorder;             // probability a frame swaps with the next
+    uint32_t burst;             // frames held back and sent together, 0 or 1 for none
+    uint32_t duration_s;        // 0 runs until stop is set
+    bool sequence;              // fill in the ArtDmx sequence number
+    unsigned seed;
+} loadgen_config_t;
+
+typedef struct {
+    atomic_uint_fast64_t generated;
+    atomic_uint_fast64_t sent;
+    atomic_uint_fast64_t dropped;       // by the loss injection
+    atomic_uint_fast64_t reordered;
+    atomic_uint_fast64_t send_errors;
+} loadgen_stats_t;
+
+// Microseconds on the clock the stamps use, wraps like latency_now_us()
+uint32_t loadgen_now_us(void);
+
+// Runs until duration_s has passed or *stop is set. Returns 0, or -1 when
+// the socket cannot be opened.
+int loadgen_run(const loadgen_config_t *config, loadgen_stats_t *stats, const atomic_bool *stop);
@@ -0,0 +1,135 @@
+// Converts between recorded shows (see main/show.h) and plain frame dumps,
+// for preparing a show off the node or checking one read back from it. A
+// frame dump is a sequence of
+//
+//   u32 microseconds, u8 universe, u16 slot count, slots
+//
+// little endian, one per received frame.
+//
+//   show_codec encode frames.bin show.bin [keyframe_ms]
+//   show_codec decode show.bin frames.bin
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "show.h"
+
+static uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*len ? *len : 1);
+    if (data == NULL || fread(data, 1, *len, f) != *len)
+    {
+        perror(path);
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static int encode(const char *in_path, const char *out_path, uint32_t keyframe_ms)
+{
+    static show_encoder_t enc;
+    uint8_t record[SHOW_RECORD_MAX];
+    size_t len;
+    uint8_t *in = read_file(in_path, &len);
+    FILE *out = fopen(out_path, "wb");
+    if (in == NULL || out == NULL)
+    {
+        return 1;
+    }
+
+    fwrite(record, 1, show_encoder_init(&enc, keyframe_ms, record), out);
+    size_t pos = 0, frames = 0, written = SHOW_HEADER_LEN;
+    uint32_t t_us = 0;
+    while (pos + 7 <= len)
+    {
+        t_us = in[pos] | in[pos + 1] << 8 | in[pos + 2] << 16 | (uint32_t)in[pos + 3] << 24;
+        uint8_t universe = in[pos + 4];
+        uint16_t count = in[pos + 5] | in[pos + 6] << 8;
+        pos += 7;
+        if (universe >= SHOW_UNIVERSES || count > 512 || pos + count > len)
+        {
+            fprintf(stderr, "%s: bad frame at byte %zu\n", in_path, pos - 7);
+            return 1;
+        }
+        size_t n = show_encode_frame(&enc, record, universe, &in[pos], count, t_us);
+        fwrite(record, 1, n, out);
+        written += n;
+        pos += count;
+        frames++;
+    }
+    written += fwrite(record, 1, show_encode_end(&enc, record, t_us), out);
+    fclose(out);
+    fprintf(stderr, "%zu frames, %zu bytes of dump, %zu bytes of show (%.1fx)\n",
+            frames, len, written, written ? (double)len / written : 0.0);
+    free(in);
+    return 0;
+}
+
+static int decode(const char *in_path, const char *out_path)
+{
+    static show_decoder_t dec;
+    size_t len;
+    uint8_t *in = read_file(in_path, &len);
+    FILE *out = fopen(out_path, "wb");
+    if (in == NULL || out == NULL)
+    {
+        return 1;
+    }
+    if (!show_decoder_init(&dec, in, len))
+    {
+        fprintf(stderr, "%s: not a show\n", in_path);
+        return 1;
+    }
+
+    size_t frames = 0;
+    uint8_t universe;
+    show_status_t status;
+    while ((status = show_decode_next(&dec, &universe)) == SHOW_FRAME)
+    {
+        uint8_t head[7] = {
+            dec.t_us, dec.t_us >> 8, dec.t_us >> 16, dec.t_us >> 24,
+            universe, dec.count[universe] & 0xff, dec.count[universe] >> 8,
+        };
+        fwrite(head, 1, sizeof(head), out);
+        fwrite(dec.frame[universe], 1, dec.count[universe], out);
+        frames++;
+    }
+    fclose(out);
+    if (status == SHOW_ERROR)
+    {
+        fprintf(stderr, "%s: damaged at byte %zu\n", in_path, dec.pos);
+        return 1;
+    }
+    fprintf(stderr, "%zu frames, %u.%03u s\n", frames,
+            (unsigned)(dec.t_us / 1000000), (unsigned)(dec.t_us / 1000 % 1000));
+    free(in);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && strcmp(argv[1], "encode") == 0)
+    {
+        return encode(argv[2], argv[3], argc > 4 ? strtoul(argv[4], NULL, 0) : 2000);
+    }
+    if (argc == 4 && strcmp(argv[1], "decode") == 0)
+    {
+        return decode(argv[2], argv[3]);
+    }
+    fprintf(stderr, "usage: %s encode frames.bin show.bin [keyframe_ms]\n"
+            "       %s decode show.bin frames.bin\n", argv[0], argv[0]);
+    return 2;
+}
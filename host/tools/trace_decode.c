@@ -0,0 +1,146 @@
+// Turns the output of the console "trace" command into a timeline. Reads a
+// serial log on stdin (or the file given), picks out the TRACE lines and
+// prints one event per line with its time since the first record and
+// since the previous one.
+//
+//   trace_decode monitor.log
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+typedef struct {
+    uint32_t seq;
+    uint32_t ts_us;
+    uint16_t event;
+    uint16_t arg0;
+    uint32_t arg1;
+} record_t;
+
+static const char *const names[TRACE_EVENT_COUNT] = {
+#define TRACE_NAME(name) [TRACE_##name] = #name,
+    TRACE_EVENTS(TRACE_NAME)
+#undef TRACE_NAME
+};
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int parse(const char *line, record_t *record)
+{
+    const char *hex = strstr(line, "TRACE ");
+    uint8_t raw[TRACE_RECORD_LEN];
+
+    if (hex == NULL)
+    {
+        return 0;
+    }
+    hex += 6;
+    for (int i = 0; i < TRACE_RECORD_LEN; i++)
+    {
+        unsigned byte;
+        if (sscanf(&hex[2 * i], "%2x", &byte) != 1)
+        {
+            return 0;
+        }
+        raw[i] = byte;
+    }
+    record->seq = le32(&raw[0]);
+    record->ts_us = le32(&raw[4]);
+    record->event = raw[8] | raw[9] << 8;
+    record->arg0 = raw[10] | raw[11] << 8;
+    record->arg1 = le32(&raw[12]);
+    return 1;
+}
+
+static int by_seq(const void *a, const void *b)
+{
+    uint32_t sa = ((const record_t *)a)->seq;
+    uint32_t sb = ((const record_t *)b)->seq;
+    return sa < sb ? -1 : sa > sb;
+}
+
+// Events whose second argument is an IPv4 address in network byte order
+static int arg1_is_ip(uint16_t event)
+{
+    switch (event)
+    {
+        case TRACE_ARTNET_SHORT:
+        case TRACE_ARTNET_BAD_MAGIC:
+        case TRACE_ARTNET_BAD_VERSION:
+        case TRACE_ARTDMX_TRUNCATED:
+        case TRACE_ARTDMX_LEN_MISMATCH:
+        case TRACE_ARTDMX_TOO_LONG:
+        case TRACE_ARTSYNC_TRUNCATED:
+        case TRACE_ARTSYNC_FOREIGN:
+        case TRACE_ARTSYNC_ENTER:
+        case TRACE_ARTPOLL_TRUNCATED:
+        case TRACE_ARTPOLL_REPLY:
+        case TRACE_ARTNET_TRUNCATED:
+        case TRACE_ARTNET_BAD_LENGTH:
+        case TRACE_WIFI_GOT_IP:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in = stdin;
+    if (argc > 1 && (in = fopen(argv[1], "r")) == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    size_t count = 0, capacity = 1024;
+    record_t *records = malloc(capacity * sizeof(*records));
+    char line[256];
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        if (count == capacity)
+        {
+            capacity *= 2;
+            records = realloc(records, capacity * sizeof(*records));
+        }
+        count += parse(line, &records[count]);
+    }
+    if (count == 0)
+    {
+        fprintf(stderr, "no TRACE records found\n");
+        return 1;
+    }
+
+    qsort(records, count, sizeof(*records), by_seq);
+
+    uint32_t first_us = records[0].ts_us;
+    uint32_t prev_us = first_us;
+    for (size_t i = 0; i < count; i++)
+    {
+        const record_t *r = &records[i];
+        if (i > 0 && r->seq != records[i - 1].seq + 1)
+        {
+            printf("%26s(%u records missing)\n", "", r->seq - records[i - 1].seq - 1);
+        }
+        const char *name = r->event < TRACE_EVENT_COUNT ? names[r->event] : "?";
+        printf("%10.3f ms %+10.3f ms  %-24s %5u  ", (r->ts_us - first_us) / 1000.0,
+                (r->ts_us - prev_us) / 1000.0, name, r->arg0);
+        if (arg1_is_ip(r->event))
+        {
+            printf("%u.%u.%u.%u\n", r->arg1 & 0xff, (r->arg1 >> 8) & 0xff,
+                    (r->arg1 >> 16) & 0xff, r->arg1 >> 24);
+        }
+        else
+        {
+            printf("0x%08x\n", r->arg1);
+        }
+        prev_us = r->ts_us;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include <string.h>
+
+#include "artcodec.h"
+
+// "Art-Net\0" and ProtVer as loaded from the wire, the header check below
+// relies on the byte order
+_Static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "header check assumes little endian");
+#define ARTCODEC_ID           0x0074654e2d747241ull
+#define ARTCODEC_VERSION_WORD ((uint32_t)ARTNET_VERSION << 24)
+
+const artcodec_op_t artcodec_ops[ARTCODEC_OP_COUNT] = {
+#define ARTCODEC_ENTRY(op, code, min, at, size, unit, max, flags_) \
+    [ARTCODEC_OP_##op] = {                                          \
+        .name = #op,                                                \
+        .opcode = code,                                             \
+        .min_len = min,                                             \
+        .count_max = max,                                           \
+        .count_at = at,                                             \
+        .count_size = size,                                         \
+        .count_unit = unit,                                         \
+        .flags = flags_,                                            \
+        .index = ARTCODEC_OP_##op,                                  \
+    },
+    ARTCODEC_OPS(ARTCODEC_ENTRY)
+#undef ARTCODEC_ENTRY
+};
+
+// Counts have to be inside the part already checked for
+#define ARTCODEC_CHECK(name, code, min, at, size, ...) \
+    _Static_assert((at) + (size) <= (min), #name " count outside the fixed part");
+ARTCODEC_OPS(ARTCODEC_CHECK)
+#undef ARTCODEC_CHECK
+
+_Static_assert(sizeof(artcodec_header_t) == ARTCODEC_HEADER_LEN, "header view");
+_Static_assert(sizeof(artcodec_poll_t) == 18, "ArtPoll view");
+_Static_assert(sizeof(artcodec_poll_reply_t) == 239, "ArtPollReply view");
+_Static_assert(sizeof(artcodec_diag_t) == 18, "ArtDiagData view");
+_Static_assert(sizeof(artcodec_command_t) == 16, "ArtCommand view");
+_Static_assert(sizeof(artcodec_dmx_t) == ARTCODEC_DMX_HEADER_LEN, "ArtDmx view");
+_Static_assert(sizeof(artcodec_nzs_t) == 18, "ArtNzs view");
+_Static_assert(sizeof(artcodec_sync_t) == 14, "ArtSync view");
+_Static_assert(sizeof(artcodec_address_t) == 107, "ArtAddress view");
+_Static_assert(sizeof(artcodec_input_t) == 20, "ArtInput view");
+_Static_assert(sizeof(artcodec_tod_request_t) == 24, "ArtTodRequest view");
+_Static_assert(sizeof(artcodec_tod_data_t) == 28, "ArtTodData view");
+_Static_assert(sizeof(artcodec_tod_control_t) == 24, "ArtTodControl view");
+_Static_assert(sizeof(artcodec_time_code_t) == 19, "ArtTimeCode view");
+
+// OpCodes are spread over the high byte, apart from the three video ones
+// which differ in the next nibble. Folding that in gives every OpCode a
+// slot of its own in a 256 entry table, which the round trip checks in
+// host/test/fuzz_artcodec.c hold it to.
+#define ARTCODEC_SLOT(code) (((code) >> 8 ^ ((code) >> 4 & 0x0f)) & 0xff)
+
+static const uint8_t op_slots[256] = {
+#define ARTCODEC_SLOT_ENTRY(op, code, ...) [ARTCODEC_SLOT(code)] = ARTCODEC_OP_##op + 1,
+    ARTCODEC_OPS(ARTCODEC_SLOT_ENTRY)
+#undef ARTCODEC_SLOT_ENTRY
+};
+
+const artcodec_op_t *artcodec_op(uint16_t opcode)
+{
+    uint8_t slot = op_slots[ARTCODEC_SLOT(opcode)];
+    if (slot == 0 || artcodec_ops[slot - 1].opcode != opcode)
+    {
+        return NULL;
+    }
+    return &artcodec_ops[slot - 1];
+}
+
+const char *artcodec_status_name(artcodec_status_t status)
+{
+    static const char *const names[] = {
+        [ARTCODEC_OK] = "ok",
+        [ARTCODEC_SHORT] = "too short",
+        [ARTCODEC_BAD_ID] = "not Art-Net",
+        [ARTCODEC_BAD_VERSION] = "wrong protocol version",
+        [ARTCODEC_UNKNOWN] = "unknown OpCode",
+        [ARTCODEC_TRUNCATED] = "truncated",
+        [ARTCODEC_BAD_LENGTH] = "length does not match",
+        [ARTCODEC_TOO_LONG] = "length over the maximum",
+    };
+    return status < sizeof(names) / sizeof(names[0]) ? names[status] : "?";
+}
+
+artcodec_status_t artcodec_parse(const uint8_t *buf, size_t len, artcodec_packet_t *packet)
+{
+    packet->raw = buf;
+    packet->len = len;
+    packet->op = NULL;
+    packet->opcode = 0;
+    packet->version = 0;
+    packet->count = 0;
+    if (len < ARTCODEC_HEADER_LEN)
+    {
+        return ARTCODEC_SHORT;
+    }
+
+    uint64_t id;
+    uint32_t word;
+    memcpy(&id, buf, 8);
+    memcpy(&word, &buf[8], 4);
+    packet->opcode = (uint16_t)word;
+    packet->version = artcodec_be16(&buf[10]);
+    // ID and ProtVer in one compare, with the OpCode between them masked out
+    if (((id ^ ARTCODEC_ID) | ((word ^ ARTCODEC_VERSION_WORD) & 0xffff0000)) != 0)
+    {
+        if (id != ARTCODEC_ID)
+        {
+            return ARTCODEC_BAD_ID;
+        }
+        if (packet->opcode != ARTNET_OP_POLL_REPLY)
+        {
+            return ARTCODEC_BAD_VERSION;
+        }
+    }
+
+    const artcodec_op_t *op = artcodec_op(packet->opcode);
+    if (op == NULL)
+    {
+        return ARTCODEC_UNKNOWN;
+    }
+    packet->op = op;
+    if (op->flags & ARTCODEC_NO_VERSION)
+    {
+        packet->version = 0;
+    }
+    if (len < op->min_len)
+    {
+        return ARTCODEC_TRUNCATED;
+    }
+    if (op->count_size == 0)
+    {
+        return ARTCODEC_OK;
+    }
+
+    size_t count = op->count_size == 2 ? artcodec_be16(&buf[op->count_at]) : buf[op->count_at];
+    packet->count = count;
+    if (count > op->count_max)
+    {
+        return ARTCODEC_TOO_LONG;
+    }
+    size_t end = op->min_len + count * op->count_unit;
+    if (op->flags & ARTCODEC_EXACT ? len != end : len < end)
+    {
+        return ARTCODEC_BAD_LENGTH;
+    }
+    return ARTCODEC_OK;
+}
+
+void artcodec_encode_header(uint8_t *buf, uint16_t opcode)
+{
+    artcodec_header_t *header = (artcodec_header_t *)buf;
+    memcpy(header->id, "Art-Net\0", 8);
+    header->opcode[0] = opcode & 0xff;
+    header->opcode[1] = opcode >> 8;
+    artcodec_put_be16(header->version, ARTNET_VERSION);
+}
+
+size_t artcodec_encode_dmx(uint8_t *buf, uint8_t sequence, uint8_t physical,
+        uint16_t port_address, size_t count)
+{
+    artcodec_dmx_t *dmx = (artcodec_dmx_t *)buf;
+    artcodec_encode_header(buf, ARTNET_OP_DMX);
+    dmx->sequence = sequence;
+    dmx->physical = physical;
+    dmx->sub_uni = port_address & 0xff;
+    dmx->net = (port_address >> 8) & 0x7f;
+    size_t length = (count + 1) & ~(size_t)1;
+    if (count & 1)
+    {
+        dmx->data[count] = 0;
+    }
+    artcodec_put_be16(dmx->length, length);
+    return ARTCODEC_DMX_HEADER_LEN + length;
+}
+
+void artcodec_encode_poll_reply(artcodec_poll_reply_t *reply, uint32_t ip, uint8_t bind_index)
+{
+    memset(reply, 0, sizeof(*reply));
+    memcpy(reply->id, "Art-Net\0", 8);
+    reply->opcode[0] = ARTNET_OP_POLL_REPLY & 0xff;
+    reply->opcode[1] = ARTNET_OP_POLL_REPLY >> 8;
+    memcpy(reply->ip, &ip, 4);
+    reply->port[0] = ARTNET_PORT & 0xff;
+    reply->port[1] = ARTNET_PORT >> 8;
+    memcpy(reply->bind_ip, &ip, 4);
+    reply->bind_index = bind_index;
+}
+
+size_t artcodec_encode_diag(uint8_t *buf, size_t size, uint8_t priority, uint8_t logical_port,
+        const char *text)
+{
+    if (size <= sizeof(artcodec_diag_t))
+    {
+        return 0;
+    }
+    artcodec_diag_t *diag = (artcodec_diag_t *)buf;
+    size_t room = size - sizeof(artcodec_diag_t);
+    if (room > ARTCODEC_DIAG_MAX)
+    {
+        room = ARTCODEC_DIAG_MAX;
+    }
+    // Sent with its terminator
+    size_t length = strnlen(text, room - 1);
+    artcodec_encode_header(buf, ARTNET_OP_DIAG_DATA);
+    diag->filler1 = 0;
+    diag->priority = priority;
+    diag->logical_port = logical_port;
+    diag->filler3 = 0;
+    memcpy(diag->data, text, length);
+    diag->data[length++] = '\0';
+    artcodec_put_be16(diag->length, length);
+    return sizeof(artcodec_diag_t) + length;
+}
+
+size_t artcodec_encode_tod_data(uint8_t *buf, size_t size, uint16_t port_address, uint8_t port,
+        uint8_t bind_index, uint16_t uid_total, uint8_t block, const uint8_t *uids, size_t count)
+{
+    size_t len = sizeof(artcodec_tod_data_t) + count * 6;
+    if (count > ARTCODEC_TOD_MAX || len > size)
+    {
+        return 0;
+    }
+    artcodec_tod_data_t *tod = (artcodec_tod_data_t *)buf;
+    artcodec_encode_header(buf, ARTNET_OP_TOD_DATA);
+    tod->rdm_version = 0x01;
+    tod->port = port;
+    memset(tod->spare, 0, sizeof(tod->spare));
+    tod->bind_index = bind_index;
+    tod->net = (port_address >> 8) & 0x7f;
+    // TodFull, the whole table whether asked for or flushed
+    tod->command_response = 0x00;
+    tod->address = port_address & 0xff;
+    artcodec_put_be16(tod->uid_total, uid_total);
+    tod->block_count = block;
+    tod->uid_count = count;
+    if (count > 0)
+    {
+        memcpy(tod->tod, uids, count * 6);
+    }
+    return len;
+}
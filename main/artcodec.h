@@ -0,0 +1,363 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Art-Net 4 packet codec, no I/O and no allocation. A received packet is
+// parsed where it lies: the ID and ProtVer are checked with one compare,
+// the OpCode is looked up in a table holding each packet's fixed length
+// and where its own count of trailing data sits, and the packet is checked
+// against both before the caller gets packed views into the buffer. Every
+// OpCode of the spec is known, whether the node acts on it or not. The
+// encoders write the packets the node sends into caller owned buffers.
+//
+// Multi-byte fields are kept as bytes in wire order, OpCode and the
+// ArtPollReply port are little endian, the rest big endian
+// (artcodec_be16).
+
+#define ARTNET_PORT             6454
+#define ARTNET_VERSION          14
+
+#define ARTCODEC_HEADER_LEN     12
+#define ARTCODEC_DMX_HEADER_LEN 18
+#define ARTCODEC_DMX_MAX        512
+#define ARTCODEC_DIAG_MAX       512
+#define ARTCODEC_TOD_MAX        200     // UIDs in one ArtTodData
+
+// ArtPoll flags
+#define ARTCODEC_POLL_ON_CHANGE     0x02
+#define ARTCODEC_POLL_DIAG          0x04
+#define ARTCODEC_POLL_DIAG_UNICAST  0x08
+#define ARTCODEC_POLL_TARGETED      0x20
+
+// Diagnostics priorities
+#define ARTCODEC_DP_LOW         0x10
+#define ARTCODEC_DP_MED         0x40
+#define ARTCODEC_DP_HIGH        0x80
+#define ARTCODEC_DP_CRITICAL    0xe0
+#define ARTCODEC_DP_VOLATILE    0xf0
+
+// ArtTodControl commands
+#define ARTCODEC_ATC_FLUSH      0x01
+
+// Every OpCode: name, value, length of the fixed part, then the packet's
+// count of trailing data, if it has one: offset, 1 or 2 bytes, bytes per
+// count and the largest count allowed, and flags
+#define ARTCODEC_EXACT          0x01    // the trailing data ends the packet
+#define ARTCODEC_NO_VERSION     0x02    // no ProtVer, ArtPollReply
+
+#define ARTCODEC_OPS(X)                                                    \
+    X(POLL,                 0x2000,  14,  0, 0, 0,   0, 0)                 \
+    X(POLL_REPLY,           0x2100, 207,  0, 0, 0,   0, ARTCODEC_NO_VERSION) \
+    X(DIAG_DATA,            0x2300,  18, 16, 2, 1, 512, 0)                 \
+    X(COMMAND,              0x2400,  16, 14, 2, 1, 512, 0)                 \
+    X(DATA_REQUEST,         0x2700,  18,  0, 0, 0,   0, 0)                 \
+    X(DATA_REPLY,           0x2800,  20, 18, 2, 1, 512, 0)                 \
+    X(DMX,                  0x5000,  18, 16, 2, 1, 512, ARTCODEC_EXACT)    \
+    X(NZS,                  0x5100,  18, 16, 2, 1, 512, ARTCODEC_EXACT)    \
+    X(SYNC,                 0x5200,  14,  0, 0, 0,   0, 0)                 \
+    X(ADDRESS,              0x6000, 107,  0, 0, 0,   0, 0)                 \
+    X(INPUT,                0x7000,  20,  0, 0, 0,   0, 0)                 \
+    X(TOD_REQUEST,          0x8000,  24, 23, 1, 1,  32, 0)                 \
+    X(TOD_DATA,             0x8100,  28, 27, 1, 6, 200, 0)                 \
+    X(TOD_CONTROL,          0x8200,  24,  0, 0, 0,   0, 0)                 \
+    X(RDM,                  0x8300,  24,  0, 0, 0,   0, 0)                 \
+    X(RDM_SUB,              0x8400,  32,  0, 0, 0,   0, 0)                 \
+    X(MEDIA,                0x9000,  12,  0, 0, 0,   0, 0)                 \
+    X(MEDIA_PATCH,          0x9100,  12,  0, 0, 0,   0, 0)                 \
+    X(MEDIA_CONTROL,        0x9200,  12,  0, 0, 0,   0, 0)                 \
+    X(MEDIA_CONTROL_REPLY,  0x9300,  12,  0, 0, 0,   0, 0)                 \
+    X(TIME_CODE,            0x9700,  19,  0, 0, 0,   0, 0)                 \
+    X(TIME_SYNC,            0x9800,  12,  0, 0, 0,   0, 0)                 \
+    X(TRIGGER,              0x9900,  18,  0, 0, 0,   0, 0)                 \
+    X(DIRECTORY,            0x9a00,  12,  0, 0, 0,   0, 0)                 \
+    X(DIRECTORY_REPLY,      0x9b00,  12,  0, 0, 0,   0, 0)                 \
+    X(VIDEO_SETUP,          0xa010,  12,  0, 0, 0,   0, 0)                 \
+    X(VIDEO_PALETTE,        0xa020,  12,  0, 0, 0,   0, 0)                 \
+    X(VIDEO_DATA,           0xa040,  12,  0, 0, 0,   0, 0)                 \
+    X(MAC_MASTER,           0xf000,  12,  0, 0, 0,   0, 0)                 \
+    X(MAC_SLAVE,            0xf100,  12,  0, 0, 0,   0, 0)                 \
+    X(FIRMWARE_MASTER,      0xf200,  40,  0, 0, 0,   0, 0)                 \
+    X(FIRMWARE_REPLY,       0xf300,  36,  0, 0, 0,   0, 0)                 \
+    X(FILE_TN_MASTER,       0xf400,  12,  0, 0, 0,   0, 0)                 \
+    X(FILE_FN_MASTER,       0xf500,  12,  0, 0, 0,   0, 0)                 \
+    X(FILE_FN_REPLY,        0xf600,  12,  0, 0, 0,   0, 0)                 \
+    X(IP_PROG,              0xf800,  26,  0, 0, 0,   0, 0)                 \
+    X(IP_PROG_REPLY,        0xf900,  27,  0, 0, 0,   0, 0)
+
+typedef enum {
+#define ARTCODEC_OPCODE(name, code, ...) ARTNET_OP_##name = code,
+    ARTCODEC_OPS(ARTCODEC_OPCODE)
+#undef ARTCODEC_OPCODE
+} artcodec_opcode_t;
+
+// Dense index of an OpCode, for dispatch tables
+typedef enum {
+#define ARTCODEC_INDEX(name, ...) ARTCODEC_OP_##name,
+    ARTCODEC_OPS(ARTCODEC_INDEX)
+#undef ARTCODEC_INDEX
+    ARTCODEC_OP_COUNT,
+} artcodec_op_index_t;
+
+typedef struct {
+    const char *name;
+    uint16_t opcode;
+    uint16_t min_len;
+    uint16_t count_max;
+    uint8_t count_at;
+    uint8_t count_size;     // 0 without a count
+    uint8_t count_unit;
+    uint8_t flags;
+    uint8_t index;
+} artcodec_op_t;
+
+extern const artcodec_op_t artcodec_ops[ARTCODEC_OP_COUNT];
+
+typedef enum {
+    ARTCODEC_OK,
+    ARTCODEC_SHORT,         // shorter than the header
+    ARTCODEC_BAD_ID,
+    ARTCODEC_BAD_VERSION,
+    ARTCODEC_UNKNOWN,       // OpCode not in the spec
+    ARTCODEC_TRUNCATED,     // shorter than the OpCode's fixed part
+    ARTCODEC_BAD_LENGTH,    // count disagrees with the packet length
+    ARTCODEC_TOO_LONG,      // count over the OpCode's maximum
+} artcodec_status_t;
+
+// Packet views, byte aligned so they lay over any buffer
+
+typedef struct __attribute__((packed)) {
+    uint8_t id[8];
+    uint8_t opcode[2];
+    uint8_t version[2];
+} artcodec_header_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t flags;
+    uint8_t diag_priority;
+    uint8_t target_top[2];      // Art-Net 4, with ARTCODEC_POLL_TARGETED
+    uint8_t target_bottom[2];
+} artcodec_poll_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t id[8];
+    uint8_t opcode[2];
+    uint8_t ip[4];
+    uint8_t port[2];
+    uint8_t version_info[2];
+    uint8_t net_switch;
+    uint8_t sub_switch;
+    uint8_t oem[2];
+    uint8_t ubea_version;
+    uint8_t status1;
+    uint8_t esta_man[2];
+    char short_name[18];
+    char long_name[64];
+    char node_report[64];
+    uint8_t num_ports[2];
+    uint8_t port_types[4];
+    uint8_t good_input[4];
+    uint8_t good_output[4];
+    uint8_t sw_in[4];
+    uint8_t sw_out[4];
+    uint8_t acn_priority;
+    uint8_t sw_macro;
+    uint8_t sw_remote;
+    uint8_t spare[3];
+    uint8_t style;
+    uint8_t mac[6];
+    uint8_t bind_ip[4];
+    uint8_t bind_index;
+    uint8_t status2;
+    uint8_t good_output_b[4];
+    uint8_t status3;
+    uint8_t default_responder[6];
+    uint8_t user[2];
+    uint8_t refresh_rate[2];
+    uint8_t filler[11];
+} artcodec_poll_reply_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t filler1;
+    uint8_t priority;
+    uint8_t logical_port;
+    uint8_t filler3;
+    uint8_t length[2];
+    char data[];
+} artcodec_diag_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t esta_man[2];
+    uint8_t length[2];
+    char data[];
+} artcodec_command_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t sequence;
+    uint8_t physical;
+    uint8_t sub_uni;
+    uint8_t net;
+    uint8_t length[2];
+    uint8_t data[];
+} artcodec_dmx_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t sequence;
+    uint8_t start_code;
+    uint8_t sub_uni;
+    uint8_t net;
+    uint8_t length[2];
+    uint8_t data[];
+} artcodec_nzs_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t aux[2];
+} artcodec_sync_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t net_switch;
+    uint8_t bind_index;
+    char short_name[18];
+    char long_name[64];
+    uint8_t sw_in[4];
+    uint8_t sw_out[4];
+    uint8_t sub_switch;
+    uint8_t acn_priority;
+    uint8_t command;
+} artcodec_address_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t filler1;
+    uint8_t bind_index;
+    uint8_t num_ports[2];
+    uint8_t input[4];
+} artcodec_input_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t filler[2];
+    uint8_t spare[7];
+    uint8_t net;
+    uint8_t command;
+    uint8_t add_count;
+    uint8_t address[];          // low bytes of the Port-Addresses
+} artcodec_tod_request_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t rdm_version;
+    uint8_t port;
+    uint8_t spare[6];
+    uint8_t bind_index;
+    uint8_t net;
+    uint8_t command_response;
+    uint8_t address;
+    uint8_t uid_total[2];
+    uint8_t block_count;
+    uint8_t uid_count;
+    uint8_t tod[][6];
+} artcodec_tod_data_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t filler[2];
+    uint8_t spare[7];
+    uint8_t net;
+    uint8_t command;
+    uint8_t address;
+} artcodec_tod_control_t;
+
+typedef struct __attribute__((packed)) {
+    artcodec_header_t header;
+    uint8_t filler[2];
+    uint8_t frames;
+    uint8_t seconds;
+    uint8_t minutes;
+    uint8_t hours;
+    uint8_t type;
+} artcodec_time_code_t;
+
+// A parsed packet. The views all point at the received buffer; op is set
+// once the OpCode is known, even when the packet is then rejected, and
+// count is the packet's count of trailing data: slots, text bytes, UIDs.
+typedef struct {
+    union {
+        const uint8_t *raw;
+        const artcodec_header_t *header;
+        const artcodec_poll_t *poll;
+        const artcodec_poll_reply_t *poll_reply;
+        const artcodec_diag_t *diag;
+        const artcodec_command_t *command;
+        const artcodec_dmx_t *dmx;
+        const artcodec_nzs_t *nzs;
+        const artcodec_sync_t *sync;
+        const artcodec_address_t *address;
+        const artcodec_input_t *input;
+        const artcodec_tod_request_t *tod_request;
+        const artcodec_tod_data_t *tod_data;
+        const artcodec_tod_control_t *tod_control;
+        const artcodec_time_code_t *time_code;
+    };
+    size_t len;
+    const artcodec_op_t *op;
+    uint16_t opcode;
+    uint16_t version;
+    uint16_t count;
+} artcodec_packet_t;
+
+static inline uint16_t artcodec_be16(const uint8_t p[2])
+{
+    return p[0] << 8 | p[1];
+}
+
+static inline void artcodec_put_be16(uint8_t p[2], uint16_t value)
+{
+    p[0] = value >> 8;
+    p[1] = value & 0xff;
+}
+
+// Port-Address of ArtDmx and ArtNzs, 15 bits
+static inline uint16_t artcodec_port_address(uint8_t net, uint8_t sub_uni)
+{
+    return 0x7fff & (net << 8 | sub_uni);
+}
+
+artcodec_status_t artcodec_parse(const uint8_t *buf, size_t len, artcodec_packet_t *packet);
+
+// NULL for OpCodes not in the spec
+const artcodec_op_t *artcodec_op(uint16_t opcode);
+
+const char *artcodec_status_name(artcodec_status_t status);
+
+// ID, OpCode and ProtVer
+void artcodec_encode_header(uint8_t *buf, uint16_t opcode);
+
+// Completes an ArtDmx around count slots the caller already wrote at
+// buf[ARTCODEC_DMX_HEADER_LEN], so the slots are never copied. The length
+// has to be even, an odd count gets a zero slot. Returns the packet length.
+size_t artcodec_encode_dmx(uint8_t *buf, uint8_t sequence, uint8_t physical,
+        uint16_t port_address, size_t count);
+
+// ArtPollReply with the header, address and Art-Net port filled in and
+// everything else zero, for the caller to describe its ports through the view
+void artcodec_encode_poll_reply(artcodec_poll_reply_t *reply, uint32_t ip, uint8_t bind_index);
+
+// ArtDiagData carrying text, cut short to fit size and
+// ARTCODEC_DIAG_MAX. Returns the packet length, 0 if size is too small.
+size_t artcodec_encode_diag(uint8_t *buf, size_t size, uint8_t priority, uint8_t logical_port,
+        const char *text);
+
+// ArtTodData for the port at port_address (port 1-4 of bind_index)
+// carrying count UIDs of 6 bytes as block `block` of a uid_total long TOD.
+// Returns the packet length, 0 if it does not fit size.
+size_t artcodec_encode_tod_data(uint8_t *buf, size_t size, uint16_t port_address, uint8_t port,
+        uint8_t bind_index, uint16_t uid_total, uint8_t block, const uint8_t *uids, size_t count);
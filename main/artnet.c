@@ -2,28 +2,98 @@
 // Assumes a full UDP message is passed as one
 //
 
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <arpa/inet.h>
+#include <sys/select.h>
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "artcodec.h"
+#include "artnet.h"
+#include "artpoll.h"
 #include "common.h"
 #include "dmxtask.h"
+#include "ingest.h"
+#include "latency.h"
+#include "merge.h"
+#if CONFIG_ARTNET_ZERO_COPY
+#include "netrx.h"
+#endif
+#include "playout.h"
+#include "route.h"
+#include "rxbatch.h"
+#include "sacn.h"
+#include "trace.h"
+#include "wifitask.h"
 
 #include "driver/gpio.h"
 
-#define ARTNET_MAGIC_HEADER "Art-Net\0"
-#define ARTNET_MAGIC_HEADER_LEN 8
-
-#define PORT 6454
+#define PORT ARTNET_PORT
 
 #define ARTNET_DEBUG_PIN           GPIO_NUM_22
 
-// Nice to have, sync packet latches new data
-//static boolean synchronous = false;
+// Replies to ArtPoll are delayed by up to this long so a subnet full of
+// nodes does not answer a broadcast poll all at once
+#define ARTNET_POLL_MAX_DELAY_MS 1000
+#define ARTNET_POLL_PENDING_MAX  4
+
+// Streams tracked for sequence order, a universe per output from each of
+// the sources it can merge
+#define ARTNET_SEQ_STREAMS (DMX_OUTPUT_COUNT * MERGE_SOURCES)
+// Packets up to this far behind are late, anything further back is taken
+// as the controller restarting its sequence
+#define ARTNET_SEQ_WINDOW 20
+// After this much silence a stream starts over with whatever comes next
+#define ARTNET_SEQ_TIMEOUT_MS 1000
+
+// Datagrams read from each socket before the outputs are committed
+#define ARTNET_DRAIN_MAX 32
+
+// Without ArtSync for this long the node falls back to committing each
+// ArtDmx as it arrives, as required by the spec
+#define ARTNET_SYNC_TIMEOUT_MS 4000
+
+// In synchronous mode ArtSync latches new data: ArtDmx only fills the
+// output work buffers and the outputs are committed together on ArtSync
+static bool synchronous = false;
+static TickType_t last_sync_tick = 0;
+// ArtSync is only accepted from the controller that sends us ArtDmx
+static uint32_t dmx_source_ip = 0;
+
+// Controllers waiting for ArtPollReply, answered together once the random
+// delay of the first poll has passed
+static uint32_t poll_pending_ip[ARTNET_POLL_PENDING_MAX];
+static size_t poll_pending_count = 0;
+static TickType_t poll_reply_due = 0;
+// Controller that asked for a reply whenever our status changes
+static uint32_t poll_subscriber_ip = 0;
+// Controller that asked for diagnostics, and the lowest priority it wants
+static uint32_t diag_subscriber_ip = 0;
+static uint8_t diag_priority = ARTCODEC_DP_LOW;
+
+typedef struct {
+    uint32_t source_ip;
+    TickType_t last_seen;
+    uint16_t universe;
+    uint8_t seq;
+    uint8_t coalesced;      // older frames rxbatch dropped, not yet in a gap
+    bool used;
+} artnet_seq_stream_t;
+
+static artnet_seq_stream_t seq_streams[ARTNET_SEQ_STREAMS];
+static artnet_seq_stats_t seq_stats;
 
 static const char *TAG = "ART-NET";
 
@@ -31,74 +101,597 @@ extern enum state_ state;
 
 static uint8_t *lights = NULL;
 
+// Where ArtPollReply goes out from, the Art-Net port's socket or netconn
+#if CONFIG_ARTNET_ZERO_COPY
+static netrx_t artnet_rx;
+#else
+static int artnet_sock = -1;
+#endif
+
+static TaskHandle_t task_handle = NULL;
+
 void init(uint8_t *light_data_buf)
 {
     lights = light_data_buf;
+    route_init();
+    artpoll_init();
+    playout_init();
     gpio_set_direction(ARTNET_DEBUG_PIN, GPIO_MODE_OUTPUT);
     gpio_set_level(ARTNET_DEBUG_PIN, 0);
 }
 
-// TODO: respond to poll
-bool handle_artnet(uint8_t *artnet_buf, size_t artnet_buf_len)
+static void leave_synchronous(void)
 {
-    if (artnet_buf_len < 13)
+    synchronous = false;
+    ingest_commit_deferred();
+}
+
+static bool merging(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
     {
-        ESP_LOGW(TAG, "packet too short");
-        // Shortest packet is probably ArtPoll
-        return false;
+        if (merge_active(output) == 0x03)
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-    if (memcmp(artnet_buf, ARTNET_MAGIC_HEADER, ARTNET_MAGIC_HEADER_LEN) != 0)
+static bool send_reply(const uint8_t *reply, size_t len, uint32_t ip)
+{
+#if CONFIG_ARTNET_ZERO_COPY
+    return netrx_sendto(&artnet_rx, reply, len, ip, PORT);
+#else
+    if (artnet_sock < 0)
     {
-        ESP_LOGW(TAG, "incorrect magic value");
-        // Not an artnet packet
         return false;
     }
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = ip,
+    };
+    return sendto(artnet_sock, reply, len, 0, (struct sockaddr *)&dest, sizeof(dest)) >= 0;
+#endif
+}
 
-    uint16_t opcode = artnet_buf[8] | artnet_buf[9] << 8;
-    uint16_t protver = artnet_buf[10] << 8 | artnet_buf[11];
+// ArtDiagData to the controller that asked for it with ArtPoll. It goes
+// unicast even when broadcast was asked for, the node has no business
+// flooding the subnet with its log.
+static void send_diag(uint8_t priority, const char *text)
+{
+    if (diag_subscriber_ip == 0 || priority < diag_priority)
+    {
+        return;
+    }
+    uint8_t packet[sizeof(artcodec_diag_t) + 64];
+    size_t len = artcodec_encode_diag(packet, sizeof(packet), priority, 0, text);
+    send_reply(packet, len, diag_subscriber_ip);
+}
 
-    if (protver != 14)
+static void handle_artsync(const artcodec_packet_t *packet, uint32_t source_ip)
+{
+    if (dmx_source_ip != 0 && source_ip != dmx_source_ip)
     {
-        ESP_LOGW(TAG, "Protocol version is not 14");
-        return false;
+        trace_event(TRACE_ARTSYNC_FOREIGN, 0, source_ip);
+        ESP_LOGD(TAG, "Ignoring ArtSync from a foreign controller");
+        return;
+    }
+    if (merging())
+    {
+        // The spec has ArtSync ignored while merging
+        if (synchronous)
+        {
+            trace_event(TRACE_ARTSYNC_LEAVE, 0, 0);
+            ESP_LOGI(TAG, "Merging, leaving synchronous mode");
+            send_diag(ARTCODEC_DP_LOW, "Merging, leaving synchronous mode");
+            leave_synchronous();
+        }
+        return;
+    }
+    if (!synchronous)
+    {
+        trace_event(TRACE_ARTSYNC_ENTER, 0, source_ip);
+        ESP_LOGI(TAG, "Entering synchronous mode");
+        send_diag(ARTCODEC_DP_LOW, "Entering synchronous mode");
+        synchronous = true;
     }
+    last_sync_tick = xTaskGetTickCount();
+    ingest_commit_deferred();
+}
 
-    if (opcode == 0x5000)
+static void handle_artpoll(const artcodec_packet_t *packet, uint32_t source_ip)
+{
+    const artcodec_poll_t *poll = packet->poll;
+    if (poll->flags & ARTCODEC_POLL_TARGETED && packet->len >= sizeof(artcodec_poll_t))
     {
-        //uint8_t seq = (uint8_t)artnet_buf[12];
-        //uint8_t phys = (uint8_t)artnet_buf[13];
-        uint16_t universe = 0x7fff & (artnet_buf[14] | artnet_buf[15] << 8);
-        uint16_t datalen = artnet_buf[16] << 8 | artnet_buf[17];
+        uint16_t top = artcodec_be16(poll->target_top);
+        uint16_t bottom = artcodec_be16(poll->target_bottom);
+        if (!artpoll_targets(bottom, top))
+        {
+            return;
+        }
+    }
+    if (poll->flags & ARTCODEC_POLL_ON_CHANGE)
+    {
+        poll_subscriber_ip = source_ip;
+    }
+    if (poll->flags & ARTCODEC_POLL_DIAG)
+    {
+        diag_subscriber_ip = source_ip;
+        diag_priority = poll->diag_priority;
+    }
+    else if (diag_subscriber_ip == source_ip)
+    {
+        diag_subscriber_ip = 0;
+    }
 
-        if (datalen != artnet_buf_len - 18)
+    for (size_t i = 0; i < poll_pending_count; i++)
+    {
+        if (poll_pending_ip[i] == source_ip)
         {
-            // Header is 18 bytes
-            ESP_LOGW(TAG, "packet content length does not match header data");
-            return false;
+            return;
         }
+    }
+    if (poll_pending_count == ARTNET_POLL_PENDING_MAX)
+    {
+        ESP_LOGD(TAG, "Too many pending polls, dropping one");
+        return;
+    }
+    if (poll_pending_count == 0)
+    {
+        poll_reply_due = xTaskGetTickCount() +
+            pdMS_TO_TICKS(esp_random() % (ARTNET_POLL_MAX_DELAY_MS + 1));
+    }
+    poll_pending_ip[poll_pending_count++] = source_ip;
+}
 
-        // TODO: Configurable universe
-        if (universe == 0)
+
+static void send_poll_replies(uint32_t ip)
+{
+    const uint8_t *replies;
+    size_t count = artpoll_replies(&replies);
+    trace_event(TRACE_ARTPOLL_REPLY, count, ip);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!send_reply(&replies[i * ARTPOLL_REPLY_LEN], ARTPOLL_REPLY_LEN, ip))
         {
-            //ESP_LOGI(TAG, "1-1: %d", artnet_buf[18]);
+            ESP_LOGW(TAG, "ArtPollReply not sent");
+        }
+    }
+}
+
+// Sends whatever replies are due, returns the ticks until the next one or
+// portMAX_DELAY when nothing is waiting
+static TickType_t service_polls(void)
+{
+    if (poll_subscriber_ip != 0 && artpoll_take_changed())
+    {
+        send_poll_replies(poll_subscriber_ip);
+    }
+    if (poll_pending_count == 0)
+    {
+        return portMAX_DELAY;
+    }
+    TickType_t remaining = poll_reply_due - xTaskGetTickCount();
+    if ((int32_t)remaining > 0)
+    {
+        return remaining;
+    }
+    for (size_t i = 0; i < poll_pending_count; i++)
+    {
+        send_poll_replies(poll_pending_ip[i]);
+    }
+    poll_pending_count = 0;
+    return portMAX_DELAY;
+}
+
+// Services whatever is due, returns how long the task may sleep until a
+// poll reply or a buffered frame is next due, UINT32_MAX
+// for as long as it likes
+static uint32_t service_timers(void)
+{
+    TickType_t poll_wait = service_polls();
+    uint32_t wait_us = ingest_playout();
+    if (poll_wait != portMAX_DELAY && poll_wait * portTICK_PERIOD_MS * 1000 < wait_us) {
+        wait_us = poll_wait * portTICK_PERIOD_MS * 1000;
+    }
+    return wait_us;
+}
 
-            dmx_write_multiple(1, &artnet_buf[18], datalen);
-            //memcpy(get_dmx_buf(), &artnet_buf[18], datalen);
+static artnet_seq_stream_t *seq_stream(uint16_t universe, uint32_t source_ip, TickType_t now)
+{
+    artnet_seq_stream_t *oldest = &seq_streams[0];
+    for (size_t i = 0; i < ARTNET_SEQ_STREAMS; i++)
+    {
+        artnet_seq_stream_t *stream = &seq_streams[i];
+        if (stream->used && stream->universe == universe && stream->source_ip == source_ip)
+        {
+            return stream;
         }
+        if (!stream->used)
+        {
+            oldest = stream;
+        }
+        else if (oldest->used && now - stream->last_seen > now - oldest->last_seen)
+        {
+            oldest = stream;
+        }
+    }
+    oldest->used = false;
+    oldest->universe = universe;
+    oldest->source_ip = source_ip;
+    return oldest;
+}
+
+// Sequence numbers run 1..255 and wrap to 1, 0 means the controller does
+// not sequence its packets. Returns false for late and duplicate packets.
+// Distance on the 255 step ring of non-zero sequences, folded into -127..127
+static int seq_delta(uint8_t seq, uint8_t prev)
+{
+    int delta = (int)seq - prev;
+    if (delta > 127)
+    {
+        delta -= 255;
+    }
+    else if (delta < -127)
+    {
+        delta += 255;
+    }
+    return delta;
+}
+
+bool artnet_seq_follows(uint8_t seq, uint8_t prev)
+{
+    if (seq == 0 || prev == 0)
+    {
+        return true;
+    }
+    int delta = seq_delta(seq, prev);
+    return delta > 0 || delta <= -ARTNET_SEQ_WINDOW;
+}
+
+static bool sequence_ok(uint16_t universe, uint32_t source_ip, uint8_t seq)
+{
+    if (seq == 0)
+    {
+        return true;
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    artnet_seq_stream_t *stream = seq_stream(universe, source_ip, now);
+    bool fresh = !stream->used ||
+        now - stream->last_seen > pdMS_TO_TICKS(ARTNET_SEQ_TIMEOUT_MS);
+
+    if (fresh)
+    {
+        stream->coalesced = 0;
     }
     else
     {
-        ESP_LOGD(TAG, "Unknown packet opcode %04x", opcode);
+        int delta = seq_delta(seq, stream->seq);
+        if (delta == 0)
+        {
+            seq_stats.duplicates++;
+            return false;
+        }
+        if (delta < 0 && delta > -ARTNET_SEQ_WINDOW)
+        {
+            seq_stats.reordered++;
+            return false;
+        }
+        if (delta > 1)
+        {
+            // Frames coalesced on the node fill the gap, only the rest
+            // went missing on the way
+            uint32_t skipped = delta - 1;
+            uint32_t coalesced = stream->coalesced < skipped ? stream->coalesced : skipped;
+            stream->coalesced -= coalesced;
+            seq_stats.lost += skipped - coalesced;
+        }
+    }
+
+    stream->used = true;
+    stream->seq = seq;
+    stream->last_seen = now;
+    return true;
+}
+
+void artnet_seq_coalesced(uint16_t universe, uint32_t source_ip)
+{
+    artnet_seq_stream_t *stream = seq_stream(universe, source_ip, xTaskGetTickCount());
+    if (stream->coalesced < UINT8_MAX)
+    {
+        stream->coalesced++;
+    }
+}
+
+void artnet_get_seq_stats(artnet_seq_stats_t *stats)
+{
+    *stats = seq_stats;
+}
+
+bool artnet_dmx_universe(const uint8_t *artnet_buf, size_t artnet_buf_len, uint16_t *universe,
+        uint8_t *seq)
+{
+    const artcodec_dmx_t *dmx = (const artcodec_dmx_t *)artnet_buf;
+    if (artnet_buf_len < ARTCODEC_DMX_HEADER_LEN ||
+            (dmx->header.opcode[0] | dmx->header.opcode[1] << 8) != ARTNET_OP_DMX)
+    {
+        return false;
     }
+    *universe = artcodec_port_address(dmx->net, dmx->sub_uni);
+    *seq = dmx->sequence;
     return true;
+}
+
+static void handle_artdmx(const artcodec_packet_t *packet, uint32_t source_ip)
+{
+    const artcodec_dmx_t *dmx = packet->dmx;
+    uint16_t universe = artcodec_port_address(dmx->net, dmx->sub_uni);
+    uint8_t outputs = route_lookup(universe);
+    if (outputs == 0)
+    {
+        // Nobody listens to this universe
+        return;
+    }
+
+    if (!sequence_ok(universe, source_ip, dmx->sequence))
+    {
+        trace_event(TRACE_ARTDMX_OUT_OF_ORDER, universe, dmx->sequence);
+        ESP_LOGD(TAG, "Dropped out of order ArtDmx %d on universe %d", dmx->sequence, universe);
+        return;
+    }
+
+    dmx_source_ip = source_ip;
+
+    if (synchronous &&
+            xTaskGetTickCount() - last_sync_tick > pdMS_TO_TICKS(ARTNET_SYNC_TIMEOUT_MS))
+    {
+        trace_event(TRACE_ARTSYNC_LEAVE, 1, 0);
+        ESP_LOGI(TAG, "No ArtSync for %d ms, leaving synchronous mode",
+                ARTNET_SYNC_TIMEOUT_MS);
+        send_diag(ARTCODEC_DP_LOW, "No ArtSync, leaving synchronous mode");
+        leave_synchronous();
+    }
+
+    ingest_dmx(outputs, source_ip, dmx->data, packet->count, synchronous);
+}
+
+// Answers with an empty table for every output at the Port-Address, the
+// node has no RDM ports but controllers that ask anyway get an answer
+static void send_tod(uint16_t port_address, uint32_t ip)
+{
+    uint8_t outputs = route_lookup(port_address & 0x7fff);
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        if (!(outputs & (1 << output)))
+        {
+            continue;
+        }
+        uint8_t bind_index;
+        uint8_t port;
+        artpoll_port(output, &bind_index, &port);
+        uint8_t packet[sizeof(artcodec_tod_data_t)];
+        size_t len = artcodec_encode_tod_data(packet, sizeof(packet), port_address, port,
+                bind_index, 0, 0, NULL, 0);
+        send_reply(packet, len, ip);
+    }
+}
+
+static void handle_todrequest(const artcodec_packet_t *packet, uint32_t source_ip)
+{
+    const artcodec_tod_request_t *request = packet->tod_request;
+    for (size_t i = 0; i < packet->count; i++)
+    {
+        send_tod(request->net << 8 | request->address[i], source_ip);
+    }
+}
+
+static void handle_todcontrol(const artcodec_packet_t *packet, uint32_t source_ip)
+{
+    const artcodec_tod_control_t *control = packet->tod_control;
+    if (control->command == ARTCODEC_ATC_FLUSH)
+    {
+        send_tod(control->net << 8 | control->address, source_ip);
+    }
+}
+
+typedef void (*artnet_handler_t)(const artcodec_packet_t *packet, uint32_t source_ip);
+
+// What the node does with the packets it acts on, the rest of Art-Net is
+// for other kinds of device and ignored
+static const artnet_handler_t handlers[ARTCODEC_OP_COUNT] = {
+    [ARTCODEC_OP_DMX] = handle_artdmx,
+    [ARTCODEC_OP_SYNC] = handle_artsync,
+    [ARTCODEC_OP_POLL] = handle_artpoll,
+    [ARTCODEC_OP_TOD_REQUEST] = handle_todrequest,
+    [ARTCODEC_OP_TOD_CONTROL] = handle_todcontrol,
 };
 
-static void artnet_worker(void *pvParameters)
+// Malformed packets keep the trace events they always had, so existing
+// traces read the same
+static trace_event_t malformed_event(artcodec_status_t status, const artcodec_op_t *op)
+{
+    switch (status)
+    {
+        case ARTCODEC_SHORT:
+            return TRACE_ARTNET_SHORT;
+        case ARTCODEC_BAD_ID:
+            return TRACE_ARTNET_BAD_MAGIC;
+        case ARTCODEC_BAD_VERSION:
+            return TRACE_ARTNET_BAD_VERSION;
+        case ARTCODEC_TRUNCATED:
+            return op->index == ARTCODEC_OP_DMX ? TRACE_ARTDMX_TRUNCATED :
+                op->index == ARTCODEC_OP_POLL ? TRACE_ARTPOLL_TRUNCATED :
+                op->index == ARTCODEC_OP_SYNC ? TRACE_ARTSYNC_TRUNCATED : TRACE_ARTNET_TRUNCATED;
+        case ARTCODEC_TOO_LONG:
+            return op->index == ARTCODEC_OP_DMX ? TRACE_ARTDMX_TOO_LONG : TRACE_ARTNET_BAD_LENGTH;
+        default:
+            return op->index == ARTCODEC_OP_DMX ? TRACE_ARTDMX_LEN_MISMATCH : TRACE_ARTNET_BAD_LENGTH;
+    }
+}
+
+static void report_malformed(artcodec_status_t status, const artcodec_packet_t *packet,
+        uint32_t source_ip)
+{
+    trace_event_t event = malformed_event(status, packet->op);
+    // The packet length, or whatever in it was wrong
+    uint16_t arg = status == ARTCODEC_BAD_VERSION ? packet->version :
+        status >= ARTCODEC_BAD_LENGTH ? packet->count : packet->len;
+    const char *name = packet->op != NULL ? packet->op->name : "packet";
+
+    uint32_t suppressed;
+    trace_event(event, arg, source_ip);
+    if (trace_log_allowed(event, &suppressed))
+    {
+        char text[64];
+        snprintf(text, sizeof(text), "%s %s (%u)", name, artcodec_status_name(status),
+                (unsigned)arg);
+        ESP_LOGW(TAG, "%s", text);
+        if (suppressed > 0)
+        {
+            ESP_LOGW(TAG, "%u more suppressed", (unsigned)suppressed);
+        }
+        send_diag(ARTCODEC_DP_MED, text);
+    }
+}
+
+bool handle_artnet(const uint8_t *artnet_buf, size_t artnet_buf_len, uint32_t source_ip)
+{
+    artcodec_packet_t packet;
+    artcodec_status_t status = artcodec_parse(artnet_buf, artnet_buf_len, &packet);
+    if (status == ARTCODEC_UNKNOWN)
+    {
+        ESP_LOGD(TAG, "Unknown packet opcode %04x", packet.opcode);
+        return true;
+    }
+    if (status != ARTCODEC_OK)
+    {
+        report_malformed(status, &packet, source_ip);
+        return false;
+    }
+
+    artnet_handler_t handler = handlers[packet.op->index];
+    if (handler != NULL)
+    {
+        handler(&packet, source_ip);
+    }
+    else
+    {
+        ESP_LOGD(TAG, "Ignoring Op%s", packet.op->name);
+    }
+    return true;
+}
+
+// Reads every datagram queued on sock without blocking, up to
+// ARTNET_DRAIN_MAX per batch so a flood cannot hold back the commit
+static bool drain(int sock, rxbatch_proto_t proto)
 {
     // IPv4 isn't too long for this
     char addr_str[32];
-    uint8_t rx_buffer[2048];
+
+    for (int drained = 0; drained < ARTNET_DRAIN_MAX; drained++) {
+        struct sockaddr_storage source_addr;
+        socklen_t addr_len = sizeof(source_addr);
+
+        int recv_len = recvfrom(sock, rxbatch_slot(), RXBATCH_SLOT_LEN, MSG_DONTWAIT,
+                (struct sockaddr*) &source_addr, &addr_len);
+        if (recv_len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+            return false;
+        }
+
+        uint32_t source_ip = 0;
+        if (source_addr.ss_family == PF_INET) {
+            inet_ntop(AF_INET, &((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+            source_ip = ((struct sockaddr_in *)&source_addr)->sin_addr.s_addr;
+            ESP_LOGD(TAG, "data from address: %s", addr_str);
+        }
+
+        rxbatch_push(proto, recv_len, source_ip);
+    }
+    return true;
+}
+
+#if CONFIG_ARTNET_ZERO_COPY
+
+static void wake(void)
+{
+    xTaskNotifyGive(task_handle);
+}
+
+// Same loop as below, but lwIP's receive callback wakes the task and the
+// datagrams are handed on where lwIP received them (netrx.h)
+static void artnet_worker(void *pvParameters)
+{
+    // Started along with everything else at boot, the network comes up
+    // in its own time
+    wifi_wait_connected();
+    latency_boot_mark(LATENCY_BOOT_NETWORK_UP);
+
+    netrx_init(wake);
+    if (!netrx_open(&artnet_rx, PORT, RXBATCH_ARTNET)) {
+        state = STATE_ERROR;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    netrx_t sacn_rx = { 0 };
+#if CONFIG_SACN_ENABLE
+    if (netrx_open(&sacn_rx, SACN_PORT, RXBATCH_SACN)) {
+        for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++) {
+            netrx_join(&sacn_rx, sacn_group(output));
+        }
+    }
+#endif
+
+    while (1) {
+        assert(state == STATE_IDLE);
+
+        uint32_t wait_us = service_timers();
+        // Rounded up, waking a tick late beats spinning through a timeout
+        // that comes back as 0 ticks
+        TickType_t wait = wait_us == UINT32_MAX ? portMAX_DELAY :
+            pdMS_TO_TICKS(wait_us / 1000) + 1;
+        if (ulTaskNotifyTake(pdTRUE, wait) == 0) {
+            continue;
+        }
+
+        gpio_set_level(ARTNET_DEBUG_PIN, 1);
+        rxbatch_begin();
+        int drained = netrx_drain(&artnet_rx, ARTNET_DRAIN_MAX);
+        int sacn_drained = 0;
+        if (drained >= 0 && sacn_rx.conn != NULL) {
+            sacn_drained = netrx_drain(&sacn_rx, ARTNET_DRAIN_MAX);
+        }
+        rxbatch_end();
+        gpio_set_level(ARTNET_DEBUG_PIN, 0);
+        if (drained < 0 || sacn_drained < 0) {
+            break;
+        }
+        // The wakeups for whatever a full batch left queued were taken
+        // with it, come straight back for the rest
+        if (drained == ARTNET_DRAIN_MAX || sacn_drained == ARTNET_DRAIN_MAX) {
+            xTaskNotifyGive(task_handle);
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+#else
+
+static void artnet_worker(void *pvParameters)
+{
+    // Started along with everything else at boot, the network comes up
+    // in its own time
+    wifi_wait_connected();
+    latency_boot_mark(LATENCY_BOOT_NETWORK_UP);
+
     int addr_family = AF_INET;
     int ip_protocol = 0;
     struct sockaddr_storage dest_addr;
@@ -109,8 +702,8 @@ static void artnet_worker(void *pvParameters)
     dest_addr_ip4->sin_port = htons(PORT);
     ip_protocol = IPPROTO_IP;
 
-    int listen_sock = socket(addr_family, SOCK_DGRAM, ip_protocol);
-    if (listen_sock < 0) {
+    artnet_sock = socket(addr_family, SOCK_DGRAM, ip_protocol);
+    if (artnet_sock < 0) {
         ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
         state = STATE_ERROR;
         vTaskDelete(NULL);
@@ -119,7 +712,7 @@ static void artnet_worker(void *pvParameters)
 
     ESP_LOGI(TAG, "Socket created");
 
-    int err = bind(listen_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+    int err = bind(artnet_sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
     if (err != 0) {
         ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
         ESP_LOGE(TAG, "IPPROTO: %d", addr_family);
@@ -128,56 +721,73 @@ static void artnet_worker(void *pvParameters)
     }
     ESP_LOGI(TAG, "Socket bound, port %d", PORT);
 
+    // sACN is read by this task too, so there is a single writer of the
+    // DMX buffers whichever protocol the data comes in on
+    int sacn_sock = -1;
+#if CONFIG_SACN_ENABLE
+    sacn_sock = sacn_socket_open();
+#endif
+
     while (1) {
 
         //ESP_LOGI(TAG, "Waiting for UDP data");
 
         assert(state == STATE_IDLE);
 
-        struct sockaddr_storage source_addr;
-        socklen_t addr_len = sizeof(source_addr);
-
-        int recv_len = recvfrom(listen_sock, rx_buffer, sizeof(rx_buffer) -1, 0,
-                (struct sockaddr*) &source_addr, &addr_len);
-
-        gpio_set_level(ARTNET_DEBUG_PIN, 1);
-        if (recv_len < 0) {
-            ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(artnet_sock, &readable);
+        if (sacn_sock >= 0) {
+            FD_SET(sacn_sock, &readable);
+        }
+        int max_sock = sacn_sock > artnet_sock ? sacn_sock : artnet_sock;
+
+        uint32_t wait_us = service_timers();
+        struct timeval timeout = {
+            .tv_sec = wait_us / 1000000,
+            .tv_usec = wait_us % 1000000,
+        };
+        int ready = select(max_sock + 1, &readable, NULL, NULL,
+                wait_us == UINT32_MAX ? NULL : &timeout);
+        if (ready == 0) {
+            continue;
+        }
+        if (ready < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
             break;
         }
 
-
-        if (source_addr.ss_family == PF_INET) {
-            inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+        gpio_set_level(ARTNET_DEBUG_PIN, 1);
+        rxbatch_begin();
+        bool ok = drain(artnet_sock, RXBATCH_ARTNET);
+        if (ok && sacn_sock >= 0) {
+            ok = drain(sacn_sock, RXBATCH_SACN);
         }
-
-        ESP_LOGD(TAG, "data from address: %s", addr_str);
-
-        handle_artnet(rx_buffer, recv_len);
+        rxbatch_end();
         gpio_set_level(ARTNET_DEBUG_PIN, 0);
+        if (!ok) {
+            break;
+        }
+    }
 
-        //shutdown(listen_sock, 0);
-        //close(listen_sock);
+    if (sacn_sock >= 0) {
+        close(sacn_sock);
     }
 
 CLEAN_UP:
-    close(listen_sock);
+    close(artnet_sock);
     vTaskDelete(NULL);
 }
 
+#endif
+
 #define STACK_SIZE 6000
 static StaticTask_t xTaskBuffer;
 static StackType_t xStack[ STACK_SIZE ];
-static TaskHandle_t task_handle = NULL;
 
 void artnet_task_start(void)
 {
     init(NULL);
-    while(state != STATE_IDLE) {
-        /* Wait for wifi task to connect to a network */
-        vTaskDelay(pdMS_TO_TICKS(100));
-    }
-
     task_handle = xTaskCreateStatic(
             artnet_worker,
             "arnet",
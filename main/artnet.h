@@ -1,11 +1,37 @@
 #ifndef ARTNET_H
 #define ARTNET_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 //void init(uint8_t *light_data_buf);
 
-//bool handle_artnet(uint8_t *artnet_buf, size_t artnet_buf_len);
+// ArtDmx sequence statistics. Lost counts frames skipped in the sequence
+// that did not reach the node, frames rxbatch coalesced are not lost.
+typedef struct {
+    uint32_t lost;
+    uint32_t reordered;     // arrived after a newer frame and dropped
+    uint32_t duplicates;
+} artnet_seq_stats_t;
+
+// source_ip is the sender's IPv4 address in network byte order
+bool handle_artnet(const uint8_t *artnet_buf, size_t artnet_buf_len, uint32_t source_ip);
+
+// Port-Address and sequence of an ArtDmx packet, without validating the
+// rest of it
+bool artnet_dmx_universe(const uint8_t *artnet_buf, size_t artnet_buf_len, uint16_t *universe,
+        uint8_t *seq);
+
+// Whether an ArtDmx with sequence seq is taken after one with prev from the
+// same sender and universe, as the sequence check would take it
+bool artnet_seq_follows(uint8_t seq, uint8_t prev);
+
+// An ArtDmx older than one queued after it was dropped unprocessed, so the
+// sequence check does not count it lost
+void artnet_seq_coalesced(uint16_t universe, uint32_t source_ip);
+
+void artnet_get_seq_stats(artnet_seq_stats_t *stats);
 
 void artnet_task_start(void);
 #endif // ARTNET_H
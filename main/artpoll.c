@@ -0,0 +1,221 @@
+#include <stdatomic.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "artcodec.h"
+#include "artpoll.h"
+#include "merge.h"
+
+#define ARTPOLL_PORTS_PER_REPLY 4
+
+#define PORT_TYPE_DMX_OUT       0x80
+#define PORT_TYPE_DMX_IN        0x40
+#define GOOD_INPUT_DATA         0x80
+#define GOOD_OUTPUT_DATA        0x80
+#define GOOD_OUTPUT_MERGING     0x08
+#define GOOD_OUTPUT_LTP         0x02
+// Indicators normal, Port-Addresses set from configuration
+#define STATUS1                 0xd0
+// 15-bit Port-Addresses
+#define STATUS2                 0x08
+
+static const char *TAG = "artpoll";
+
+static artcodec_poll_reply_t artpoll_reply[ARTPOLL_REPLY_MAX];
+static size_t artpoll_reply_count = 0;
+static uint16_t output_port_address[DMX_OUTPUT_COUNT];
+// Reply and port of each output, so status updates are a single store
+static artcodec_poll_reply_t *output_reply[DMX_OUTPUT_COUNT];
+static uint8_t output_port[DMX_OUTPUT_COUNT];
+static uint32_t own_ip = 0;
+#if CONFIG_DMX_INPUT
+static bool input_good = false;
+#endif
+static atomic_bool artpoll_changed;
+// Left by the setters other tasks call, written in by the network task
+static _Atomic uint32_t pending_ip;
+static atomic_bool pending_input_good;
+static atomic_bool artpoll_pending;
+
+static void build_header(artcodec_poll_reply_t *reply, uint8_t bind_index)
+{
+    artcodec_encode_poll_reply(reply, own_ip, bind_index);
+    artcodec_put_be16(reply->version_info, 1);
+    artcodec_put_be16(reply->oem, 0x00ff);
+    reply->status1 = STATUS1;
+    strncpy(reply->short_name, "onair", 17);
+    strncpy(reply->long_name, "onair Art-Net/sACN to DMX bridge", 63);
+    strncpy(reply->node_report, "#0001 [0000] Ok", 63);
+    reply->status2 = STATUS2;
+
+#if CONFIG_DMX_ADAPTIVE_LENGTH
+    uint16_t refresh = 1000000 / CONFIG_DMX_MIN_FRAME_US;
+#else
+    uint16_t refresh = CONFIG_DMX_REFRESH_HZ;
+#endif
+    artcodec_put_be16(reply->refresh_rate, refresh);
+}
+
+static uint8_t good_output(uint8_t output, bool merging)
+{
+    uint8_t status = GOOD_OUTPUT_DATA;
+    if (merging)
+    {
+        status |= GOOD_OUTPUT_MERGING;
+    }
+    if (merge_get_mode(output) == MERGE_LTP)
+    {
+        status |= GOOD_OUTPUT_LTP;
+    }
+    return status;
+}
+
+// Packs consecutive outputs into replies, a new one starts when four ports
+// are used or the net/subnet changes
+static void build_replies(void)
+{
+    artcodec_poll_reply_t *reply = NULL;
+    uint8_t ports = 0;
+
+    artpoll_reply_count = 0;
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        uint16_t pa = output_port_address[output];
+        if (reply == NULL || ports == ARTPOLL_PORTS_PER_REPLY ||
+                reply->net_switch != (pa >> 8) ||
+                reply->sub_switch != ((pa >> 4) & 0x0f))
+        {
+            reply = &artpoll_reply[artpoll_reply_count++];
+            build_header(reply, artpoll_reply_count);
+            reply->net_switch = pa >> 8;
+            reply->sub_switch = (pa >> 4) & 0x0f;
+            ports = 0;
+        }
+#if CONFIG_DMX_INPUT
+        if (output == 0)
+        {
+            // Turned around to send the DMX input to the network
+            reply->port_types[ports] = PORT_TYPE_DMX_IN;
+            reply->good_input[ports] = input_good ? GOOD_INPUT_DATA : 0;
+            reply->sw_in[ports] = pa & 0x0f;
+        }
+        else
+#endif
+        {
+            reply->port_types[ports] = PORT_TYPE_DMX_OUT;
+            reply->good_output[ports] = good_output(output, merge_active(output) == 0x03);
+            reply->sw_out[ports] = pa & 0x0f;
+        }
+        output_reply[output] = reply;
+        output_port[output] = ports;
+        artcodec_put_be16(reply->num_ports, ++ports);
+    }
+    atomic_store(&artpoll_changed, true);
+}
+
+void artpoll_init(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        output_port_address[output] = (CONFIG_ARTNET_UNIVERSE + output) & 0x7fff;
+    }
+    build_replies();
+    ESP_LOGI(TAG, "%d outputs in %d ArtPollReply packets", DMX_OUTPUT_COUNT, artpoll_reply_count);
+}
+
+void artpoll_set_ip(uint32_t ip)
+{
+    atomic_store(&pending_ip, ip);
+    atomic_store(&artpoll_pending, true);
+}
+
+// Writes in what other tasks set, from the network task, before the
+// replies are read
+static void apply_pending(void)
+{
+    if (!atomic_exchange(&artpoll_pending, false))
+    {
+        return;
+    }
+    uint32_t ip = atomic_load(&pending_ip);
+    if (ip != own_ip)
+    {
+        own_ip = ip;
+        for (size_t i = 0; i < artpoll_reply_count; i++)
+        {
+            memcpy(artpoll_reply[i].ip, &ip, 4);
+            memcpy(artpoll_reply[i].bind_ip, &ip, 4);
+        }
+        atomic_store(&artpoll_changed, true);
+    }
+#if CONFIG_DMX_INPUT
+    input_good = atomic_load(&pending_input_good);
+    uint8_t *status = &output_reply[0]->good_input[output_port[0]];
+    uint8_t next = input_good ? GOOD_INPUT_DATA : 0;
+    if (*status != next)
+    {
+        *status = next;
+        atomic_store(&artpoll_changed, true);
+    }
+#endif
+}
+
+void artpoll_set_port_address(uint8_t output, uint16_t port_address)
+{
+    if (output >= DMX_OUTPUT_COUNT || output_port_address[output] == port_address)
+    {
+        return;
+    }
+    output_port_address[output] = port_address & 0x7fff;
+    build_replies();
+}
+
+void artpoll_set_merging(uint8_t output, bool merging)
+{
+    uint8_t *status = &output_reply[output]->good_output[output_port[output]];
+    uint8_t next = good_output(output, merging);
+    if (*status != next)
+    {
+        *status = next;
+        atomic_store(&artpoll_changed, true);
+    }
+}
+
+void artpoll_set_input_good(bool receiving)
+{
+    atomic_store(&pending_input_good, receiving);
+    atomic_store(&artpoll_pending, true);
+}
+
+size_t artpoll_replies(const uint8_t **replies)
+{
+    apply_pending();
+    *replies = (const uint8_t *)artpoll_reply;
+    return artpoll_reply_count;
+}
+
+void artpoll_port(uint8_t output, uint8_t *bind_index, uint8_t *port)
+{
+    *bind_index = output_reply[output]->bind_index;
+    *port = output_port[output] + 1;
+}
+
+bool artpoll_targets(uint16_t bottom, uint16_t top)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        if (output_port_address[output] >= bottom && output_port_address[output] <= top)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool artpoll_take_changed(void)
+{
+    apply_pending();
+    return atomic_exchange(&artpoll_changed, false);
+}
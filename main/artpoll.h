@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dmxtask.h"
+
+// ArtPollReply packets, built once and patched in place when the node's
+// address, port configuration or status changes, so answering an ArtPoll
+// is only a sendto per packet. Each reply describes up to four outputs
+// sharing a net and subnet, told apart by BindIndex.
+//
+// The replies belong to the network task, which sends them. Only the
+// address and the input status are set from other tasks, those setters
+// just leave the value for artpoll_replies and artpoll_take_changed to
+// write in.
+
+#define ARTPOLL_REPLY_LEN 239
+#define ARTPOLL_REPLY_MAX DMX_OUTPUT_COUNT
+
+void artpoll_init(void);
+
+// Own IPv4 address, network byte order. From any task.
+void artpoll_set_ip(uint32_t ip);
+
+// Port-Address an output is reported as listening to
+void artpoll_set_port_address(uint8_t output, uint16_t port_address);
+
+void artpoll_set_merging(uint8_t output, bool merging);
+
+// Whether the input port, output 0 with CONFIG_DMX_INPUT, currently
+// receives DMX. From any task.
+void artpoll_set_input_good(bool receiving);
+
+// Returns the number of replies, *replies points at the first, the rest
+// follow at ARTPOLL_REPLY_LEN strides
+size_t artpoll_replies(const uint8_t **replies);
+
+// BindIndex of the reply describing an output and its port there, 1-4
+void artpoll_port(uint8_t output, uint8_t *bind_index, uint8_t *port);
+
+// Whether any output listens to a Port-Address in [bottom, top], for
+// targeted mode polls
+bool artpoll_targets(uint16_t bottom, uint16_t top);
+
+// True once after the replies changed, for controllers that asked to be
+// told about changes
+bool artpoll_take_changed(void);
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_vfs_dev.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "hal/cpu_hal.h"
+#include "sdkconfig.h"
+
+#include "artnet.h"
+#include "clitask.h"
+#include "control.h"
+#if CONFIG_DMX_INPUT
+#include "dmxintask.h"
+#endif
+#include "dmxtask.h"
+#include "latency.h"
+#if !CONFIG_DMX_INPUT
+#include "looktask.h"
+#endif
+#include "playout.h"
+#include "rxbatch.h"
+#if CONFIG_SHOW_ENABLE
+#include "showtask.h"
+#endif
+#include "trace.h"
+
+static const char *TAG = "CLI";
+
+typedef struct {
+    const char *name;
+    const char *help;
+    void (*run)(void);
+} cli_command_t;
+
+static void cli_help(void);
+
+static void cli_stats(void)
+{
+    rxbatch_stats_t rx;
+    artnet_seq_stats_t seq;
+    rxbatch_get_stats(&rx);
+    artnet_get_seq_stats(&seq);
+    printf("rx: %u datagrams, %u batches, largest %u, %u coalesced\n",
+            (unsigned)rx.datagrams, (unsigned)rx.batches,
+            (unsigned)rx.largest_batch, (unsigned)rx.coalesced);
+    printf("artdmx sequence: %u lost, %u reordered, %u duplicates\n",
+            (unsigned)seq.lost, (unsigned)seq.reordered, (unsigned)seq.duplicates);
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        if (!playout_enabled(output))
+        {
+            continue;
+        }
+        playout_stats_t play;
+        playout_get_stats(output, &play);
+        printf("playout %u: %u frames, %u late, %u overflows, %u resyncs, depth %u max %u, interval %u us\n",
+                output, (unsigned)play.frames, (unsigned)play.late, (unsigned)play.overflows,
+                (unsigned)play.resyncs, (unsigned)play.depth, (unsigned)play.max_depth,
+                (unsigned)play.interval_us);
+    }
+#if CONFIG_DMX_INPUT
+    dmx_rx_stats_t in_rx;
+    dmxin_stats_t in_tx;
+    dmx_input_get_stats(&in_rx);
+    dmx_input_get_send_stats(&in_tx);
+    printf("dmx input: %u frames, %u alternate start codes, %u runts, %u overruns\n",
+            (unsigned)in_rx.frames, (unsigned)in_rx.alternate, (unsigned)in_rx.runts,
+            (unsigned)in_rx.errors);
+    printf("dmx input sent: %u changed, %u keepalives, %u suppressed, %u losses\n",
+            (unsigned)in_tx.changed, (unsigned)in_tx.keepalives, (unsigned)in_tx.suppressed,
+            (unsigned)in_tx.losses);
+#endif
+}
+
+#if !CONFIG_DMX_INPUT
+// Counts over a second: slots on the wire and the share of the CPU the
+// port's interrupts took
+static void cli_ports(void)
+{
+    dmx_port_stats_t before[DMX_PORT_COUNT], after[DMX_PORT_COUNT];
+    for (uint8_t port = 0; port < DMX_PORT_COUNT; port++)
+    {
+        dmx_get_port_stats(port, &before[port]);
+    }
+    uint32_t start_us = latency_now_us();
+    uint32_t start_cycles = cpu_hal_get_cycle_count();
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    uint32_t window_cycles = cpu_hal_get_cycle_count() - start_cycles;
+    uint32_t window_us = latency_now_us() - start_us;
+
+    double total = 0;
+    for (uint8_t port = 0; port < DMX_PORT_COUNT; port++)
+    {
+        dmx_get_port_stats(port, &after[port]);
+        double slots = (after[port].slots - before[port].slots) * 1e6 / window_us;
+        double frames = (after[port].frames - before[port].frames) * 1e6 / window_us;
+        uint32_t cycles = after[port].cycles - before[port].cycles;
+        printf("port %u: %.1f frames/s, %.0f slots/s, CPU %.2f%%, %u cycles a frame\n",
+                port, frames, slots, cycles * 100.0 / window_cycles,
+                (unsigned)(after[port].frames != before[port].frames ?
+                    cycles / (after[port].frames - before[port].frames) : 0));
+        total += slots;
+    }
+    printf("all ports: %.0f slots/s\n", total);
+}
+
+static void cli_look(void)
+{
+    look_stats_t look;
+    look_get_stats(&look);
+    printf("look: %u outputs restored, %u saves, %u failed\n",
+            (unsigned)look.restored, (unsigned)look.saves, (unsigned)look.failures);
+    printf("boot: look on the wire at %u ms, network up at %u ms, live at %u ms\n",
+            (unsigned)latency_boot_us(LATENCY_BOOT_FIRST_LOOK) / 1000,
+            (unsigned)latency_boot_us(LATENCY_BOOT_NETWORK_UP) / 1000,
+            (unsigned)latency_boot_us(LATENCY_BOOT_FIRST_LIVE) / 1000);
+}
+
+static void cli_preset(void)
+{
+    printf(look_save_preset() ? "preset stored\n" : "preset not stored\n");
+}
+#endif
+
+#if CONFIG_SHOW_ENABLE
+static void cli_record(void)
+{
+    show_request(SHOW_CMD_RECORD);
+}
+
+static void cli_play(void)
+{
+    show_request(SHOW_CMD_PLAY);
+}
+
+static void cli_stop(void)
+{
+    show_request(SHOW_CMD_STOP);
+}
+#endif
+
+static const cli_command_t cli_commands[] = {
+    { "help", "list commands", cli_help },
+    { "trace", "dump the event trace for host/tools/trace_decode", trace_dump },
+    { "latency", "network to wire latency and frame jitter", latency_log_summary },
+    { "stats", "receive counters", cli_stats },
+#if !CONFIG_DMX_INPUT
+    { "ports", "slots per second and CPU time of each DMX port", cli_ports },
+    { "look", "power on look and time to light", cli_look },
+    { "preset", "store the current look as the power on preset", cli_preset },
+#endif
+#if CONFIG_SHOW_ENABLE
+    { "record", "record incoming universes to flash", cli_record },
+    { "play", "loop the recorded show", cli_play },
+    { "stop", "stop recording or playback", cli_stop },
+#endif
+};
+
+static void cli_help(void)
+{
+    for (size_t i = 0; i < sizeof(cli_commands) / sizeof(cli_commands[0]); i++)
+    {
+        printf("%-10s %s\n", cli_commands[i].name, cli_commands[i].help);
+    }
+    control_help();
+}
+
+static void cli_run(const char *line)
+{
+    for (size_t i = 0; i < sizeof(cli_commands) / sizeof(cli_commands[0]); i++)
+    {
+        if (strcmp(line, cli_commands[i].name) == 0)
+        {
+            cli_commands[i].run();
+            return;
+        }
+    }
+    if (control_run(line) == CONTROL_UNKNOWN)
+    {
+        printf("unknown command '%s', try help\n", line);
+    }
+}
+
+static void cli_worker(void *pvParameters)
+{
+    char line[64];
+
+    // Blocking reads through the UART driver instead of polling the FIFO
+    setvbuf(stdin, NULL, _IONBF, 0);
+    ESP_ERROR_CHECK(uart_driver_install(CONFIG_ESP_CONSOLE_UART_NUM, 256, 0, 0, NULL, 0));
+    esp_vfs_dev_uart_use_driver(CONFIG_ESP_CONSOLE_UART_NUM);
+
+    ESP_LOGI(TAG, "Console ready, try help");
+    while (1)
+    {
+        if (fgets(line, sizeof(line), stdin) == NULL)
+        {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0')
+        {
+            cli_run(line);
+        }
+    }
+}
+
+#define STACK_SIZE 4000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+
+void cli_task_start(void)
+{
+    xTaskCreateStatic(
+            cli_worker,
+            "cli",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY,
+            xStack,
+            &xTaskBuffer
+            );
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Line based commands on the serial console, see "help"
+void cli_task_start(void);
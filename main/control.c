@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "control.h"
+#include "dmxtask.h"
+#include "fade.h"
+#include "merge.h"
+#include "patch.h"
+#include "playout.h"
+
+#define CONTROL_MAX_ARGS 6
+
+typedef struct {
+    const char *name;
+    const char *usage;
+    int min_args;
+    int max_args;
+    control_result_t (*run)(char **args, int count);
+} control_command_t;
+
+// Whole number in [min, max], false on anything else
+static bool parse_number(const char *arg, long min, long max, long *value)
+{
+    char *end;
+    *value = strtol(arg, &end, 10);
+    return end != arg && *end == '\0' && *value >= min && *value <= max;
+}
+
+static bool parse_output(const char *arg, uint8_t *output)
+{
+    long value;
+    if (!parse_number(arg, 0, DMX_OUTPUT_COUNT - 1, &value))
+    {
+        printf("no output %s, outputs are 0-%d\n", arg, DMX_OUTPUT_COUNT - 1);
+        return false;
+    }
+    *output = value;
+    return true;
+}
+
+static control_result_t control_patch(char **args, int count)
+{
+    uint8_t output;
+    long slot, channel, slots, curve = PATCH_CURVE_LINEAR;
+    if (!parse_output(args[0], &output))
+    {
+        return CONTROL_FAILED;
+    }
+    if (!parse_number(args[1], 1, 512, &slot) || !parse_number(args[2], 1, 512, &channel) ||
+            !parse_number(args[3], 1, 512, &slots) ||
+            (count > 4 && !parse_number(args[4], 0, PATCH_CURVES - 1, &curve)))
+    {
+        printf("slot, channel and count are 1-512, curve 0-%d\n", PATCH_CURVES - 1);
+        return CONTROL_FAILED;
+    }
+    if (!patch_map(output, slot, channel, slots, curve))
+    {
+        printf("patch runs past slot 512\n");
+        return CONTROL_FAILED;
+    }
+    return CONTROL_OK;
+}
+
+static control_result_t control_unpatch(char **args, int count)
+{
+    uint8_t output;
+    long slot, slots;
+    if (!parse_output(args[0], &output))
+    {
+        return CONTROL_FAILED;
+    }
+    if (count == 1)
+    {
+        patch_reset(output);
+        return CONTROL_OK;
+    }
+    if (count != 3 || !parse_number(args[1], 1, 512, &slot) ||
+            !parse_number(args[2], 1, 513 - slot, &slots))
+    {
+        printf("slots run from 1 to 512\n");
+        return CONTROL_FAILED;
+    }
+    patch_unmap(output, slot, slots);
+    return CONTROL_OK;
+}
+
+static control_result_t control_curve(char **args, int count)
+{
+    long curve, level;
+    if (!parse_number(args[0], PATCH_CURVE_USER, PATCH_CURVES - 1, &curve) ||
+            !parse_number(args[1], 0, 255, &level))
+    {
+        printf("user curves are %d-%d, levels 0-255\n", PATCH_CURVE_USER, PATCH_CURVES - 1);
+        return CONTROL_FAILED;
+    }
+    uint8_t lut[256];
+    patch_curve_limit(lut, level);
+    patch_set_curve(curve, lut);
+    return CONTROL_OK;
+}
+
+static control_result_t control_merge(char **args, int count)
+{
+    uint8_t output;
+    if (!parse_output(args[0], &output))
+    {
+        return CONTROL_FAILED;
+    }
+    if (strcmp(args[1], "htp") == 0)
+    {
+        merge_set_mode(output, MERGE_HTP);
+    }
+    else if (strcmp(args[1], "ltp") == 0)
+    {
+        merge_set_mode(output, MERGE_LTP);
+    }
+    else
+    {
+        printf("merge modes are htp and ltp\n");
+        return CONTROL_FAILED;
+    }
+    return CONTROL_OK;
+}
+
+static control_result_t control_fade(char **args, int count)
+{
+    uint8_t output;
+    long ms;
+    if (!parse_output(args[0], &output))
+    {
+        return CONTROL_FAILED;
+    }
+    if (strcmp(args[1], "off") == 0)
+    {
+        fade_set(output, false, 0);
+    }
+    else if (strcmp(args[1], "auto") == 0)
+    {
+        fade_set(output, true, 0);
+    }
+    else if (parse_number(args[1], 1, 60000, &ms))
+    {
+        fade_set(output, true, ms);
+    }
+    else
+    {
+        printf("fade is off, auto or 1-60000 ms\n");
+        return CONTROL_FAILED;
+    }
+    return CONTROL_OK;
+}
+
+#if CONFIG_DMX_PLAYOUT
+static control_result_t control_playout(char **args, int count)
+{
+    uint8_t output;
+    long ms;
+    if (!parse_output(args[0], &output))
+    {
+        return CONTROL_FAILED;
+    }
+    if (!parse_number(args[1], 0, 1000, &ms))
+    {
+        printf("playout delay is 0-1000 ms\n");
+        return CONTROL_FAILED;
+    }
+    playout_set_delay(output, ms);
+    return CONTROL_OK;
+}
+#endif
+
+static const control_command_t control_commands[] = {
+    { "patch", "<output> <slot> <channel> <count> [curve]", 4, 5, control_patch },
+    { "unpatch", "<output> [<slot> <count>]", 1, 3, control_unpatch },
+    { "curve", "<3-7> <level>", 2, 2, control_curve },
+    { "merge", "<output> htp|ltp", 2, 2, control_merge },
+    { "fade", "<output> off|auto|<ms>", 2, 2, control_fade },
+#if CONFIG_DMX_PLAYOUT
+    { "playout", "<output> <ms>", 2, 2, control_playout },
+#endif
+};
+
+control_result_t control_run(const char *line)
+{
+    char copy[64];
+    char *args[CONTROL_MAX_ARGS];
+    int count = 0;
+    char *save;
+
+    strncpy(copy, line, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+    char *name = strtok_r(copy, " ", &save);
+    if (name == NULL)
+    {
+        return CONTROL_UNKNOWN;
+    }
+    for (char *arg; count < CONTROL_MAX_ARGS && (arg = strtok_r(NULL, " ", &save)) != NULL;)
+    {
+        args[count++] = arg;
+    }
+
+    for (size_t i = 0; i < sizeof(control_commands) / sizeof(control_commands[0]); i++)
+    {
+        const control_command_t *command = &control_commands[i];
+        if (strcmp(name, command->name) != 0)
+        {
+            continue;
+        }
+        if (count < command->min_args || count > command->max_args)
+        {
+            printf("usage: %s %s\n", command->name, command->usage);
+            return CONTROL_FAILED;
+        }
+        return command->run(args, count);
+    }
+    return CONTROL_UNKNOWN;
+}
+
+void control_help(void)
+{
+    for (size_t i = 0; i < sizeof(control_commands) / sizeof(control_commands[0]); i++)
+    {
+        printf("%-10s %s\n", control_commands[i].name, control_commands[i].usage);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Console commands that change how the outputs are patched, merged and
+// faded, and how much of a jitter buffer they keep.
+// Outputs are numbered from 0, slots and channels from 1.
+//
+//   patch <output> <slot> <channel> <count> [curve]
+//                      slots from slot show channels from channel, through
+//                      curve (0 linear, 1 gamma, 2 square, 3-7 user)
+//   unpatch <output> [<slot> <count>]
+//                      slots carry nothing, or without a range the output
+//                      goes back to the default patch
+//   curve <3-7> <level>
+//                      user curve, linear topping out at level
+//   merge <output> htp|ltp
+//   fade <output> off|auto|<ms>
+//                      fade to each new frame, over the received frame
+//                      interval or a fixed time
+//   playout <output> <ms>
+//                      jitter buffer delay, 0 turns it off (with
+//                      CONFIG_DMX_PLAYOUT)
+//
+// A patch change shows from the next frame each source commits.
+//
+// Only parsing here, the work is done by patch.h, merge.h, fade.h and playout.h, so the host
+// tests run the same commands as the console.
+
+typedef enum {
+    CONTROL_UNKNOWN,    // not a control command
+    CONTROL_OK,
+    CONTROL_FAILED,     // malformed or refused, the reason is printed
+} control_result_t;
+
+control_result_t control_run(const char *line);
+
+// Prints a line per command for the console help
+void control_help(void);
@@ -0,0 +1,98 @@
+#include "dmxframe.h"
+
+void dmx_frame_init(dmx_frame_engine_t *engine, const dmx_frame_hal_t *hal,
+        void *ctx, const dmx_frame_timing_t *timing)
+{
+    engine->hal = hal;
+    engine->ctx = ctx;
+    engine->timing = *timing;
+    engine->state = DMX_FRAME_STOPPED;
+    engine->frame_start_us = 0;
+    engine->frame = NULL;
+    engine->frame_len = 0;
+    engine->sent = 0;
+    engine->frames = 0;
+}
+
+static void begin_break(dmx_frame_engine_t *engine, uint64_t now_us)
+{
+    // Latch at the break so the newest complete frame goes out
+    engine->frame = engine->hal->next_frame(engine->ctx, &engine->frame_len);
+    engine->sent = 0;
+    engine->frame_start_us = now_us;
+    engine->state = DMX_FRAME_BREAK;
+    engine->hal->set_break(engine->ctx, true);
+    engine->hal->arm_timer(engine->ctx, now_us + engine->timing.break_us);
+}
+
+static void fill_fifo(dmx_frame_engine_t *engine)
+{
+    engine->sent += engine->hal->fifo_write(engine->ctx,
+            &engine->frame[engine->sent], engine->frame_len - engine->sent);
+    // Once everything is queued only the end of the last stop bit matters
+    engine->hal->enable_tx_events(engine->ctx,
+            engine->sent < engine->frame_len, true);
+}
+
+void dmx_frame_start(dmx_frame_engine_t *engine, uint64_t now_us)
+{
+    begin_break(engine, now_us);
+}
+
+void dmx_frame_on_timer(dmx_frame_engine_t *engine, uint64_t now_us)
+{
+    switch (engine->state)
+    {
+        case DMX_FRAME_BREAK:
+            engine->hal->set_break(engine->ctx, false);
+            engine->state = DMX_FRAME_MAB;
+            engine->hal->arm_timer(engine->ctx, now_us + engine->timing.mab_us);
+            break;
+
+        case DMX_FRAME_MAB:
+            engine->state = DMX_FRAME_DATA;
+            fill_fifo(engine);
+            break;
+
+        case DMX_FRAME_MARK:
+            begin_break(engine, now_us);
+            break;
+
+        default:
+            // Stale alarm, nothing is waiting for it
+            break;
+    }
+}
+
+void dmx_frame_on_fifo_empty(dmx_frame_engine_t *engine, uint64_t now_us)
+{
+    if (engine->state == DMX_FRAME_DATA && engine->sent < engine->frame_len)
+    {
+        fill_fifo(engine);
+    }
+}
+
+void dmx_frame_on_tx_done(dmx_frame_engine_t *engine, uint64_t now_us)
+{
+    if (engine->state != DMX_FRAME_DATA || engine->sent < engine->frame_len)
+    {
+        // FIFO ran dry before the frame was queued, keep refilling
+        dmx_frame_on_fifo_empty(engine, now_us);
+        return;
+    }
+
+    engine->hal->enable_tx_events(engine->ctx, false, false);
+    engine->frames++;
+
+    uint64_t next_break_us = engine->frame_start_us + engine->timing.period_us;
+    if (next_break_us <= now_us)
+    {
+        // Frame took longer than the period, no mark before break needed
+        begin_break(engine, now_us);
+    }
+    else
+    {
+        engine->state = DMX_FRAME_MARK;
+        engine->hal->arm_timer(engine->ctx, next_break_us);
+    }
+}
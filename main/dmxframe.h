@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hardware independent DMX512 frame generator. It is a state machine driven
+// by two events, a one-shot timer expiring and the UART reporting that its
+// TX FIFO needs refilling or has gone idle, and it never waits itself. On the
+// device the events come from a timer group alarm and the UART interrupt, on
+// the host from a simulated clock.
+//
+//   BREAK --timer--> MAB --timer--> DATA --fifo empty--> DATA ...
+//     ^                                    --tx done---> MARK
+//     +-----------------timer-------------------------------+
+
+typedef enum {
+    DMX_FRAME_STOPPED,
+    DMX_FRAME_BREAK,        // line held low
+    DMX_FRAME_MAB,          // mark after break
+    DMX_FRAME_DATA,         // start code and slots going out through the FIFO
+    DMX_FRAME_MARK,         // idle until the next break is due
+} dmx_frame_state_t;
+
+typedef struct {
+    uint32_t break_us;
+    uint32_t mab_us;
+    uint32_t period_us;     // break to break, frames never start sooner
+} dmx_frame_timing_t;
+
+// Calls the engine makes into the hardware, all may run in interrupt context
+typedef struct {
+    void (*set_break)(void *ctx, bool on);
+    // Queues as much of data as fits in the TX FIFO, returns the byte count
+    size_t (*fifo_write)(void *ctx, const uint8_t *data, size_t len);
+    // Selects which of the FIFO refill and TX done interrupts are wanted
+    void (*enable_tx_events)(void *ctx, bool refill, bool done);
+    // One-shot timer at an absolute time in microseconds
+    void (*arm_timer)(void *ctx, uint64_t deadline_us);
+    // Newest frame to transmit, start code included
+    const uint8_t *(*next_frame)(void *ctx, size_t *len);
+} dmx_frame_hal_t;
+
+typedef struct {
+    const dmx_frame_hal_t *hal;
+    void *ctx;
+    dmx_frame_timing_t timing;
+    dmx_frame_state_t state;
+    uint64_t frame_start_us;
+    const uint8_t *frame;
+    size_t frame_len;
+    size_t sent;
+    uint32_t frames;
+} dmx_frame_engine_t;
+
+void dmx_frame_init(dmx_frame_engine_t *engine, const dmx_frame_hal_t *hal,
+        void *ctx, const dmx_frame_timing_t *timing);
+
+// Starts the first break at now_us
+void dmx_frame_start(dmx_frame_engine_t *engine, uint64_t now_us);
+
+// Event entry points, to be called from the timer and UART interrupts
+void dmx_frame_on_timer(dmx_frame_engine_t *engine, uint64_t now_us);
+void dmx_frame_on_fifo_empty(dmx_frame_engine_t *engine, uint64_t now_us);
+void dmx_frame_on_tx_done(dmx_frame_engine_t *engine, uint64_t now_us);
+
+// Break to break time for a refresh rate
+static inline uint32_t dmx_frame_period_us(uint32_t refresh_hz)
+{
+    return 1000000 / refresh_hz;
+}
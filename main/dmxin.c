@@ -0,0 +1,75 @@
+#include <string.h>
+
+#include "dmxin.h"
+
+void dmxin_init(dmxin_t *in, uint16_t port_address, uint32_t keepalive_us)
+{
+    memset(in, 0, sizeof(*in));
+    in->keepalive_us = keepalive_us;
+    in->port_address = port_address;
+}
+
+static size_t emit(dmxin_t *in, uint32_t now_us)
+{
+    // Sequence runs 1-255, 0 would turn reordering checks off
+    in->sequence = in->sequence == 255 ? 1 : in->sequence + 1;
+    in->sent_us = now_us;
+    return artcodec_encode_dmx(in->packet, in->sequence, 0, in->port_address, in->count);
+}
+
+size_t dmxin_frame(dmxin_t *in, const uint8_t *frame, size_t len, uint32_t now_us)
+{
+    in->stats.frames++;
+    in->frame_us = now_us;
+    in->live = true;
+
+    const uint8_t *slots = &frame[1];
+    size_t count = len - 1;
+    uint8_t *data = &in->packet[DMXIN_HEADER_LEN];
+    if (count != in->count || memcmp(data, slots, count) != 0)
+    {
+        memcpy(data, slots, count);
+        in->count = count;
+        in->stats.changed++;
+        return emit(in, now_us);
+    }
+    if (now_us - in->sent_us >= in->keepalive_us)
+    {
+        in->stats.keepalives++;
+        return emit(in, now_us);
+    }
+    in->stats.suppressed++;
+    return 0;
+}
+
+size_t dmxin_poll(dmxin_t *in, uint32_t now_us)
+{
+    if (!in->live)
+    {
+        return 0;
+    }
+    if (now_us - in->frame_us >= DMXIN_LOSS_US)
+    {
+        in->live = false;
+        in->stats.losses++;
+        return 0;
+    }
+    if (now_us - in->sent_us >= in->keepalive_us)
+    {
+        in->stats.keepalives++;
+        return emit(in, now_us);
+    }
+    return 0;
+}
+
+uint32_t dmxin_next_due(const dmxin_t *in, uint32_t now_us)
+{
+    if (!in->live)
+    {
+        return UINT32_MAX;
+    }
+    int32_t keepalive = (int32_t)(in->sent_us + in->keepalive_us - now_us);
+    int32_t loss = (int32_t)(in->frame_us + DMXIN_LOSS_US - now_us);
+    int32_t due = keepalive < loss ? keepalive : loss;
+    return due < 0 ? 0 : due;
+}
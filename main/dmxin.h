@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "artcodec.h"
+
+// Turns frames received on the DMX input into ArtDmx packets. A desk
+// repeats its frame 44 times a second whether anything moved or not, so
+// only frames whose slots differ from the last one sent go out, plus a
+// keepalive repeating it while nothing changes, as Art-Net requires of
+// nodes that send on change only. When the line goes quiet sending stops,
+// so receivers see the input drop out instead of a frozen look.
+//
+// No I/O here: the caller owns the socket and the clock (latency_now_us()).
+
+#define DMXIN_HEADER_LEN ARTCODEC_DMX_HEADER_LEN
+#define DMXIN_PACKET_MAX (DMXIN_HEADER_LEN + ARTCODEC_DMX_MAX)
+
+// No frame from the line for this long is input loss, as for DMX receivers
+#define DMXIN_LOSS_US 1250000
+
+typedef struct {
+    uint32_t frames;        // received from the line
+    uint32_t changed;       // sent because slots changed
+    uint32_t keepalives;    // sent unchanged
+    uint32_t suppressed;    // unchanged and not sent
+    uint32_t losses;        // input went quiet
+} dmxin_stats_t;
+
+typedef struct {
+    uint8_t packet[DMXIN_PACKET_MAX];   // last ArtDmx sent
+    size_t count;           // slots in it, 0 before the first frame
+    uint16_t port_address;
+    uint8_t sequence;
+    uint32_t keepalive_us;
+    uint32_t sent_us;
+    uint32_t frame_us;
+    bool live;
+    dmxin_stats_t stats;
+} dmxin_t;
+
+void dmxin_init(dmxin_t *in, uint16_t port_address, uint32_t keepalive_us);
+
+// A frame received at now_us, start code included. Returns the length of
+// the ArtDmx to send from in->packet, 0 when nothing is due.
+size_t dmxin_frame(dmxin_t *in, const uint8_t *frame, size_t len, uint32_t now_us);
+
+// Called when no frame came in, returns the length of a due keepalive
+size_t dmxin_poll(dmxin_t *in, uint32_t now_us);
+
+// Microseconds until dmxin_poll has something to do, UINT32_MAX while the
+// input is down
+uint32_t dmxin_next_due(const dmxin_t *in, uint32_t now_us);
+
+// Whether frames are coming in
+static inline bool dmxin_live(const dmxin_t *in)
+{
+    return in->live;
+}
@@ -0,0 +1,103 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "artcodec.h"
+#include "artpoll.h"
+#include "dmxintask.h"
+#include "dmxtask.h"
+#include "latency.h"
+#include "wifitask.h"
+
+// Built either way, the input options only exist with CONFIG_DMX_INPUT
+#if CONFIG_DMX_INPUT
+
+static const char *TAG = "DMX input";
+
+static dmxin_t dmxin;
+
+static void dmx_input_worker(void *pvParameters)
+{
+    // Started at boot like the other network tasks, nothing is sent
+    // before the network is up
+    wifi_wait_connected();
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+    int broadcast = 1;
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast));
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(ARTNET_PORT),
+        .sin_addr.s_addr = inet_addr(CONFIG_DMX_INPUT_TARGET),
+    };
+
+    dmxin_init(&dmxin, CONFIG_ARTNET_UNIVERSE & 0x7fff, CONFIG_DMX_INPUT_KEEPALIVE_MS * 1000);
+    dmx_input_attach();
+    ESP_LOGI(TAG, "Sending to %s, Port-Address %d", CONFIG_DMX_INPUT_TARGET, CONFIG_ARTNET_UNIVERSE);
+
+    bool live = false;
+    while (1)
+    {
+        // Sleep until a frame comes in or the keepalive is due
+        uint32_t wait_us = dmxin_next_due(&dmxin, latency_now_us());
+        TickType_t wait = wait_us == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait_us / 1000) + 1;
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        size_t len;
+        uint32_t break_us;
+        const uint8_t *frame = dmx_input_take(&len, &break_us);
+        size_t packet_len = frame != NULL ?
+            dmxin_frame(&dmxin, frame, len, latency_now_us()) :
+            dmxin_poll(&dmxin, latency_now_us());
+        if (packet_len != 0 && sendto(sock, dmxin.packet, packet_len, 0,
+                    (struct sockaddr *)&dest, sizeof(dest)) < 0)
+        {
+            ESP_LOGW(TAG, "ArtDmx not sent: errno %d", errno);
+        }
+
+        if (dmxin_live(&dmxin) != live)
+        {
+            live = dmxin_live(&dmxin);
+            ESP_LOGI(TAG, "DMX input %s", live ? "receiving" : "lost");
+            artpoll_set_input_good(live);
+        }
+    }
+}
+
+void dmx_input_get_send_stats(dmxin_stats_t *stats)
+{
+    *stats = dmxin.stats;
+}
+
+#define STACK_SIZE 3000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+
+void dmx_input_task_start(void)
+{
+    xTaskCreateStatic(
+            dmx_input_worker,
+            "dmxin",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY + 1,
+            xStack,
+            &xTaskBuffer
+            );
+}
+#endif
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "dmxin.h"
+
+// With CONFIG_DMX_INPUT, sends the frames received on the DMX input to
+// CONFIG_DMX_INPUT_TARGET as ArtDmx on output 0's Port-Address, on change
+// and as a keepalive (see dmxin.h). Has its own socket and task, woken by
+// the UART interrupt for every frame.
+void dmx_input_task_start(void);
+
+void dmx_input_get_send_stats(dmxin_stats_t *stats);
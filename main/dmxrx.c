@@ -0,0 +1,84 @@
+#include <string.h>
+
+#include "dmxrx.h"
+
+void dmx_rx_init(dmx_rx_t *rx)
+{
+    memset(rx, 0, sizeof(*rx));
+    tribuf_init(&rx->tribuf);
+}
+
+// Bytes are written straight into the back buffer, publishing hands it over
+static bool publish(dmx_rx_t *rx)
+{
+    rx->lens[rx->tribuf.back] = rx->received;
+    rx->in_frame = false;
+    rx->received = 0;
+    rx->stats.frames++;
+    tribuf_publish(&rx->tribuf);
+    return true;
+}
+
+bool dmx_rx_on_break(dmx_rx_t *rx, uint32_t now_us)
+{
+    bool published = false;
+    if (rx->in_frame)
+    {
+        if (rx->received > 1)
+        {
+            published = publish(rx);
+        }
+        else
+        {
+            rx->stats.runts++;
+        }
+    }
+    rx->in_frame = true;
+    rx->received = 0;
+    rx->break_us[rx->tribuf.back] = now_us;
+    return published;
+}
+
+bool dmx_rx_on_data(dmx_rx_t *rx, const uint8_t *data, size_t len)
+{
+    if (!rx->in_frame || len == 0)
+    {
+        return false;
+    }
+    if (rx->received == 0 && data[0] != 0x00)
+    {
+        // Text packets, RDM and the like, nothing for the network
+        rx->stats.alternate++;
+        rx->in_frame = false;
+        return false;
+    }
+    size_t space = DMX_RX_FRAME_MAX - rx->received;
+    if (len > space)
+    {
+        len = space;
+    }
+    memcpy(&rx->frames[rx->tribuf.back][rx->received], data, len);
+    rx->received += len;
+    return rx->received == DMX_RX_FRAME_MAX ? publish(rx) : false;
+}
+
+void dmx_rx_on_error(dmx_rx_t *rx)
+{
+    if (rx->in_frame)
+    {
+        rx->stats.errors++;
+    }
+    rx->in_frame = false;
+    rx->received = 0;
+}
+
+const uint8_t *dmx_rx_take(dmx_rx_t *rx, size_t *len, uint32_t *break_us)
+{
+    if (!tribuf_acquire(&rx->tribuf))
+    {
+        return NULL;
+    }
+    *len = rx->lens[rx->tribuf.front];
+    *break_us = rx->break_us[rx->tribuf.front];
+    return rx->frames[rx->tribuf.front];
+}
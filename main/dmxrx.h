@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tribuf.h"
+
+// Hardware independent DMX512 frame receiver, the input side counterpart of
+// dmxframe.h. The UART interrupt feeds it the bytes it drains from the RX
+// FIFO and tells it when a break was detected. A break ends the frame in
+// progress, which is published through a triple buffer if it was a valid
+// NULL start code frame, so the task reading it never waits for the
+// interrupt and always gets the newest complete frame.
+
+// Start code and 512 slots
+#define DMX_RX_FRAME_MAX 513
+
+typedef struct {
+    uint32_t frames;        // published
+    uint32_t alternate;     // non-zero start code frames ignored
+    uint32_t runts;         // breaks with no slots after the start code
+    uint32_t errors;        // frames dropped on a FIFO overrun
+} dmx_rx_stats_t;
+
+typedef struct {
+    uint8_t frames[3][DMX_RX_FRAME_MAX];
+    size_t lens[3];
+    uint32_t break_us[3];
+    tribuf_t tribuf;
+    size_t received;        // bytes of the frame in progress, start code included
+    bool in_frame;          // a break was seen and no error since
+    dmx_rx_stats_t stats;
+} dmx_rx_t;
+
+void dmx_rx_init(dmx_rx_t *rx);
+
+// Interrupt side. Each returns true when it published a frame.
+
+// A break started at now_us, ends the frame in progress
+bool dmx_rx_on_break(dmx_rx_t *rx, uint32_t now_us);
+
+// Bytes read from the FIFO since the last call, the break's own NUL byte
+// excluded. A full 513 byte frame is published without waiting for the
+// next break.
+bool dmx_rx_on_data(dmx_rx_t *rx, const uint8_t *data, size_t len);
+
+// RX FIFO overrun, the frame in progress is dropped and
+// nothing is captured until the next break
+void dmx_rx_on_error(dmx_rx_t *rx);
+
+// Task side: newest frame published since the last call, start code
+// included, or NULL. *break_us is when its break started. The frame stays
+// valid until the next call.
+const uint8_t *dmx_rx_take(dmx_rx_t *rx, size_t *len, uint32_t *break_us);
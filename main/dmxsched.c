@@ -0,0 +1,92 @@
+#include "dmxsched.h"
+
+void dmx_sched_init(dmx_sched_t *sched, void (*arm_timer)(void *ctx, uint64_t deadline_us),
+        void *ctx)
+{
+    sched->count = 0;
+    sched->started = 0;
+    sched->dispatching = false;
+    sched->armed_us = DMX_SCHED_IDLE;
+    sched->arm_timer = arm_timer;
+    sched->ctx = ctx;
+    for (int port = 0; port < DMX_SCHED_PORTS; port++)
+    {
+        sched->engines[port] = NULL;
+        sched->deadline_us[port] = DMX_SCHED_IDLE;
+    }
+}
+
+uint8_t dmx_sched_add(dmx_sched_t *sched, dmx_frame_engine_t *engine)
+{
+    sched->engines[sched->count] = engine;
+    return sched->count++;
+}
+
+// Arms the timer for the earliest deadline. Alarms for a deadline that has
+// since moved are harmless, the dispatch only runs engines that are due.
+static void rearm(dmx_sched_t *sched)
+{
+    uint64_t next = DMX_SCHED_IDLE;
+    for (uint8_t port = 0; port < sched->count; port++)
+    {
+        if (sched->deadline_us[port] < next)
+        {
+            next = sched->deadline_us[port];
+        }
+    }
+    if (next != sched->armed_us && next != DMX_SCHED_IDLE)
+    {
+        sched->arm_timer(sched->ctx, next);
+    }
+    sched->armed_us = next;
+}
+
+void dmx_sched_start(dmx_sched_t *sched, uint64_t now_us, uint32_t period_us)
+{
+    for (uint8_t port = 0; port < sched->count; port++)
+    {
+        sched->deadline_us[port] = now_us + (uint64_t)period_us * port / sched->count;
+    }
+    dmx_sched_on_timer(sched, now_us);
+}
+
+void dmx_sched_arm(dmx_sched_t *sched, uint8_t port, uint64_t deadline_us)
+{
+    sched->deadline_us[port] = deadline_us;
+    // From a UART event, the timer may be waiting for a later port
+    if (!sched->dispatching && deadline_us < sched->armed_us)
+    {
+        rearm(sched);
+    }
+}
+
+void dmx_sched_on_timer(dmx_sched_t *sched, uint64_t now_us)
+{
+    sched->dispatching = true;
+    bool ran;
+    do
+    {
+        ran = false;
+        for (uint8_t port = 0; port < sched->count; port++)
+        {
+            if (sched->deadline_us[port] > now_us)
+            {
+                continue;
+            }
+            sched->deadline_us[port] = DMX_SCHED_IDLE;
+            ran = true;
+            if (sched->started & 1 << port)
+            {
+                dmx_frame_on_timer(sched->engines[port], now_us);
+            }
+            else
+            {
+                sched->started |= 1 << port;
+                dmx_frame_start(sched->engines[port], now_us);
+            }
+        }
+    } while (ran);
+    sched->dispatching = false;
+    sched->armed_us = DMX_SCHED_IDLE;
+    rearm(sched);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dmxframe.h"
+
+// Runs the frame engines of several DMX ports off one one-shot timer. Each
+// engine's arm_timer lands here, the timer is armed for the earliest
+// deadline of all of them and its interrupt runs every engine that is due,
+// so the ports cost one timer and one interrupt handler between them. The
+// UART events still go straight to the port's engine.
+//
+// The ports start a fraction of the period apart, port n at n / count of
+// it, so their breaks and FIFO refills are spread over the frame instead
+// of all landing at once.
+//
+// Not locked: the caller runs all of it under the spinlock the UART
+// interrupts take.
+
+#define DMX_SCHED_PORTS 3
+#define DMX_SCHED_IDLE  UINT64_MAX
+
+typedef struct {
+    dmx_frame_engine_t *engines[DMX_SCHED_PORTS];
+    uint64_t deadline_us[DMX_SCHED_PORTS];  // DMX_SCHED_IDLE when none
+    uint8_t count;
+    uint8_t started;                        // bit per port past its first break
+    bool dispatching;
+    uint64_t armed_us;                      // the hardware timer's deadline
+    void (*arm_timer)(void *ctx, uint64_t deadline_us);
+    void *ctx;
+} dmx_sched_t;
+
+void dmx_sched_init(dmx_sched_t *sched, void (*arm_timer)(void *ctx, uint64_t deadline_us),
+        void *ctx);
+
+// Adds an engine, initialised but not started, and returns its port
+// number for dmx_sched_arm
+uint8_t dmx_sched_add(dmx_sched_t *sched, dmx_frame_engine_t *engine);
+
+// Staggers the first breaks over period_us from now_us
+void dmx_sched_start(dmx_sched_t *sched, uint64_t now_us, uint32_t period_us);
+
+// The arm_timer of the port's engine
+void dmx_sched_arm(dmx_sched_t *sched, uint8_t port, uint64_t deadline_us);
+
+// From the timer interrupt, runs the engines that are due and rearms
+void dmx_sched_on_timer(dmx_sched_t *sched, uint64_t now_us);
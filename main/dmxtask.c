@@ -1,15 +1,33 @@
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "esp_log.h"
 
 #include "driver/uart.h"
 #include "driver/gpio.h"
+#include "driver/timer.h"
+#include "hal/cpu_hal.h"
+#include "hal/uart_ll.h"
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include "freertos/semphr.h"
 
-static const char *TAG = "DMX task";
+#include "dmxframe.h"
+#include "dmxsched.h"
+#include "dmxtask.h"
+#include "fade.h"
+#include "latency.h"
+#if !CONFIG_DMX_INPUT
+#include "looktask.h"
+#endif
+#include "merge.h"
+#include "patch.h"
+#include "trace.h"
+#include "tribuf.h"
+
+static const char *TAG = "DMX";
 
 #define DMX_SERIAL_INPUT_PIN    GPIO_NUM_16 // pin for dmx rx
 #define DMX_SERIAL_OUTPUT_PIN   GPIO_NUM_17 // pin for dmx tx
@@ -17,14 +35,52 @@ static const char *TAG = "DMX task";
 
 #define DMX_UART_NUM            UART_NUM_2  // dmx uart
 
-#define DMX_DEBUG_PIN           GPIO_NUM_23
-
-#define BUF_SIZE                1024        //  buffer size for rx events
+// Second port, output only. UART0 stays with the console.
+#define DMX_PORT1_UART_NUM      UART_NUM_1
+#define DMX_PORT1_OUTPUT_PIN    GPIO_NUM_25
+#define DMX_PORT1_IO_PIN        GPIO_NUM_26
 
-#define DMX_UPDATE_SPEED (50)
+#define DMX_DEBUG_PIN           GPIO_NUM_23
 
-static void setup_uart(void)
+// Frame timing runs off a 1 MHz timer group counter
+#define DMX_TIMER_GROUP         TIMER_GROUP_0
+#define DMX_TIMER_IDX           TIMER_0
+#define DMX_TIMER_DIVIDER       80          // 80 MHz APB clock -> 1 us ticks
+
+// Breaks further than this off the period are traced
+#define DMX_LATE_FRAME_US       100
+
+// Refill the 128 byte TX FIFO when it drops below this, 16 slots is 704 us
+#define DMX_TXFIFO_EMPTY_THRESHOLD 16
+
+// Input mode drains the 128 byte RX FIFO once this many slots wait in it,
+// leaving 3 ms for the interrupt to be serviced before it overruns
+#define DMX_RXFIFO_FULL_THRESHOLD 60
+// and once the line idled for two slots, so a short frame's tail is not
+// held until the next break. In bit times.
+#define DMX_RX_TIMEOUT_BITS     22
+#define DMX_RX_INTERRUPTS       (UART_INTR_RXFIFO_FULL | UART_INTR_RXFIFO_TOUT | \
+                                 UART_INTR_BRK_DET | UART_INTR_RXFIFO_OVF)
+
+typedef struct {
+    uart_port_t uart;
+    gpio_num_t output_pin;
+    int input_pin;
+    gpio_num_t io_pin;
+} dmx_port_pins_t;
+
+#define DMX_PORTS_MAX 2
+_Static_assert(DMX_PORT_COUNT <= DMX_PORTS_MAX, "two spare UARTs");
+_Static_assert(DMX_PORT_COUNT <= DMX_OUTPUT_COUNT, "every port sends an output");
+
+static const dmx_port_pins_t dmx_port_pins[DMX_PORTS_MAX] = {
+    { DMX_UART_NUM, DMX_SERIAL_OUTPUT_PIN, DMX_SERIAL_INPUT_PIN, DMX_SERIAL_IO_PIN },
+    { DMX_PORT1_UART_NUM, DMX_PORT1_OUTPUT_PIN, UART_PIN_NO_CHANGE, DMX_PORT1_IO_PIN },
+};
+
+static void setup_uart(uint8_t port)
 {
+    const dmx_port_pins_t *pins = &dmx_port_pins[port];
     uart_config_t uart_config = {
         // from https://github.com/luksal/ESP32-DMX/blob/master/src/dmx.cpp
         .baud_rate = 250000,
@@ -34,159 +90,795 @@ static void setup_uart(void)
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
     };
     // Configure UART parameters
-    ESP_ERROR_CHECK(uart_param_config(DMX_UART_NUM, &uart_config));
-
-    // Setup UART buffered IO with event queue
-    const int uart_buffer_size = (1024 * 2);
-    QueueHandle_t uart_queue;
-    // Install UART driver using an event queue here
-    ESP_ERROR_CHECK(uart_driver_install(UART_NUM_2, uart_buffer_size, \
-                                            uart_buffer_size, 10, &uart_queue, 0));
+    ESP_ERROR_CHECK(uart_param_config(pins->uart, &uart_config));
 
     // Set pins for UART
-    uart_set_pin(DMX_UART_NUM, DMX_SERIAL_OUTPUT_PIN, DMX_SERIAL_INPUT_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-
-    // install queue
-    //uart_driver_install(DMX_UART_NUM, BUF_SIZE * 2, BUF_SIZE * 2, 20, &dmx_rx_queue, 0);
-    //uart_driver_install(DMX_UART_NUM, BUF_SIZE * 2, BUF_SIZE * 2, 20, NULL, 0);
-
-    // create mutex for syncronisation
-    //sync_dmx = xSemaphoreCreateMutex();
+    uart_set_pin(pins->uart, pins->output_pin, pins->input_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+
+    // No UART driver, the frame engine feeds the FIFO from its own interrupt
+    uart_dev_t *hw = UART_LL_GET_HW(pins->uart);
+    uart_ll_disable_intr_mask(hw, UART_LL_INTR_MASK);
+    uart_ll_clr_intsts_mask(hw, UART_LL_INTR_MASK);
+#if CONFIG_DMX_INPUT
+    uart_ll_set_rxfifo_full_thr(hw, DMX_RXFIFO_FULL_THRESHOLD);
+    uart_ll_set_rx_tout(hw, DMX_RX_TIMEOUT_BITS);
+#else
+    uart_ll_set_txfifo_empty_thr(hw, DMX_TXFIFO_EMPTY_THRESHOLD);
+#endif
 
     // set gpio for direction
-    gpio_pad_select_gpio(DMX_SERIAL_IO_PIN);
-    gpio_set_direction(DMX_SERIAL_IO_PIN, GPIO_MODE_OUTPUT);
+    gpio_pad_select_gpio(pins->io_pin);
+    gpio_set_direction(pins->io_pin, GPIO_MODE_OUTPUT);
 
-    gpio_set_level(DMX_SERIAL_IO_PIN, 1);
+#if CONFIG_DMX_INPUT
+    // Transceiver turned around to receive
+    gpio_set_level(pins->io_pin, 0);
+#else
+    gpio_set_level(pins->io_pin, 1);
+#endif
 
-    gpio_set_direction(DMX_DEBUG_PIN, GPIO_MODE_OUTPUT);
-    gpio_set_level(DMX_DEBUG_PIN, 0);
+    if (port == 0)
+    {
+        gpio_set_direction(DMX_DEBUG_PIN, GPIO_MODE_OUTPUT);
+        gpio_set_level(DMX_DEBUG_PIN, 0);
+    }
 }
 
-static uint8_t dmx_buffer[2][513] = { 0 }; // first byte has to always be 0,
+static void setup_timer(void)
+{
+    timer_config_t timer_config = {
+        .divider = DMX_TIMER_DIVIDER,
+        .counter_dir = TIMER_COUNT_UP,
+        .counter_en = TIMER_PAUSE,
+        .alarm_en = TIMER_ALARM_DIS,
+        .auto_reload = TIMER_AUTORELOAD_DIS,
+    };
+    ESP_ERROR_CHECK(timer_init(DMX_TIMER_GROUP, DMX_TIMER_IDX, &timer_config));
+    ESP_ERROR_CHECK(timer_set_counter_value(DMX_TIMER_GROUP, DMX_TIMER_IDX, 0));
+}
+
+// Every source of an output (see merge.h) has its own work buffer and
+// triple buffer. Writers fill dmx_work, a commit copies it into the back
+// buffer of the source's triple buffer and the output picks up the newest
+// complete frame of each source when it latches, merging them if two are
+// live. The semaphore only serialises writers, the output never takes it
+// and so never waits for the network tasks.
+static uint8_t dmx_work[DMX_OUTPUT_COUNT][MERGE_SOURCES][DMX_FRAME_STRIDE]
+    __attribute__((aligned(4))) = { 0 };
+static uint8_t dmx_buffer[DMX_OUTPUT_COUNT][MERGE_SOURCES][3][DMX_FRAME_STRIDE]
+    __attribute__((aligned(4))) = { 0 };
+                                           // first byte has to always be 0,
                                            // rest are the 512 channels 1-512
-static size_t dmx_transmit_size = 513;
-static size_t dmx_visible_layer = 0;
-static bool   dmx_swap_request = false;
+static tribuf_t dmx_tribuf[DMX_OUTPUT_COUNT][MERGE_SOURCES];
+
+// Output owned result of merging two sources
+static uint8_t dmx_merged[DMX_OUTPUT_COUNT][DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+
+// Frame length including the start code, per buffer so it always matches
+// the frame it describes. Fixed at 513 unless CONFIG_DMX_ADAPTIVE_LENGTH,
+// then it covers the highest channel ever written by the source.
+static size_t dmx_buffer_len[DMX_OUTPUT_COUNT][MERGE_SOURCES][3];
+static size_t dmx_work_len[DMX_OUTPUT_COUNT][MERGE_SOURCES];
+
+// A whole frame is written straight into the back buffer, see
+// dmx_output_write_frame. Then the work buffer is out of date and this is
+// the triple buffer slot holding the source's newest data, -1 otherwise.
+// Only the writer writes to a slot it published before, so it stays
+// readable until the work buffer is brought back up to date.
+static int8_t dmx_work_at[DMX_OUTPUT_COUNT][MERGE_SOURCES];
+
+// Latency timestamps (see latency.h) of the data in each buffer, rx_us is
+// 0 for data that did not come from the network
+typedef struct {
+    uint32_t rx_us;
+    uint32_t stage_us;      // ingested for work buffers, committed otherwise
+} dmx_stamp_t;
+
+static dmx_stamp_t dmx_work_stamp[DMX_OUTPUT_COUNT][MERGE_SOURCES];
+static dmx_stamp_t dmx_buffer_stamp[DMX_OUTPUT_COUNT][MERGE_SOURCES][3];
+// Active source mask at the last latch, a change makes the frame new
+static uint8_t dmx_latched_active[DMX_OUTPUT_COUNT];
+
+// Newest network data in the frame last latched, until it reaches the wire
+static dmx_stamp_t dmx_latched_stamp[DMX_OUTPUT_COUNT];
 
 static SemaphoreHandle_t dmx_update_semaphore = NULL;
 static StaticSemaphore_t dmx_update_mutex_buffer;
 
 static portMUX_TYPE dmx_transmit_spinlock = portMUX_INITIALIZER_UNLOCKED;
 
-static void dmx_worker(void *bogus_param)
+static size_t dmx_initial_len(void)
+{
+#if CONFIG_DMX_ADAPTIVE_LENGTH
+    return 1;
+#else
+    return 513;
+#endif
+}
+
+void dmx_buffer_init(void)
 {
-    setup_uart();
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        for (uint8_t source = 0; source < MERGE_SOURCES; source++)
+        {
+            tribuf_init(&dmx_tribuf[output][source]);
+            dmx_work_len[output][source] = dmx_initial_len();
+            dmx_work_at[output][source] = -1;
+            for (int i = 0; i < 3; i++)
+            {
+                dmx_buffer_len[output][source][i] = dmx_initial_len();
+            }
+        }
+    }
+    merge_init();
+    patch_init();
+    fade_init();
+
     dmx_update_semaphore = xSemaphoreCreateMutexStatic( &dmx_update_mutex_buffer );
 
     xSemaphoreGive(dmx_update_semaphore);
+}
+
+static const uint8_t *dmx_source_latch(uint8_t output, uint8_t source, size_t *len, bool *fresh)
+{
+    tribuf_t *tribuf = &dmx_tribuf[output][source];
+    if (tribuf_acquire(tribuf))
+    {
+        *fresh = true;
+        const dmx_stamp_t *stamp = &dmx_buffer_stamp[output][source][tribuf->front];
+        // Outputs the pixel task latches have no DMX line to time, and
+        // stay out of the DMX figures
+        if (stamp->rx_us != 0 && output < DMX_PORT_COUNT)
+        {
+            uint32_t now = latency_now_us();
+            latency_record(LATENCY_COMMIT_TO_LATCH, now - stamp->stage_us);
+            if (dmx_latched_stamp[output].rx_us == 0 ||
+                    (int32_t)(stamp->rx_us - dmx_latched_stamp[output].rx_us) > 0)
+            {
+                dmx_latched_stamp[output].rx_us = stamp->rx_us;
+                dmx_latched_stamp[output].stage_us = now;
+            }
+        }
+    }
+    *len = dmx_buffer_len[output][source][tribuf->front];
+    return dmx_buffer[output][source][tribuf->front];
+}
+
+// Newest frame of the output's sources, merged if there are two. *fresh
+// tells whether it differs from what the last latch returned.
+static const uint8_t *dmx_sources_latch(uint8_t output, size_t *len, bool *fresh)
+{
+    uint8_t active = merge_active(output);
+    *fresh = active != dmx_latched_active[output];
+    dmx_latched_active[output] = active;
+
+    if (active != 0x03)
+    {
+        // Zero or one source, its frame goes out as is
+        uint8_t *frame = (uint8_t *)dmx_source_latch(output, active == 0x02 ? 1 : 0, len, fresh);
+        frame[0] = 0x00;
+        return frame;
+    }
+
+    size_t len_a, len_b;
+    const uint8_t *a = dmx_source_latch(output, 0, &len_a, fresh);
+    const uint8_t *b = dmx_source_latch(output, 1, &len_b, fresh);
+    uint8_t *out = dmx_merged[output];
+    size_t common = len_a < len_b ? len_a : len_b;
+    *len = len_a > len_b ? len_a : len_b;
+
+    if (merge_get_mode(output) == MERGE_LTP)
+    {
+        // Frames are patched, so is their ownership
+        const uint8_t *owner = patch_active(output) ?
+            merge_ltp_slot_owner(output) : merge_ltp_owner(output);
+        merge_ltp(out, a, b, owner, common);
+    }
+    else
+    {
+        merge_htp(out, a, b, common);
+    }
+    // Slots only one source has sent so far
+    if (len_a != len_b)
+    {
+        const uint8_t *longer = len_a > len_b ? a : b;
+        memcpy(&out[common], &longer[common], *len - common);
+    }
+    out[0] = 0x00;
+    return out;
+}
+
+const uint8_t *dmx_buffer_latch(uint8_t output, size_t *len)
+{
+    assert(output < DMX_OUTPUT_COUNT);
+    bool fresh;
+    const uint8_t *frame = dmx_sources_latch(output, len, &fresh);
+    if (fade_enabled(output))
+    {
+        frame = fade_apply(output, frame, len, fresh, latency_now_us());
+    }
+    return frame;
+}
+
+// A port sends the output of the same number. Its engine is entered from
+// its own UART interrupt and, for all ports together, from the scheduler's
+// timer interrupt, all on one core and under dmx_transmit_spinlock.
+typedef struct {
+    uint8_t index;
+    uart_port_t uart;
+    dmx_frame_engine_t engine;
+    uint32_t last_break_us;
+    dmx_port_stats_t stats;
+} dmx_port_t;
+
+static dmx_port_t dmx_ports[DMX_PORT_COUNT];
+static dmx_sched_t dmx_sched;
+
+static void hal_set_break(void *ctx, bool on)
+{
+    dmx_port_t *port = ctx;
+    // set line to inverse, creates break signal
+    uart_ll_inverse_signal(UART_LL_GET_HW(port->uart), on ? UART_SIGNAL_TXD_INV : 0);
+    if (port->index == 0)
+    {
+        gpio_set_level(DMX_DEBUG_PIN, on);
+    }
+}
+
+static size_t hal_fifo_write(void *ctx, const uint8_t *data, size_t len)
+{
+    dmx_port_t *port = ctx;
+    dmx_stamp_t *stamp = &dmx_latched_stamp[port->index];
+    if (port->engine.sent == 0 && stamp->rx_us != 0)
+    {
+        // Start code about to go out
+        uint32_t now = latency_now_us();
+        latency_record(LATENCY_LATCH_TO_WIRE, now - stamp->stage_us);
+        latency_record(LATENCY_NET_TO_WIRE, now - stamp->rx_us);
+        latency_boot_mark(LATENCY_BOOT_FIRST_LIVE);
+        stamp->rx_us = 0;
+    }
+
+    uart_dev_t *hw = UART_LL_GET_HW(port->uart);
+    size_t space = uart_ll_get_txfifo_len(hw);
+    if (len > space)
+    {
+        len = space;
+    }
+    uart_ll_write_txfifo(hw, data, len);
+    port->stats.slots += len;
+    return len;
+}
 
-    while(true) {
-        //dmx_buffer[101]++; // Overeflow ok
-        //uart_write_bytes_with_break(DMX_UART_NUM, dmx_buffer, dmx_transmit_size , 100);
+static void hal_enable_tx_events(void *ctx, bool refill, bool done)
+{
+    dmx_port_t *port = ctx;
+    uart_dev_t *hw = UART_LL_GET_HW(port->uart);
+    uint32_t wanted = (refill ? UART_INTR_TXFIFO_EMPTY : 0) | (done ? UART_INTR_TX_DONE : 0);
+    uart_ll_disable_intr_mask(hw, ~wanted & (UART_INTR_TXFIFO_EMPTY | UART_INTR_TX_DONE));
+    uart_ll_clr_intsts_mask(hw, wanted);
+    uart_ll_ena_intr_mask(hw, wanted);
+}
 
-        //ESP_LOGI(TAG, "sending: %d", dmx_buffer[101]);
-        //    uint8_t start_code = 0x00;
+static void hal_arm_timer(void *ctx, uint64_t deadline_us)
+{
+    dmx_port_t *port = ctx;
+    dmx_sched_arm(&dmx_sched, port->index, deadline_us);
+}
 
-        if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) != pdTRUE)
+static void sched_arm_timer(void *ctx, uint64_t deadline_us)
+{
+    timer_group_set_alarm_value_in_isr(DMX_TIMER_GROUP, DMX_TIMER_IDX, deadline_us);
+    timer_group_enable_alarm_in_isr(DMX_TIMER_GROUP, DMX_TIMER_IDX);
+}
+
+static const uint8_t *hal_next_frame(void *ctx, size_t *len)
+{
+    dmx_port_t *port = ctx;
+    uint32_t now = latency_now_us();
+    if (port->last_break_us != 0)
+    {
+        int32_t deviation = (int32_t)(now - port->last_break_us - port->engine.timing.period_us);
+        uint32_t jitter = deviation < 0 ? -deviation : deviation;
+        latency_record(LATENCY_FRAME_JITTER, jitter);
+        if (jitter > DMX_LATE_FRAME_US)
         {
-            ESP_LOGW(TAG, "Unable to take semaphore at buffer swap");
-            //continue;
+            trace_event(TRACE_DMX_LATE_FRAME, port->index, deviation);
         }
+    }
+    port->last_break_us = now;
+    port->stats.frames++;
+    if (merge_active(port->index) != 0)
+    {
+        latency_boot_mark(LATENCY_BOOT_FIRST_LOOK);
+    }
+    return dmx_buffer_latch(port->index, len);
+}
 
-        if(dmx_swap_request)
+static const dmx_frame_hal_t dmx_frame_hal = {
+    .set_break = hal_set_break,
+    .fifo_write = hal_fifo_write,
+    .enable_tx_events = hal_enable_tx_events,
+    .arm_timer = hal_arm_timer,
+    .next_frame = hal_next_frame,
+};
+
+static bool dmx_timer_isr(void *arg)
+{
+    uint32_t start = cpu_hal_get_cycle_count();
+    uint64_t now = timer_group_get_counter_value_in_isr(DMX_TIMER_GROUP, DMX_TIMER_IDX);
+    portENTER_CRITICAL_ISR(&dmx_transmit_spinlock);
+    // The staggered starts keep it to one port per alarm nearly always,
+    // the time is shared out between the ports that were due
+    uint8_t due = 0;
+    for (uint8_t i = 0; i < DMX_PORT_COUNT; i++)
+    {
+        due |= (dmx_sched.deadline_us[i] <= now) << i;
+    }
+    dmx_sched_on_timer(&dmx_sched, now);
+    uint32_t cycles = cpu_hal_get_cycle_count() - start;
+    uint8_t count = __builtin_popcount(due);
+    for (uint8_t i = 0; i < DMX_PORT_COUNT; i++)
+    {
+        if (due & 1 << i)
         {
-            dmx_visible_layer ^= 0x01;
-            dmx_swap_request = false;
+            dmx_ports[i].stats.cycles += cycles / count;
         }
-        xSemaphoreGive(dmx_update_semaphore);
+    }
+    portEXIT_CRITICAL_ISR(&dmx_transmit_spinlock);
+    return false;
+}
 
-        // wait till uart is ready
-        if (uart_wait_tx_done(DMX_UART_NUM, 1000) != ESP_OK) {
-            ESP_LOGW(TAG, "TX not done yet");
-            continue;
+static void dmx_uart_isr(void *arg)
+{
+    uint32_t start = cpu_hal_get_cycle_count();
+    dmx_port_t *port = arg;
+    uart_dev_t *hw = UART_LL_GET_HW(port->uart);
+    uint32_t status = uart_ll_get_intsts_mask(hw);
+    uart_ll_clr_intsts_mask(hw, status);
+
+    uint64_t now = timer_group_get_counter_value_in_isr(DMX_TIMER_GROUP, DMX_TIMER_IDX);
+    portENTER_CRITICAL_ISR(&dmx_transmit_spinlock);
+    if (status & UART_INTR_TX_DONE)
+    {
+        dmx_frame_on_tx_done(&port->engine, now);
+    }
+    else if (status & UART_INTR_TXFIFO_EMPTY)
+    {
+        dmx_frame_on_fifo_empty(&port->engine, now);
+    }
+    port->stats.cycles += cpu_hal_get_cycle_count() - start;
+    portEXIT_CRITICAL_ISR(&dmx_transmit_spinlock);
+}
+
+void dmx_get_port_stats(uint8_t port, dmx_port_stats_t *stats)
+{
+    portENTER_CRITICAL(&dmx_transmit_spinlock);
+    *stats = dmx_ports[port].stats;
+    portEXIT_CRITICAL(&dmx_transmit_spinlock);
+}
+
+#if CONFIG_DMX_INPUT
+static dmx_rx_t dmx_rx;
+static TaskHandle_t dmx_input_listener = NULL;
+
+static void dmx_rx_isr(void *arg)
+{
+    uart_dev_t *hw = UART_LL_GET_HW(DMX_UART_NUM);
+    uint32_t status = uart_ll_get_intsts_mask(hw);
+    uart_ll_clr_intsts_mask(hw, status);
+
+    bool published = false;
+    if (status & UART_INTR_RXFIFO_OVF)
+    {
+        uart_ll_rxfifo_rst(hw);
+        dmx_rx_on_error(&dmx_rx);
+    }
+    else
+    {
+        uint8_t bytes[128];
+        size_t len = uart_ll_get_rxfifo_len(hw);
+        if (len > sizeof(bytes))
+        {
+            len = sizeof(bytes);
+        }
+        uart_ll_read_rxfifo(hw, bytes, len);
+        if (status & UART_INTR_BRK_DET)
+        {
+            // The break arrives as a NUL with a framing error, the last
+            // byte in the FIFO, the start code behind it is a MAB away
+            published = dmx_rx_on_data(&dmx_rx, bytes, len > 0 ? len - 1 : 0);
+            published |= dmx_rx_on_break(&dmx_rx, latency_now_us());
+        }
+        else
+        {
+            published = dmx_rx_on_data(&dmx_rx, bytes, len);
+        }
+    }
+
+    if (published && dmx_input_listener != NULL)
+    {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(dmx_input_listener, &woken);
+        if (woken == pdTRUE)
+        {
+            portYIELD_FROM_ISR();
         }
-        // set line to inverse, creates break signal
-        dmx_buffer[dmx_visible_layer][0] = 0x00;
-
-        taskENTER_CRITICAL(&dmx_transmit_spinlock);
-        uart_set_line_inverse(DMX_UART_NUM, UART_SIGNAL_TXD_INV);
-        // wait break time
-        //ets_delay_us(104);
-        ets_delay_us(184);
-        // disable break signal
-        uart_set_line_inverse(DMX_UART_NUM,  0);
-        // wait mark after break
-        // TODO: Use freertos wait
-        //ets_delay_us(4);
-        ets_delay_us(24);
-        // write start code
-        //uart_write_bytes(DMX_UART_NUM, (const char*) &start_code, 1);
-        // transmit the dmx data
-        //uart_write_bytes(DMX_UART_NUM, (const char*) dmx_buffer[dmx_visible_layer]+1, 512);
-//critical section
-        //gpio_set_level(DMX_DEBUG_PIN, 1);
-        uart_write_bytes(DMX_UART_NUM,  dmx_buffer[dmx_visible_layer], dmx_transmit_size);
-        taskEXIT_CRITICAL(&dmx_transmit_spinlock);
-        //gpio_set_level(DMX_DEBUG_PIN, 0);
-        vTaskDelay(pdMS_TO_TICKS(DMX_UPDATE_SPEED));
     }
 }
 
-void dmx_write(size_t channel, uint8_t value)
+void dmx_input_attach(void)
 {
-    if (channel < 1 || channel > 512)
+    dmx_input_listener = xTaskGetCurrentTaskHandle();
+}
+
+const uint8_t *dmx_input_take(size_t *len, uint32_t *break_us)
+{
+    return dmx_rx_take(&dmx_rx, len, break_us);
+}
+
+void dmx_input_get_stats(dmx_rx_stats_t *stats)
+{
+    *stats = dmx_rx.stats;
+}
+#endif
+
+// Brings the work buffer up to date after whole frame writes, before it is
+// written piecemeal. Called with dmx_update_semaphore held.
+static void dmx_work_restore(uint8_t output, uint8_t source)
+{
+    int8_t at = dmx_work_at[output][source];
+    if (at >= 0)
     {
-        ESP_LOGW(TAG, "Write request to invalid DMX channel %d", channel);
-        return;
+        memcpy(dmx_work[output][source], dmx_buffer[output][source][at], dmx_work_len[output][source]);
+        dmx_work_at[output][source] = -1;
     }
+}
+
+int dmx_source_claim(uint8_t output, uint32_t key)
+{
+    assert(output < DMX_OUTPUT_COUNT);
+    // Claims come from the network, server and CLI tasks, the semaphore
+    // keeps two keys off the same free slot
+    if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "Unable to take semaphore at dmx_source_claim");
+        return -1;
+    }
+    bool fresh;
+    int source = merge_claim(output, key, &fresh);
+    if (source >= 0 && fresh)
+    {
+        // Nothing of the slot's previous owner may leak into the new one
+        memset(dmx_work[output][source], 0, DMX_FRAME_STRIDE);
+        dmx_work_len[output][source] = dmx_initial_len();
+        dmx_work_at[output][source] = -1;
+        if (key != MERGE_KEY_LOOK)
+        {
+            // The look restored at power on is not merged with live data.
+            // It stays on the wire until the new source commits, since
+            // with no source active the output shows slot 0's last frame.
+            merge_release(output, MERGE_KEY_LOOK);
+        }
+    }
+    xSemaphoreGive(dmx_update_semaphore);
+    return source;
+}
+
+void dmx_source_release(uint8_t output, uint32_t key)
+{
+    assert(output < DMX_OUTPUT_COUNT);
     if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) == pdTRUE)
     {
-        dmx_buffer[0x01 ^ dmx_visible_layer][channel] = value;
-        dmx_swap_request = true;
+        merge_release(output, key);
         xSemaphoreGive(dmx_update_semaphore);
     }
     else
     {
-        ESP_LOGW(TAG, "Unable to take semaphore at dmx_write");
+        ESP_LOGW(TAG, "Unable to take semaphore at dmx_source_release");
     }
+}
 
+// Called with dmx_update_semaphore held and the work buffer up to date
+static void dmx_work_write(uint8_t output, uint8_t source, size_t first, const uint8_t* values, size_t count)
+{
+    uint8_t *work = dmx_work[output][source];
+    if (merge_get_mode(output) == MERGE_LTP && merge_active(output) != 0)
+    {
+        merge_track_changes(&merge_ltp_owner(output)[first], source,
+                &work[first], values, count);
+    }
+    memcpy(&work[first], values, count);
+    if (first + count > dmx_work_len[output][source])
+    {
+        dmx_work_len[output][source] = first + count;
+    }
 }
 
-void dmx_write_multiple(size_t first, uint8_t* values, size_t count)
+void dmx_output_write(uint8_t output, uint8_t source, size_t first, const uint8_t* values, size_t count)
 {
+    assert(output < DMX_OUTPUT_COUNT);
+    assert(source < MERGE_SOURCES);
     assert(first + count <= 513);
     if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) == pdTRUE)
     {
-        memcpy(&dmx_buffer[0x01 ^dmx_visible_layer][first], values, count);
-        dmx_swap_request = true;
+        dmx_work_restore(output, source);
+        dmx_work_write(output, source, first, values, count);
+        xSemaphoreGive(dmx_update_semaphore);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Unable to take semaphore at dmx_output_write");
+    }
+}
+
+void dmx_output_write_frame(uint8_t output, uint8_t source, const uint8_t* values, size_t count)
+{
+    assert(output < DMX_OUTPUT_COUNT);
+    assert(source < MERGE_SOURCES);
+    assert(count <= 512);
+    if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) == pdTRUE)
+    {
+        size_t len = count + 1;
+        if (len < dmx_work_len[output][source] || patch_active(output) ||
+                (merge_get_mode(output) == MERGE_LTP && merge_active(output) != 0))
+        {
+            // Older slots show through, or the frame needs the work buffer
+            // for a patch or LTP tracking
+            dmx_work_restore(output, source);
+            dmx_work_write(output, source, 1, values, count);
+        }
+        else
+        {
+            // The only copy on the way to the output, the commit just publishes
+            tribuf_t *tribuf = &dmx_tribuf[output][source];
+            uint8_t *back = dmx_buffer[output][source][tribuf->back];
+            back[0] = 0x00;
+            memcpy(&back[1], values, count);
+            dmx_work_len[output][source] = len;
+            dmx_work_at[output][source] = tribuf->back;
+        }
+        xSemaphoreGive(dmx_update_semaphore);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Unable to take semaphore at dmx_output_write_frame");
+    }
+}
+
+void dmx_output_write_sparse(uint8_t output, uint8_t source, const uint16_t *channels,
+        const uint8_t *values, size_t count)
+{
+    assert(output < DMX_OUTPUT_COUNT);
+    assert(source < MERGE_SOURCES);
+    if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) == pdTRUE)
+    {
+        dmx_work_restore(output, source);
+        uint8_t *work = dmx_work[output][source];
+        bool track = merge_get_mode(output) == MERGE_LTP && merge_active(output) != 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t channel = channels[i];
+            assert(channel >= 1 && channel <= 512);
+            if (track)
+            {
+                merge_track_changes(&merge_ltp_owner(output)[channel], source,
+                        &work[channel], &values[i], 1);
+            }
+            work[channel] = values[i];
+            if (channel + 1 > dmx_work_len[output][source])
+            {
+                dmx_work_len[output][source] = channel + 1;
+            }
+        }
+        xSemaphoreGive(dmx_update_semaphore);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Unable to take semaphore at dmx_output_write_sparse");
+    }
+}
+
+void dmx_output_stamp(uint8_t output, uint8_t source, uint32_t rx_us, uint32_t ingest_us)
+{
+    dmx_work_stamp[output][source].rx_us = rx_us;
+    dmx_work_stamp[output][source].stage_us = ingest_us;
+}
+
+void dmx_output_commit(uint8_t output, uint8_t source)
+{
+    assert(output < DMX_OUTPUT_COUNT);
+    assert(source < MERGE_SOURCES);
+    if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) == pdTRUE)
+    {
+        tribuf_t *tribuf = &dmx_tribuf[output][source];
+        uint8_t *back = dmx_buffer[output][source][tribuf->back];
+        size_t len = dmx_work_len[output][source];
+        if (patch_active(output))
+        {
+            dmx_work_restore(output, source);
+            // Remapped and through the curves in the same pass as the copy
+            len = patch_gather(output, back, dmx_work[output][source], len);
+#if !CONFIG_DMX_ADAPTIVE_LENGTH
+            memset(&back[len], 0, 513 - len);
+            len = 513;
+#endif
+            if (merge_get_mode(output) == MERGE_LTP)
+            {
+                patch_gather_owner(output, merge_ltp_slot_owner(output), merge_ltp_owner(output));
+            }
+        }
+        else if (dmx_work_at[output][source] != tribuf->back)
+        {
+            dmx_work_restore(output, source);
+            memcpy(back, dmx_work[output][source], len);
+        }
+        // else dmx_output_write_frame already wrote the frame in place
+        dmx_buffer_len[output][source][tribuf->back] = len;
+
+        dmx_stamp_t *work_stamp = &dmx_work_stamp[output][source];
+        dmx_stamp_t *stamp = &dmx_buffer_stamp[output][source][tribuf->back];
+        stamp->rx_us = work_stamp->rx_us;
+        stamp->stage_us = latency_now_us();
+        if (work_stamp->rx_us != 0)
+        {
+            latency_record(LATENCY_INGEST_TO_COMMIT, stamp->stage_us - work_stamp->stage_us);
+            work_stamp->rx_us = 0;
+        }
+
+        tribuf_publish(tribuf);
+        merge_mark_active(output, source);
         xSemaphoreGive(dmx_update_semaphore);
     }
     else
     {
-        ESP_LOGW(TAG, "Unable to take semaphore at dmx_write_multiple");
+        ESP_LOGW(TAG, "Unable to take semaphore at dmx_output_commit");
     }
 }
 
-// TODO: Write multiple channels in succession making sure data is not being sent in between
+size_t dmx_output_snapshot(uint8_t output, uint8_t *frame)
+{
+    assert(output < DMX_OUTPUT_COUNT);
+    size_t len = 0;
+    if (xSemaphoreTake(dmx_update_semaphore, portMAX_DELAY) != pdTRUE)
+    {
+        return 0;
+    }
+    uint8_t active = merge_active(output);
+    bool ltp = merge_get_mode(output) == MERGE_LTP;
+    const uint8_t *owner = merge_ltp_owner(output);
+    for (uint8_t source = 0; source < MERGE_SOURCES; source++)
+    {
+        if (!(active & 1 << source))
+        {
+            continue;
+        }
+        dmx_work_restore(output, source);
+        const uint8_t *work = dmx_work[output][source];
+        size_t work_len = dmx_work_len[output][source];
+        if (len == 0)
+        {
+            memcpy(frame, work, work_len);
+            len = work_len;
+            continue;
+        }
+        // Second source, merged as the output merges it
+        size_t common = len < work_len ? len : work_len;
+        for (size_t slot = 1; slot < common; slot++)
+        {
+            if (ltp ? owner[slot] != 0 : work[slot] > frame[slot])
+            {
+                frame[slot] = work[slot];
+            }
+        }
+        if (work_len > len)
+        {
+            memcpy(&frame[len], &work[len], work_len - len);
+            len = work_len;
+        }
+    }
+    xSemaphoreGive(dmx_update_semaphore);
+    if (len != 0)
+    {
+        frame[0] = 0x00;
+    }
+    return len;
+}
 
-#define STACK_SIZE 2000
-static StaticTask_t xTaskBuffer;
-static StackType_t xStack[ STACK_SIZE ];
-static TaskHandle_t task_handle = NULL;
+static void dmx_write_local(size_t first, const uint8_t* values, size_t count)
+{
+    int source = dmx_source_claim(0, MERGE_KEY_LOCAL);
+    if (source < 0)
+    {
+        ESP_LOGW(TAG, "Output 0 already merges two sources, local write dropped");
+        return;
+    }
+    dmx_output_write(0, source, first, values, count);
+    dmx_output_commit(0, source);
+}
 
-void dmx_task_start(void)
+void dmx_write(size_t channel, uint8_t value)
 {
-    task_handle = xTaskCreateStaticPinnedToCore(
-                  dmx_worker,
-                  "DMX worker",
-                  STACK_SIZE,
-                  (void *) 0,
-                  //tskIDLE_PRIORITY,
-                  //4,
-                  configMAX_PRIORITIES - 1,
-                  xStack,
-                  &xTaskBuffer,
-                  1
-                  );
+    if (channel < 1 || channel > 512)
+    {
+        ESP_LOGW(TAG, "Write request to invalid DMX channel %d", channel);
+        return;
+    }
+    dmx_write_local(channel, &value, 1);
+}
+
+void dmx_write_multiple(size_t first, const uint8_t* values, size_t count)
+{
+    dmx_write_local(first, values, count);
+}
+
+#if CONFIG_DMX_INPUT
+static void dmx_input_start(void)
+{
+    dmx_rx_init(&dmx_rx);
+    ESP_ERROR_CHECK(uart_isr_register(DMX_UART_NUM, dmx_rx_isr, NULL, 0, NULL));
+    uart_dev_t *hw = UART_LL_GET_HW(DMX_UART_NUM);
+    uart_ll_rxfifo_rst(hw);
+    uart_ll_clr_intsts_mask(hw, DMX_RX_INTERRUPTS);
+    uart_ll_ena_intr_mask(hw, DMX_RX_INTERRUPTS);
+
+    ESP_LOGI(TAG, "DMX input, output 0 is not driven");
+}
+#else
+static void dmx_ports_start(void)
+{
+    const dmx_frame_timing_t timing = {
+        .break_us = CONFIG_DMX_BREAK_US,
+        .mab_us = CONFIG_DMX_MAB_US,
+#if CONFIG_DMX_ADAPTIVE_LENGTH
+        // Short frames go out as fast as receivers allow
+        .period_us = CONFIG_DMX_MIN_FRAME_US,
+#else
+        .period_us = dmx_frame_period_us(CONFIG_DMX_REFRESH_HZ),
+#endif
+    };
+
+    setup_timer();
+    dmx_sched_init(&dmx_sched, sched_arm_timer, NULL);
+
+    // All interrupts land on the calling core, so no engine is ever
+    // entered from two places at once
+    for (uint8_t i = 0; i < DMX_PORT_COUNT; i++)
+    {
+        dmx_port_t *port = &dmx_ports[i];
+        port->uart = dmx_port_pins[i].uart;
+        dmx_frame_init(&port->engine, &dmx_frame_hal, port, &timing);
+        port->index = dmx_sched_add(&dmx_sched, &port->engine);
+        ESP_ERROR_CHECK(uart_isr_register(port->uart, dmx_uart_isr, port, 0, NULL));
+    }
+    ESP_ERROR_CHECK(timer_isr_callback_add(DMX_TIMER_GROUP, DMX_TIMER_IDX, dmx_timer_isr, NULL, 0));
+    ESP_ERROR_CHECK(timer_start(DMX_TIMER_GROUP, DMX_TIMER_IDX));
+
+    uint64_t now;
+    timer_get_counter_value(DMX_TIMER_GROUP, DMX_TIMER_IDX, &now);
+    portENTER_CRITICAL(&dmx_transmit_spinlock);
+    dmx_sched_start(&dmx_sched, now, timing.period_us);
+    portEXIT_CRITICAL(&dmx_transmit_spinlock);
+
+    ESP_LOGI(TAG, "%d DMX port%s every %d us at least, break %d us, MAB %d us", DMX_PORT_COUNT,
+            DMX_PORT_COUNT > 1 ? "s" : "", timing.period_us, CONFIG_DMX_BREAK_US, CONFIG_DMX_MAB_US);
+    latency_boot_mark(LATENCY_BOOT_DMX_START);
+}
+#endif
+
+void dmx_output_start(void)
+{
+    dmx_buffer_init();
+    for (uint8_t port = 0; port < DMX_PORT_COUNT; port++)
+    {
+        setup_uart(port);
+    }
+#if CONFIG_DMX_INPUT
+    dmx_input_start();
+#else
+    // In the buffers before the output starts, so the first frame has it
+    look_restore();
+    dmx_ports_start();
+#endif
 }
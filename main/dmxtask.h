@@ -1,6 +1,99 @@
-void dmx_task_start(void);
+#pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#if CONFIG_DMX_INPUT
+#include "dmxrx.h"
+#endif
+
+// Independent 512 channel outputs, each with its own universe route
+#define DMX_OUTPUT_COUNT CONFIG_DMX_OUTPUT_COUNT
+
+// Frame buffers are padded to whole words for the merge kernels
+#define DMX_FRAME_STRIDE 516
+
+// DMX lines driven, port n sends output n. The input takes the one UART
+// wired to a transceiver that can turn around.
+#if CONFIG_DMX_INPUT
+#define DMX_PORT_COUNT 1
+#else
+#define DMX_PORT_COUNT CONFIG_DMX_PORTS
+#endif
+
+// Counters of a port since it started, they wrap. Slots count the start
+// code, cycles are CPU cycles spent in its interrupts.
+typedef struct {
+    uint32_t frames;
+    uint32_t slots;
+    uint32_t cycles;
+} dmx_port_stats_t;
+
+// Sets up the buffers and the UARTs, then starts the ports. No task of its
+// own: the frames go out from the UART and timer interrupts, which latch
+// each frame as the previous one ends. With CONFIG_DMX_INPUT, starts
+// receiving on port 0 instead.
+void dmx_output_start(void);
+
+void dmx_get_port_stats(uint8_t port, dmx_port_stats_t *stats);
+
+// Sets up the output buffers, done by dmx_output_start before the ports start
+void dmx_buffer_init(void);
+
+// Makes the newest committed frame of each source of an output visible,
+// merges them if there are two and returns the frame (start code + slots)
+// to put on the wire. Wait-free, only the output may call it.
+const uint8_t *dmx_buffer_latch(uint8_t output, size_t *len);
+
+// Source slot for a protocol specific key (see merge.h), -1 if the output
+// already merges two other live sources and the data should be dropped
+int dmx_source_claim(uint8_t output, uint32_t key);
+
+// Drops key's slot right away, see merge_release
+void dmx_source_release(uint8_t output, uint32_t key);
+
+// Writes count slots starting at channel first (1-512) of an output's
+// source. Nothing reaches the wire before the source is committed.
+void dmx_output_write(uint8_t output, uint8_t source, size_t first, const uint8_t* values, size_t count);
+
+// Writes a frame of count slots from channel 1 on, the usual full universe
+// from the network. When it replaces everything the source has written so
+// far it goes straight into the buffer the commit publishes, instead of
+// through the work buffer, so the slots are copied once on their way to
+// the output.
+void dmx_output_write_frame(uint8_t output, uint8_t source, const uint8_t* values, size_t count);
+
+// Writes count (channel, value) pairs, channels 1-512 in any order, with a
+// single lock take. Like dmx_output_write nothing shows before the commit.
+void dmx_output_write_sparse(uint8_t output, uint8_t source, const uint16_t *channels,
+        const uint8_t *values, size_t count);
+
+// Network receive and ingest times (see latency.h) of what the source
+// wrote last, carried along with the frame for the latency histograms
+void dmx_output_stamp(uint8_t output, uint8_t source, uint32_t rx_us, uint32_t ingest_us);
+
+// Hands everything the source has written so far to the output as one frame
+void dmx_output_commit(uint8_t output, uint8_t source);
+
+// Copies what the output's live sources have written, merged as the output
+// merges them and before the patch, into frame (DMX_FRAME_STRIDE bytes).
+// Returns its length, 0 while no source is live.
+size_t dmx_output_snapshot(uint8_t output, uint8_t *frame);
+
+// dmx_write and dmx_write_multiple address output 0 as the local source and
+// commit right away
 void dmx_write(size_t, uint8_t);
 
-void dmx_write_multiple(size_t first, uint8_t* values, size_t count);
+void dmx_write_multiple(size_t first, const uint8_t* values, size_t count);
+
+#if CONFIG_DMX_INPUT
+// With CONFIG_DMX_INPUT the UART receives instead of driving output 0, see
+// dmxrx.h. Once attached the calling task is notified of every frame.
+void dmx_input_attach(void);
+
+// Newest frame received since the last call or NULL, see dmx_rx_take
+const uint8_t *dmx_input_take(size_t *len, uint32_t *break_us);
 
+void dmx_input_get_stats(dmx_rx_stats_t *stats);
+#endif
@@ -0,0 +1,131 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "fade.h"
+
+typedef struct {
+    uint8_t from[DMX_FRAME_STRIDE];
+    uint8_t to[DMX_FRAME_STRIDE];
+    uint8_t out[DMX_FRAME_STRIDE];
+    size_t len;                 // blended, the longer of the two frames
+    size_t to_len;              // the newest frame's, once settled
+    uint32_t start_us;
+    uint32_t duration_us;
+    uint32_t last_frame_us;
+    uint32_t interval_us;       // smoothed time between received frames
+    uint32_t fade_us;           // commanded, 0 to follow the interval
+    bool settled;               // out holds the target
+    bool enabled;
+} fade_state_t;
+
+static const char *TAG = "fade";
+
+// Owned by the output, fade_set only flips settings
+static fade_state_t fade_state[DMX_OUTPUT_COUNT] __attribute__((aligned(4)));
+
+void fade_init(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        fade_state_t *fade = &fade_state[output];
+        memset(fade, 0, sizeof(*fade));
+        fade->len = 1;
+        fade->to_len = 1;
+#if CONFIG_DMX_FADE
+        fade->enabled = true;
+        fade->fade_us = CONFIG_DMX_FADE_MS * 1000;
+#endif
+    }
+}
+
+void fade_set(uint8_t output, bool enabled, uint32_t fade_ms)
+{
+    fade_state[output].fade_us = fade_ms * 1000;
+    fade_state[output].enabled = enabled;
+    ESP_LOGI(TAG, "Output %d fade %s, %d ms", output, enabled ? "on" : "off", fade_ms);
+}
+
+bool fade_enabled(uint8_t output)
+{
+    return fade_state[output].enabled;
+}
+
+void fade_blend(uint8_t *restrict out, const uint8_t *restrict from,
+        const uint8_t *restrict to, uint16_t weight, size_t len)
+{
+    uint16_t keep = 256 - weight;
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = (uint16_t)(from[i] * keep + to[i] * weight) >> 8;
+    }
+}
+
+static void start_fade(fade_state_t *fade, const uint8_t *frame, size_t len, uint32_t now_us)
+{
+    uint32_t gap = now_us - fade->last_frame_us;
+    fade->last_frame_us = now_us;
+
+    if (gap <= FADE_MAX_AUTO_MS * 1000)
+    {
+        // Follows rate changes within a few frames without chasing jitter
+        fade->interval_us = fade->interval_us == 0 ? gap : (3 * fade->interval_us + gap) / 4;
+    }
+    else
+    {
+        // First frame after a pause, nothing sensible to fade from
+        fade->interval_us = 0;
+    }
+
+    // Fade from whatever is on the wire, slots the old frame did not have
+    // start from zero
+    memcpy(fade->from, fade->out, fade->len);
+    if (len > fade->len)
+    {
+        memset(&fade->from[fade->len], 0, len - fade->len);
+    }
+    memcpy(fade->to, frame, len);
+    fade->to_len = len;
+    fade->len = len > fade->len ? len : fade->len;
+    if (len < fade->len)
+    {
+        memset(&fade->to[len], 0, fade->len - len);
+    }
+    fade->start_us = now_us;
+    fade->settled = false;
+    fade->duration_us = fade->fade_us != 0 ? fade->fade_us : fade->interval_us;
+}
+
+const uint8_t *fade_apply(uint8_t output, const uint8_t *frame, size_t *len,
+        bool fresh, uint32_t now_us)
+{
+    fade_state_t *fade = &fade_state[output];
+
+    if (fresh)
+    {
+        start_fade(fade, frame, *len, now_us);
+    }
+
+    uint32_t elapsed = now_us - fade->start_us;
+    if (fade->settled)
+    {
+        // Nothing to do until the next frame
+    }
+    else if (elapsed >= fade->duration_us)
+    {
+        memcpy(fade->out, fade->to, fade->len);
+        // Slots a shorter frame dropped have faded out, the frame shrinks
+        fade->len = fade->to_len;
+        fade->settled = true;
+    }
+    else
+    {
+        uint16_t weight = ((uint64_t)elapsed << 8) / fade->duration_us;
+        fade_blend(fade->out, fade->from, fade->to, weight, fade->len);
+    }
+    fade->out[0] = 0x00;
+    *len = fade->len;
+    return fade->out;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Output stage interpolation for controllers that cannot send at the DMX
+// refresh rate. When a new frame arrives the output fades from what it is
+// showing to the new frame, over the smoothed interval between received
+// frames or over a commanded time, so a 25 fps stream turns into a smooth
+// 40 fps output at the cost of one frame interval of delay. It runs in the
+// output's latch, once per output frame.
+
+// Auto fades never stretch over more than this, longer gaps snap
+#define FADE_MAX_AUTO_MS 200
+
+void fade_init(void);
+
+// fade_ms 0 follows the received frame interval
+void fade_set(uint8_t output, bool enabled, uint32_t fade_ms);
+
+bool fade_enabled(uint8_t output);
+
+// Takes the newest latched frame (start code included, fresh when it was
+// not seen before) and returns the frame to transmit at now_us
+const uint8_t *fade_apply(uint8_t output, const uint8_t *frame, size_t *len,
+        bool fresh, uint32_t now_us);
+
+// out = (from * (256 - weight) + to * weight) / 256 per slot, weight 0-256.
+// Fixed point in 16 bit lanes so it vectorises.
+void fade_blend(uint8_t *restrict out, const uint8_t *restrict from,
+        const uint8_t *restrict to, uint16_t weight, size_t len);
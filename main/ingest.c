@@ -0,0 +1,119 @@
+#include "artpoll.h"
+#include "dmxtask.h"
+#include "ingest.h"
+#include "latency.h"
+#include "merge.h"
+#include "playout.h"
+
+static uint8_t deferred_outputs = 0;
+static uint8_t deferred_source[DMX_OUTPUT_COUNT];
+
+static uint32_t ingest_rx_us = 0;
+
+static bool batching = false;
+// Per output, bitmask of merge sources written during the batch
+static uint8_t batch_sources[DMX_OUTPUT_COUNT];
+
+void ingest_set_rx_time(uint32_t rx_us)
+{
+    ingest_rx_us = rx_us;
+}
+
+static void ingest_output(uint8_t output, uint32_t key, const uint8_t *slots, size_t count,
+        bool defer, uint32_t rx_us, uint32_t ingest_us)
+{
+    int source = dmx_source_claim(output, key);
+    if (source < 0)
+    {
+        // Already merging two other sources
+        return;
+    }
+    dmx_output_write_frame(output, source, slots, count);
+    dmx_output_stamp(output, source, rx_us, ingest_us);
+
+    bool merging = merge_active(output) == 0x03;
+    artpoll_set_merging(output, merging);
+    if (defer && !merging)
+    {
+        deferred_outputs |= 1 << output;
+        deferred_source[output] = source;
+    }
+    else if (batching)
+    {
+        batch_sources[output] |= 1 << source;
+    }
+    else
+    {
+        dmx_output_commit(output, source);
+    }
+}
+
+void ingest_dmx(uint8_t outputs, uint32_t key, const uint8_t *slots, size_t count, bool defer)
+{
+    uint32_t now = latency_now_us();
+    if (ingest_rx_us != 0)
+    {
+        latency_record(LATENCY_RECV_TO_INGEST, now - ingest_rx_us);
+    }
+
+    for (uint8_t output = 0; outputs != 0; output++, outputs >>= 1)
+    {
+        if (!(outputs & 0x01))
+        {
+            continue;
+        }
+        // ArtSync already times the frames, the jitter buffer stays out
+        if (!defer && playout_enabled(output) &&
+                playout_push(output, key, slots, count, ingest_rx_us, now))
+        {
+            continue;
+        }
+        ingest_output(output, key, slots, count, defer, ingest_rx_us, now);
+    }
+}
+
+uint32_t ingest_playout(void)
+{
+    uint32_t now = latency_now_us();
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        const playout_frame_t *frame;
+        while ((frame = playout_pop(output, now)) != NULL)
+        {
+            ingest_output(output, frame->key, frame->slots, frame->count, false,
+                    frame->rx_us, frame->ingest_us);
+        }
+    }
+    return playout_next_due(now);
+}
+
+void ingest_commit_deferred(void)
+{
+    for (uint8_t output = 0; deferred_outputs != 0; output++, deferred_outputs >>= 1)
+    {
+        if (deferred_outputs & 0x01)
+        {
+            dmx_output_commit(output, deferred_source[output]);
+        }
+    }
+}
+
+void ingest_batch_begin(void)
+{
+    batching = true;
+}
+
+void ingest_batch_end(void)
+{
+    batching = false;
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        for (uint8_t source = 0; batch_sources[output] != 0; source++, batch_sources[output] >>= 1)
+        {
+            if (batch_sources[output] & 0x01)
+            {
+                dmx_output_commit(output, source);
+            }
+        }
+    }
+}
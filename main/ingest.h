@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Protocol neutral path from a parsed DMX packet to the outputs, shared by
+// Art-Net and sACN so both claim merge sources, write and commit the same
+// way from the one network task.
+
+// Writes count slots, starting at channel 1, from the source identified by
+// key (see merge.h) to every output in the bitmask. Deferred outputs are
+// only committed by ingest_commit_deferred(), unless they are merging.
+void ingest_dmx(uint8_t outputs, uint32_t key, const uint8_t *slots, size_t count, bool defer);
+
+// Applies the frames the jitter buffer has due, see playout.h. Returns the
+// microseconds until the next one, UINT32_MAX when none is queued.
+uint32_t ingest_playout(void);
+
+// Receive time of the datagram handled next, for the latency histograms
+void ingest_set_rx_time(uint32_t rx_us);
+
+// Commits everything held back by deferred ingest_dmx calls
+void ingest_commit_deferred(void);
+
+// Between these, outputs written without defer are committed once, at the
+// end of the batch, instead of after every packet
+void ingest_batch_begin(void);
+void ingest_batch_end(void);
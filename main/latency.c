@@ -0,0 +1,208 @@
+#include <stdatomic.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "latency.h"
+
+// Values are clamped to 2^24 us, about 16 s
+#define LATENCY_SUB_BITS    3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS    24
+#define LATENCY_BUCKETS     ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+typedef struct {
+    atomic_uint buckets[LATENCY_BUCKETS];
+    atomic_uint max;
+} latency_hist_t;
+
+static const char *TAG = "latency";
+
+static latency_hist_t latency_hist[LATENCY_STAGES];
+static atomic_uint latency_boot[LATENCY_BOOT_MARKS];
+
+static const char *const stage_names[LATENCY_STAGES] = {
+    [LATENCY_RECV_TO_INGEST] = "recv->ingest",
+    [LATENCY_INGEST_TO_COMMIT] = "ingest->commit",
+    [LATENCY_COMMIT_TO_LATCH] = "commit->latch",
+    [LATENCY_LATCH_TO_WIRE] = "latch->wire",
+    [LATENCY_NET_TO_WIRE] = "net->wire",
+    [LATENCY_FRAME_JITTER] = "frame jitter",
+};
+
+static const char *const boot_names[LATENCY_BOOT_MARKS] = {
+    [LATENCY_BOOT_DMX_START] = "dmx start",
+    [LATENCY_BOOT_FIRST_LOOK] = "first look",
+    [LATENCY_BOOT_NETWORK_UP] = "network up",
+    [LATENCY_BOOT_FIRST_LIVE] = "first live",
+};
+
+// Values below 8 get a bucket each, above that the top bit picks the
+// octave and the next three bits the bucket within it
+static inline unsigned bucket_of(uint32_t us)
+{
+    if (us < LATENCY_SUB_BUCKETS)
+    {
+        return us;
+    }
+    if (us >= 1u << LATENCY_MAX_BITS)
+    {
+        return LATENCY_BUCKETS - 1;
+    }
+    unsigned msb = 31 - __builtin_clz(us);
+    return (msb - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS +
+        ((us >> (msb - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+static uint32_t bucket_upper(unsigned bucket)
+{
+    if (bucket < LATENCY_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+    unsigned msb = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    uint32_t step = 1u << (msb - LATENCY_SUB_BITS);
+    return (1u << msb) + (bucket % LATENCY_SUB_BUCKETS + 1) * step - 1;
+}
+
+void latency_record(latency_stage_t stage, uint32_t us)
+{
+    latency_hist_t *hist = &latency_hist[stage];
+    atomic_fetch_add_explicit(&hist->buckets[bucket_of(us)], 1, memory_order_relaxed);
+
+    unsigned max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while (us > max && !atomic_compare_exchange_weak_explicit(&hist->max, &max, us,
+                memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+void latency_summary(latency_stage_t stage, latency_summary_t *summary)
+{
+    latency_hist_t *hist = &latency_hist[stage];
+    uint32_t counts[LATENCY_BUCKETS];
+    uint32_t total = 0;
+
+    // Recording may go on meanwhile, so work from one copy of the buckets
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        counts[i] = atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        total += counts[i];
+    }
+
+    summary->count = total;
+    summary->max_us = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    summary->p50_us = 0;
+    summary->p99_us = 0;
+
+    uint32_t p50_rank = (total + 1) / 2;
+    uint32_t p99_rank = total - total / 100;
+    uint32_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS && seen < p99_rank; i++)
+    {
+        if (seen < p50_rank && seen + counts[i] >= p50_rank)
+        {
+            summary->p50_us = bucket_upper(i);
+        }
+        seen += counts[i];
+        if (seen >= p99_rank)
+        {
+            summary->p99_us = bucket_upper(i);
+        }
+    }
+    if (summary->p50_us > summary->max_us)
+    {
+        summary->p50_us = summary->max_us;
+    }
+    if (summary->p99_us > summary->max_us)
+    {
+        summary->p99_us = summary->max_us;
+    }
+}
+
+const char *latency_stage_name(latency_stage_t stage)
+{
+    return stage_names[stage];
+}
+
+void latency_reset(void)
+{
+    for (unsigned stage = 0; stage < LATENCY_STAGES; stage++)
+    {
+        latency_hist_t *hist = &latency_hist[stage];
+        for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            atomic_store_explicit(&hist->buckets[i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&hist->max, 0, memory_order_relaxed);
+    }
+}
+
+void latency_boot_mark(latency_boot_t mark)
+{
+    if (atomic_load_explicit(&latency_boot[mark], memory_order_relaxed) != 0)
+    {
+        return;
+    }
+    // Never 0, that means not yet
+    unsigned now = latency_now_us() | 1;
+    unsigned unset = 0;
+    atomic_compare_exchange_strong_explicit(&latency_boot[mark], &unset, now,
+            memory_order_relaxed, memory_order_relaxed);
+}
+
+uint32_t latency_boot_us(latency_boot_t mark)
+{
+    return atomic_load_explicit(&latency_boot[mark], memory_order_relaxed);
+}
+
+void latency_log_summary(void)
+{
+    latency_summary_t summary;
+    for (unsigned stage = 0; stage < LATENCY_STAGES; stage++)
+    {
+        latency_summary(stage, &summary);
+        ESP_LOGI(TAG, "%-15s n=%u p50=%u us p99=%u us max=%u us", stage_names[stage],
+                summary.count, summary.p50_us, summary.p99_us, summary.max_us);
+    }
+    for (unsigned mark = 0; mark < LATENCY_BOOT_MARKS; mark++)
+    {
+        uint32_t us = latency_boot_us(mark);
+        if (us != 0)
+        {
+            ESP_LOGI(TAG, "%-15s %u ms after boot", boot_names[mark], us / 1000);
+        }
+    }
+}
+
+#if CONFIG_LATENCY_SUMMARY_S > 0
+static void latency_worker(void *pvParameters)
+{
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_LATENCY_SUMMARY_S * 1000));
+        latency_log_summary();
+    }
+}
+
+#define STACK_SIZE 3000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+#endif
+
+void latency_task_start(void)
+{
+#if CONFIG_LATENCY_SUMMARY_S > 0
+    xTaskCreateStatic(
+            latency_worker,
+            "latency",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY,
+            xStack,
+            &xTaskBuffer
+            );
+#endif
+}
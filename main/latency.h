@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_timer.h"
+
+// Latency histograms of the path a DMX frame takes from the network to the
+// wire, and of the output frame period. Recording is lock-free and safe
+// from interrupts: log-bucketed counters with eight buckets per power of
+// two, so percentiles are within 12.5% of the true value.
+//
+// Timestamps come from the esp_timer microsecond clock rather than the CPU
+// cycle counter, which is per core and not synchronised between the core
+// running the network task and the one taking the DMX interrupts.
+
+typedef enum {
+    LATENCY_RECV_TO_INGEST,     // datagram read to parsed, includes batching
+    LATENCY_INGEST_TO_COMMIT,   // written to committed, ArtSync and playout wait here
+    LATENCY_COMMIT_TO_LATCH,    // waiting for the next break
+    LATENCY_LATCH_TO_WIRE,      // break and MAB until the start code goes out
+    LATENCY_NET_TO_WIRE,        // the whole way
+    LATENCY_FRAME_JITTER,       // break to break deviation from the period
+    LATENCY_STAGES,
+} latency_stage_t;
+
+// Startup milestones. Times count from when esp_timer started, early in
+// the application's startup; the ROM and second stage bootloader before it
+// add a fairly constant 100-300 ms to the time since power on.
+typedef enum {
+    LATENCY_BOOT_DMX_START,     // output running
+    LATENCY_BOOT_FIRST_LOOK,    // first frame carrying a look, restored or live
+    LATENCY_BOOT_NETWORK_UP,    // got an address, receiving
+    LATENCY_BOOT_FIRST_LIVE,    // first frame from the network on the wire
+    LATENCY_BOOT_MARKS,
+} latency_boot_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} latency_summary_t;
+
+static inline uint32_t latency_now_us(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+void latency_record(latency_stage_t stage, uint32_t us);
+
+// Percentiles report the upper edge of their bucket, at most the maximum
+void latency_summary(latency_stage_t stage, latency_summary_t *summary);
+
+const char *latency_stage_name(latency_stage_t stage);
+
+void latency_reset(void);
+
+// Keeps the time of the first call per milestone, safe from interrupts
+void latency_boot_mark(latency_boot_t mark);
+
+// Microseconds to the milestone, 0 while it has not happened
+uint32_t latency_boot_us(latency_boot_t mark);
+
+// Logs a line per stage and the startup milestones
+void latency_log_summary(void);
+
+// Logs the summary every CONFIG_LATENCY_SUMMARY_S seconds
+void latency_task_start(void);
@@ -0,0 +1,71 @@
+#include "esp_log.h"
+
+#include "dmxtask.h"
+#include "look.h"
+#include "merge.h"
+
+static const char *TAG = "look";
+
+// FNV-1a over the length and the slots
+uint32_t look_hash(const uint8_t *frame, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (uint32_t)len) * 16777619u;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = (hash ^ frame[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void look_tracker_init(look_tracker_t *tracker, uint32_t stored_hash, uint32_t interval_ms,
+        uint32_t now_ms)
+{
+    tracker->seen_hash = stored_hash;
+    tracker->stored_hash = stored_hash;
+    tracker->changed_ms = now_ms;
+    tracker->saved_ms = now_ms;
+    tracker->interval_ms = interval_ms;
+    tracker->saved = false;
+}
+
+bool look_tracker_check(look_tracker_t *tracker, const uint8_t *frame, size_t len,
+        uint32_t now_ms)
+{
+    uint32_t hash = look_hash(frame, len);
+    if (hash != tracker->seen_hash)
+    {
+        tracker->seen_hash = hash;
+        tracker->changed_ms = now_ms;
+        return false;
+    }
+    if (hash == tracker->stored_hash || now_ms - tracker->changed_ms < LOOK_SETTLE_MS)
+    {
+        return false;
+    }
+    // The first save after power on is not held back, a look set up just
+    // before a power cut is the one that matters
+    return !tracker->saved || now_ms - tracker->saved_ms >= tracker->interval_ms;
+}
+
+void look_tracker_saved(look_tracker_t *tracker, bool written, uint32_t now_ms)
+{
+    if (written)
+    {
+        tracker->stored_hash = tracker->seen_hash;
+    }
+    tracker->saved_ms = now_ms;
+    tracker->saved = true;
+}
+
+void look_apply(uint8_t output, const uint8_t *frame, size_t len)
+{
+    int source = dmx_source_claim(output, MERGE_KEY_LOOK);
+    if (source < 0 || len < 2 || len > 513)
+    {
+        ESP_LOGW(TAG, "Output %d: look not applied", output);
+        return;
+    }
+    dmx_output_write(output, source, 1, &frame[1], len - 1);
+    dmx_output_commit(output, source);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps the look on stage across a power cycle. At power on the stored look
+// is committed to the outputs before the DMX output starts, as a source of
+// its own (MERGE_KEY_LOOK) that gives way, without merging, as soon as a
+// live source claims the output. While running, the look is checked once a
+// second and saved once it has held still for LOOK_SETTLE_MS, when it
+// differs from what is stored and no sooner than a minimum interval after
+// the last save, so fades and chases do not wear out the flash. The NVS
+// side is in looktask.h, this is the part the host build can test.
+
+#define LOOK_SETTLE_MS 2000
+
+typedef struct {
+    uint32_t seen_hash;     // look at the last check
+    uint32_t stored_hash;
+    uint32_t changed_ms;    // when the look last moved
+    uint32_t saved_ms;
+    uint32_t interval_ms;
+    bool saved;             // since power on
+} look_tracker_t;
+
+uint32_t look_hash(const uint8_t *frame, size_t len);
+
+// stored_hash is look_hash of what is in flash, 0 for nothing
+void look_tracker_init(look_tracker_t *tracker, uint32_t stored_hash, uint32_t interval_ms,
+        uint32_t now_ms);
+
+// Whether the look (start code + slots) is due to be saved now
+bool look_tracker_check(look_tracker_t *tracker, const uint8_t *frame, size_t len,
+        uint32_t now_ms);
+
+// After the look last checked was written, or failed to be. A failed write
+// is tried again once the interval is up.
+void look_tracker_saved(look_tracker_t *tracker, bool written, uint32_t now_ms);
+
+// Commits a stored look to output as the MERGE_KEY_LOOK source
+void look_apply(uint8_t output, const uint8_t *frame, size_t len);
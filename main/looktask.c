@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "look.h"
+#include "looktask.h"
+
+#define LOOK_NAMESPACE  "look"
+#define LOOK_CHECK_MS   1000
+
+static const char *TAG = "look";
+
+static look_stats_t stats;
+#if CONFIG_DMX_BOOT_LOOK_LAST
+static uint32_t restored_hash[DMX_OUTPUT_COUNT];
+#endif
+
+static void key_name(char *key, size_t size, const char *kind, uint8_t output)
+{
+    snprintf(key, size, "%s%u", kind, output);
+}
+
+#if !CONFIG_DMX_BOOT_LOOK_BLACKOUT
+// Length of the look read into frame, 0 if there is none
+static size_t load(nvs_handle_t nvs, const char *kind, uint8_t output, uint8_t *frame)
+{
+    char key[16];
+    key_name(key, sizeof(key), kind, output);
+    size_t len = 513;
+    if (nvs_get_blob(nvs, key, frame, &len) != ESP_OK || len < 2)
+    {
+        return 0;
+    }
+    return len;
+}
+#endif
+
+static bool store(const char *kind, uint8_t output, const uint8_t *frame, size_t len)
+{
+    char key[16];
+    key_name(key, sizeof(key), kind, output);
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(LOOK_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs, key, frame, len);
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Output %d: %s look not saved: %s", output, kind, esp_err_to_name(err));
+        stats.failures++;
+        return false;
+    }
+    return true;
+}
+
+void look_restore(void)
+{
+#if !CONFIG_DMX_BOOT_LOOK_BLACKOUT
+    nvs_handle_t nvs;
+    if (nvs_open(LOOK_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK)
+    {
+        // First boot, nothing ever saved
+        ESP_LOGI(TAG, "No stored look");
+        return;
+    }
+    static uint8_t frame[513];
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        const char *kind = "preset";
+        size_t len = 0;
+#if CONFIG_DMX_BOOT_LOOK_LAST
+        len = load(nvs, "last", output, frame);
+        if (len != 0)
+        {
+            kind = "last";
+            restored_hash[output] = look_hash(frame, len);
+        }
+#endif
+        if (len == 0)
+        {
+            len = load(nvs, "preset", output, frame);
+        }
+        if (len == 0)
+        {
+            continue;
+        }
+        look_apply(output, frame, len);
+        stats.restored++;
+        ESP_LOGI(TAG, "Output %d: %s look restored, %d slots", output, kind, len - 1);
+    }
+    nvs_close(nvs);
+#endif
+}
+
+#if CONFIG_DMX_BOOT_LOOK_LAST
+static void look_worker(void *pvParameters)
+{
+    static look_tracker_t trackers[DMX_OUTPUT_COUNT];
+    static uint8_t frame[DMX_FRAME_STRIDE];
+
+    TickType_t wake = xTaskGetTickCount();
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        look_tracker_init(&trackers[output], restored_hash[output],
+                CONFIG_DMX_LOOK_SAVE_S * 1000, wake * portTICK_PERIOD_MS);
+    }
+    while (1)
+    {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(LOOK_CHECK_MS));
+        uint32_t now_ms = wake * portTICK_PERIOD_MS;
+        for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+        {
+            size_t len = dmx_output_snapshot(output, frame);
+            if (len == 0 || !look_tracker_check(&trackers[output], frame, len, now_ms))
+            {
+                continue;
+            }
+            // A failed write is not retried before the interval is up either
+            bool written = store("last", output, frame, len);
+            if (written)
+            {
+                stats.saves++;
+                ESP_LOGD(TAG, "Output %d: last look saved", output);
+            }
+            look_tracker_saved(&trackers[output], written, now_ms);
+        }
+    }
+}
+
+#define STACK_SIZE 3000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+#endif
+
+void look_task_start(void)
+{
+#if CONFIG_DMX_BOOT_LOOK_LAST
+    xTaskCreateStatic(
+            look_worker,
+            "look",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY,
+            xStack,
+            &xTaskBuffer
+            );
+#endif
+}
+
+bool look_save_preset(void)
+{
+    static uint8_t frame[DMX_FRAME_STRIDE];
+    bool ok = true;
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        size_t len = dmx_output_snapshot(output, frame);
+        if (len == 0)
+        {
+            // Nothing live, a blackout preset
+            memset(frame, 0, 513);
+            len = 513;
+        }
+        ok &= store("preset", output, frame, len);
+    }
+    return ok;
+}
+
+void look_get_stats(look_stats_t *stats_out)
+{
+    *stats_out = stats;
+}
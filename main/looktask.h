@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// NVS side of look.h, namespace "look", a blob per output for the last look
+// and for the preset.
+
+typedef struct {
+    uint32_t restored;      // outputs given a stored look at power on
+    uint32_t saves;
+    uint32_t failures;
+} look_stats_t;
+
+// Commits the stored looks to the outputs, between dmx_buffer_init and the
+// output starting. The last look with CONFIG_DMX_BOOT_LOOK_LAST, falling
+// back to the preset, or only the preset with CONFIG_DMX_BOOT_LOOK_PRESET.
+void look_restore(void);
+
+// Starts saving the last look with CONFIG_DMX_BOOT_LOOK_LAST
+void look_task_start(void);
+
+// Stores what the outputs show now as the preset
+bool look_save_preset(void);
+
+void look_get_stats(look_stats_t *stats);
@@ -9,10 +9,15 @@
 
 #include "common.h"
 #include "artnet.h"
+#include "dmxintask.h"
 #include "dmxtask.h"
+#include "latency.h"
+#include "looktask.h"
+#include "pixeltask.h"
 #include "wifitask.h"
 #include "servertask.h"
 #include "clitask.h"
+#include "showtask.h"
 
 enum state_ state;
 
@@ -29,11 +34,28 @@ void app_main(void)
 
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    dmx_task_start();
+    // Outputs first, with the stored look, everything else starts without
+    // waiting for the network and the network tasks wait for it themselves
+    dmx_output_start();
+#if !CONFIG_DMX_INPUT
+    look_task_start();
+#endif
+#if CONFIG_PIXEL_ENABLE
+    pixel_task_start();
+#endif
+#if CONFIG_SHOW_ENABLE
+    show_task_start();
+#endif
     wifi_task_start();
-    //server_task_start();
+#if CONFIG_SERVER_ENABLE
+    server_task_start();
+#endif
     artnet_task_start();
+#if CONFIG_DMX_INPUT
+    dmx_input_task_start();
+#endif
     cli_task_start();
+    latency_task_start();
 
     while(1)
     {
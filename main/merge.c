@@ -0,0 +1,179 @@
+#include <stdatomic.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "merge.h"
+#include "trace.h"
+
+static const char *TAG = "merge";
+
+typedef struct {
+    uint32_t key;
+    TickType_t last_seen;
+    bool claimed;
+} merge_source_t;
+
+// Sources are claimed and released under dmx_update_semaphore, through
+// dmx_source_claim and dmx_source_release, the active mask and the mode
+// are also read by the output when it latches
+static merge_source_t merge_sources[DMX_OUTPUT_COUNT][MERGE_SOURCES];
+static atomic_uint_fast8_t merge_active_mask[DMX_OUTPUT_COUNT];
+static merge_mode_t merge_mode[DMX_OUTPUT_COUNT];
+static uint8_t merge_owner[DMX_OUTPUT_COUNT][DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+static uint8_t merge_slot_owner[DMX_OUTPUT_COUNT][DMX_FRAME_STRIDE] __attribute__((aligned(4)));
+
+void merge_init(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        memset(merge_sources[output], 0, sizeof(merge_sources[output]));
+        atomic_init(&merge_active_mask[output], 0);
+#if CONFIG_DMX_MERGE_LTP
+        merge_mode[output] = MERGE_LTP;
+#else
+        merge_mode[output] = MERGE_HTP;
+#endif
+        memset(merge_owner[output], 0, DMX_FRAME_STRIDE);
+        memset(merge_slot_owner[output], 0, DMX_FRAME_STRIDE);
+    }
+}
+
+int merge_claim(uint8_t output, uint32_t key, bool *fresh)
+{
+    merge_source_t *sources = merge_sources[output];
+    TickType_t now = xTaskGetTickCount();
+    int free_slot = -1;
+
+    *fresh = false;
+    // All slots first, a source that keeps sending must not keep a silent
+    // one's slot alive by matching before it is looked at
+    for (int i = 0; i < MERGE_SOURCES; i++)
+    {
+        if (sources[i].claimed && sources[i].key != key &&
+                sources[i].key != MERGE_KEY_LOCAL &&
+                now - sources[i].last_seen > pdMS_TO_TICKS(MERGE_SOURCE_TIMEOUT_MS))
+        {
+            trace_event(TRACE_MERGE_TIMEOUT, output, sources[i].key);
+            ESP_LOGI(TAG, "Output %d source %08x timed out", output, sources[i].key);
+            sources[i].claimed = false;
+            atomic_fetch_and(&merge_active_mask[output], ~(1u << i));
+        }
+    }
+
+    for (int i = 0; i < MERGE_SOURCES; i++)
+    {
+        if (sources[i].claimed && sources[i].key == key)
+        {
+            sources[i].last_seen = now;
+            return i;
+        }
+        if (!sources[i].claimed && free_slot < 0)
+        {
+            free_slot = i;
+        }
+    }
+
+    if (free_slot >= 0)
+    {
+        sources[free_slot].claimed = true;
+        sources[free_slot].key = key;
+        sources[free_slot].last_seen = now;
+        *fresh = true;
+    }
+    return free_slot;
+}
+
+void merge_release(uint8_t output, uint32_t key)
+{
+    merge_source_t *sources = merge_sources[output];
+    for (int i = 0; i < MERGE_SOURCES; i++)
+    {
+        if (sources[i].claimed && sources[i].key == key)
+        {
+            sources[i].claimed = false;
+            atomic_fetch_and(&merge_active_mask[output], ~(1u << i));
+        }
+    }
+}
+
+uint8_t merge_active(uint8_t output)
+{
+    return atomic_load_explicit(&merge_active_mask[output], memory_order_acquire);
+}
+
+void merge_mark_active(uint8_t output, uint8_t source)
+{
+    atomic_fetch_or_explicit(&merge_active_mask[output], 1u << source, memory_order_release);
+}
+
+merge_mode_t merge_get_mode(uint8_t output)
+{
+    return merge_mode[output];
+}
+
+void merge_set_mode(uint8_t output, merge_mode_t mode)
+{
+    merge_mode[output] = mode;
+}
+
+uint8_t *merge_ltp_owner(uint8_t output)
+{
+    return merge_owner[output];
+}
+
+uint8_t *merge_ltp_slot_owner(uint8_t output)
+{
+    return merge_slot_owner[output];
+}
+
+static inline uint32_t load_word(const uint8_t *p)
+{
+    uint32_t word;
+    memcpy(&word, __builtin_assume_aligned(p, 4), sizeof(word));
+    return word;
+}
+
+static inline void store_word(uint8_t *p, uint32_t word)
+{
+    memcpy(__builtin_assume_aligned(p, 4), &word, sizeof(word));
+}
+
+// Branch free so it vectorises where there is SIMD, on the ESP32 it is one
+// MAXU per slot
+void merge_htp(uint8_t *restrict out, const uint8_t *restrict a,
+        const uint8_t *restrict b, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = a[i] > b[i] ? a[i] : b[i];
+    }
+}
+
+// Owner bytes are full masks, so a select is three logic ops per word
+void merge_ltp(uint8_t *restrict out, const uint8_t *restrict a,
+        const uint8_t *restrict b, const uint8_t *restrict owner, size_t len)
+{
+    for (size_t i = 0; i < len; i += 4)
+    {
+        uint32_t take_b = load_word(&owner[i]);
+        store_word(&out[i], (load_word(&a[i]) & ~take_b) | (load_word(&b[i]) & take_b));
+    }
+}
+
+void merge_track_changes(uint8_t *owner, uint8_t source, const uint8_t *prev,
+        const uint8_t *next, size_t len)
+{
+    uint8_t mark = source == 0 ? 0x00 : 0xff;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (prev[i] != next[i])
+        {
+            owner[i] = mark;
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Art-Net style merging of up to two sources per DMX output. Sources are
+// identified by a protocol specific key (for Art-Net the sender's IPv4
+// address), claim a slot on their first packet and lose it after
+// MERGE_SOURCE_TIMEOUT_MS of silence. A third source is ignored while two
+// are live. The merge kernels are branch free loops over the whole frame and
+// run once per output frame when the output latches, not once per packet.
+
+#define MERGE_SOURCES           2
+#define MERGE_SOURCE_TIMEOUT_MS 10000
+
+// Key of data written locally through dmx_write (TCP server, CLI). It
+// never times out, local values stay until they are written again, so
+// once used it keeps one of the output's two slots.
+#define MERGE_KEY_LOCAL         0
+// Key of the look restored at power on (look.h), gives way to any other
+#define MERGE_KEY_LOOK          0xfffffffe
+
+typedef enum {
+    MERGE_HTP,      // highest takes precedence, per channel
+    MERGE_LTP,      // latest takes precedence, per channel
+} merge_mode_t;
+
+void merge_init(void);
+
+// Returns the source slot of key on output, or -1 if two other sources are
+// live. *fresh is set when the slot was newly claimed and holds nothing yet.
+// Not locked, see dmx_source_claim.
+int merge_claim(uint8_t output, uint32_t key, bool *fresh);
+
+// Drops key's slot right away instead of waiting for it to time out
+void merge_release(uint8_t output, uint32_t key);
+
+// Bitmask of slots that have committed data and not timed out
+uint8_t merge_active(uint8_t output);
+void merge_mark_active(uint8_t output, uint8_t source);
+
+merge_mode_t merge_get_mode(uint8_t output);
+void merge_set_mode(uint8_t output, merge_mode_t mode);
+
+// LTP ownership, 0x00 per channel for source 0 and 0xff for source 1
+uint8_t *merge_ltp_owner(uint8_t output);
+
+// Ownership per transmitted slot for a patched output, the channel
+// ownership gathered through the patch on every commit
+uint8_t *merge_ltp_slot_owner(uint8_t output);
+
+// Frame kernels, run at latch time on non-overlapping buffers
+
+// out = max(a, b) per slot
+void merge_htp(uint8_t *restrict out, const uint8_t *restrict a,
+        const uint8_t *restrict b, size_t len);
+
+// out = owner ? b : a per slot, works a word at a time: buffers must be 4
+// byte aligned with len rounded up to a multiple of 4 worth of room
+void merge_ltp(uint8_t *restrict out, const uint8_t *restrict a,
+        const uint8_t *restrict b, const uint8_t *restrict owner, size_t len);
+
+// Hands every slot where next differs from prev over to source, run per
+// packet on the incoming slots, so no alignment needed
+void merge_track_changes(uint8_t *owner, uint8_t source, const uint8_t *prev,
+        const uint8_t *next, size_t len);
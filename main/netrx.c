@@ -0,0 +1,112 @@
+#include "esp_log.h"
+#include "lwip/api.h"
+
+#include "netrx.h"
+
+static const char *TAG = "netrx";
+
+static void (*netrx_wake)(void) = NULL;
+
+// Runs in lwIP's thread, must not touch anything of the network task
+static void netrx_event(struct netconn *conn, enum netconn_evt evt, u16_t len)
+{
+    if (evt == NETCONN_EVT_RCVPLUS && netrx_wake != NULL)
+    {
+        netrx_wake();
+    }
+}
+
+static void netrx_release(void *ref)
+{
+    netbuf_delete(ref);
+}
+
+void netrx_init(void (*wake)(void))
+{
+    netrx_wake = wake;
+}
+
+bool netrx_open(netrx_t *rx, uint16_t port, rxbatch_proto_t proto)
+{
+    rx->proto = proto;
+    rx->conn = netconn_new_with_callback(NETCONN_UDP, netrx_event);
+    if (rx->conn == NULL)
+    {
+        ESP_LOGE(TAG, "Unable to create netconn for port %d", port);
+        return false;
+    }
+    err_t err = netconn_bind(rx->conn, IP_ADDR_ANY, port);
+    if (err != ERR_OK)
+    {
+        ESP_LOGE(TAG, "Unable to bind port %d: %d", port, err);
+        netconn_delete(rx->conn);
+        rx->conn = NULL;
+        return false;
+    }
+    netconn_set_nonblocking(rx->conn, 1);
+    ESP_LOGI(TAG, "Receiving port %d in place", port);
+    return true;
+}
+
+bool netrx_join(netrx_t *rx, uint32_t group)
+{
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32(&addr, group);
+    err_t err = netconn_join_leave_group(rx->conn, &addr, IP_ADDR_ANY, NETCONN_JOIN);
+    if (err != ERR_OK)
+    {
+        ESP_LOGW(TAG, "Unable to join group %08x: %d", group, err);
+        return false;
+    }
+    return true;
+}
+
+int netrx_drain(netrx_t *rx, int max)
+{
+    int drained = 0;
+    for (; drained < max; drained++)
+    {
+        struct netbuf *buf;
+        err_t err = netconn_recv(rx->conn, &buf);
+        if (err == ERR_WOULDBLOCK)
+        {
+            break;
+        }
+        if (err != ERR_OK)
+        {
+            ESP_LOGE(TAG, "netconn_recv failed: %d", err);
+            return -1;
+        }
+
+        uint32_t source_ip = ip_addr_get_ip4_u32(netbuf_fromaddr(buf));
+        void *data;
+        u16_t len;
+        netbuf_data(buf, &data, &len);
+        if (len == netbuf_len(buf))
+        {
+            rxbatch_push_ref(rx->proto, data, len, source_ip, netrx_release, buf);
+        }
+        else
+        {
+            size_t copied = netbuf_copy(buf, rxbatch_slot(), RXBATCH_SLOT_LEN);
+            netbuf_delete(buf);
+            rxbatch_push(rx->proto, copied, source_ip);
+        }
+    }
+    return drained;
+}
+
+bool netrx_sendto(netrx_t *rx, const void *data, size_t len, uint32_t ip, uint16_t port)
+{
+    struct netbuf *buf = netbuf_new();
+    if (buf == NULL)
+    {
+        return false;
+    }
+    ip_addr_t addr;
+    ip_addr_set_ip4_u32(&addr, ip);
+    netbuf_ref(buf, data, len);
+    err_t err = netconn_sendto(rx->conn, buf, &addr, port);
+    netbuf_delete(buf);
+    return err == ERR_OK;
+}
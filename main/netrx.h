@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rxbatch.h"
+
+// Zero-copy datagram receive through lwIP's netconn API, for
+// CONFIG_ARTNET_ZERO_COPY. lwIP's callback only wakes the network task,
+// which takes the queued netbufs and hands their payload to rxbatch where
+// it sits in the lwIP buffer, freeing them once the batch is processed.
+// Together with dmx_output_write_frame a universe is copied once, from the
+// receive buffer into the output. Datagrams lwIP had to chain over several
+// buffers are copied into an rxbatch slot instead.
+
+struct netconn;
+
+typedef struct {
+    struct netconn *conn;
+    rxbatch_proto_t proto;
+} netrx_t;
+
+// wake is called from lwIP's thread whenever a datagram is queued
+void netrx_init(void (*wake)(void));
+
+bool netrx_open(netrx_t *rx, uint16_t port, rxbatch_proto_t proto);
+
+// Multicast group in network byte order
+bool netrx_join(netrx_t *rx, uint32_t group);
+
+// Moves up to max waiting datagrams into the current batch, returns how
+// many or -1 on a receive error
+int netrx_drain(netrx_t *rx, int max);
+
+// ip in network byte order
+bool netrx_sendto(netrx_t *rx, const void *data, size_t len, uint32_t ip, uint16_t port);
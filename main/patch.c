@@ -0,0 +1,195 @@
+#include <math.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "patch.h"
+
+// A slot's map entry packs its curve above the received channel, so the
+// kernel gets both with one load and the curve times 256 with one shift
+#define PATCH_CHANNEL_BITS 10
+#define PATCH_CHANNEL_MASK ((1 << PATCH_CHANNEL_BITS) - 1)
+#define PATCH_ENTRY(channel, curve) ((uint16_t)((curve) << PATCH_CHANNEL_BITS | (channel)))
+
+#define PATCH_GAMMA 2.2f
+
+typedef struct {
+    uint16_t map[513];      // per output slot, slot 0 unused
+    size_t len;             // last mapped slot + 1
+    bool active;
+} patch_t;
+
+static const char *TAG = "patch";
+
+static patch_t patches[DMX_OUTPUT_COUNT];
+static uint8_t patch_luts[PATCH_CURVES][256];
+
+// Edits against commits, which run in the network task
+static SemaphoreHandle_t patch_lock = NULL;
+static StaticSemaphore_t patch_lock_buffer;
+
+static void build_curves(void)
+{
+    for (int v = 0; v < 256; v++)
+    {
+        patch_luts[PATCH_CURVE_LINEAR][v] = v;
+        patch_luts[PATCH_CURVE_GAMMA][v] = (uint8_t)(powf(v / 255.0f, PATCH_GAMMA) * 255.0f + 0.5f);
+        patch_luts[PATCH_CURVE_SQUARE][v] = (v * v + 127) / 255;
+    }
+    for (int curve = PATCH_CURVE_USER; curve < PATCH_CURVES; curve++)
+    {
+        memcpy(patch_luts[curve], patch_luts[PATCH_CURVE_LINEAR], 256);
+    }
+}
+
+// Length and whether the table differs from a plain copy, after an edit
+static void update(patch_t *patch)
+{
+    size_t high = 0;
+    bool identity = true;
+    for (size_t slot = 1; slot <= 512; slot++)
+    {
+        uint16_t entry = patch->map[slot];
+        if (entry != 0)
+        {
+            high = slot;
+        }
+        if (entry != PATCH_ENTRY(slot, PATCH_CURVE_LINEAR))
+        {
+            identity = false;
+        }
+    }
+    patch->len = high + 1;
+    patch->active = !identity;
+}
+
+void patch_init(void)
+{
+    patch_lock = xSemaphoreCreateMutexStatic(&patch_lock_buffer);
+    build_curves();
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        patch_reset(output);
+    }
+}
+
+void patch_reset(uint8_t output)
+{
+    patch_t *patch = &patches[output];
+    xSemaphoreTake(patch_lock, portMAX_DELAY);
+    memset(patch->map, 0, sizeof(patch->map));
+    for (uint16_t slot = 1 + CONFIG_DMX_PATCH_OFFSET; slot <= 512; slot++)
+    {
+        patch->map[slot] = PATCH_ENTRY(slot - CONFIG_DMX_PATCH_OFFSET, CONFIG_DMX_PATCH_CURVE);
+    }
+    update(patch);
+    xSemaphoreGive(patch_lock);
+}
+
+bool patch_map(uint8_t output, uint16_t out_first, uint16_t src_first, uint16_t count,
+        uint8_t curve)
+{
+    if (output >= DMX_OUTPUT_COUNT || curve >= PATCH_CURVES || out_first < 1 || src_first < 1 ||
+            out_first + count > 513 || src_first + count > 513)
+    {
+        ESP_LOGW(TAG, "Output %d: cannot patch %d channels from %d to %d", output, count,
+                src_first, out_first);
+        return false;
+    }
+    patch_t *patch = &patches[output];
+    xSemaphoreTake(patch_lock, portMAX_DELAY);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        patch->map[out_first + i] = PATCH_ENTRY(src_first + i, curve);
+    }
+    update(patch);
+    xSemaphoreGive(patch_lock);
+    return true;
+}
+
+void patch_unmap(uint8_t output, uint16_t out_first, uint16_t count)
+{
+    if (output >= DMX_OUTPUT_COUNT || out_first < 1 || out_first + count > 513)
+    {
+        return;
+    }
+    patch_t *patch = &patches[output];
+    xSemaphoreTake(patch_lock, portMAX_DELAY);
+    // Entry 0 reads the start code, always 0, through the linear curve
+    memset(&patch->map[out_first], 0, count * sizeof(patch->map[0]));
+    update(patch);
+    xSemaphoreGive(patch_lock);
+}
+
+bool patch_set_curve(uint8_t curve, const uint8_t lut[256])
+{
+    if (curve < PATCH_CURVE_USER || curve >= PATCH_CURVES)
+    {
+        return false;
+    }
+    xSemaphoreTake(patch_lock, portMAX_DELAY);
+    memcpy(patch_luts[curve], lut, 256);
+    xSemaphoreGive(patch_lock);
+    return true;
+}
+
+void patch_curve_limit(uint8_t lut[256], uint8_t limit)
+{
+    for (int v = 0; v < 256; v++)
+    {
+        lut[v] = (v * limit + 127) / 255;
+    }
+}
+
+bool patch_active(uint8_t output)
+{
+    return patches[output].active;
+}
+
+size_t patch_gather(uint8_t output, uint8_t *restrict dst, const uint8_t *restrict src,
+        size_t src_len)
+{
+    const patch_t *patch = &patches[output];
+    const uint8_t *luts = patch_luts[0];
+    xSemaphoreTake(patch_lock, portMAX_DELAY);
+    // The frame ends with the last slot showing a channel the source sent,
+    // unmapped slots read the start code and do not count. Only short
+    // frames look further than the last slot.
+    size_t len = patch->len;
+    while (len > 1)
+    {
+        size_t channel = patch->map[len - 1] & PATCH_CHANNEL_MASK;
+        if (channel != 0 && channel < src_len)
+        {
+            break;
+        }
+        len--;
+    }
+    dst[0] = 0x00;
+    for (size_t slot = 1; slot < len; slot++)
+    {
+        uint16_t entry = patch->map[slot];
+        dst[slot] = luts[(entry >> PATCH_CHANNEL_BITS) << 8 | src[entry & PATCH_CHANNEL_MASK]];
+    }
+    xSemaphoreGive(patch_lock);
+    return len;
+}
+
+void patch_gather_owner(uint8_t output, uint8_t *restrict dst, const uint8_t *restrict owner)
+{
+    const patch_t *patch = &patches[output];
+    xSemaphoreTake(patch_lock, portMAX_DELAY);
+    size_t len = patch->len;
+    // Unmapped slots read slot 0, which nobody owns
+    dst[0] = 0x00;
+    for (size_t slot = 1; slot < len; slot++)
+    {
+        dst[slot] = owner[patch->map[slot] & PATCH_CHANNEL_MASK];
+    }
+    memset(&dst[len], 0, 513 - len);
+    xSemaphoreGive(patch_lock);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Soft patch between the channels received for an output and the slots it
+// transmits. Every output slot names the received channel it shows and the
+// response curve it goes through, so remapping, start address offsets and
+// gamma, dimmer law or level limits are all one table lookup per slot. The
+// patch is applied when a source is committed, by a single gather-and-LUT
+// pass that replaces the plain copy into the output's triple buffer, and
+// costs nothing while an output is patched one to one and linear.
+//
+// It applies to every source of the output alike, merging sees patched
+// frames. LTP ownership is tracked on received channel numbers and goes
+// through the patch too (patch_gather_owner), a slot belongs to whichever
+// source last changed the channel it shows.
+
+// Response curves, a 256 byte LUT each
+#define PATCH_CURVES 8
+
+typedef enum {
+    PATCH_CURVE_LINEAR,
+    PATCH_CURVE_GAMMA,      // 2.2, perceptually even LED dimming
+    PATCH_CURVE_SQUARE,     // square law dimmer
+    PATCH_CURVE_USER,       // first slot for patch_set_curve
+} patch_curve_t;
+
+void patch_init(void);
+
+// One to one and linear, plus the CONFIG_DMX_PATCH_OFFSET and
+// CONFIG_DMX_PATCH_CURVE defaults
+void patch_reset(uint8_t output);
+
+// Output slots out_first.. (1-512) show received channels src_first..
+// through curve. False if either range runs past 512.
+bool patch_map(uint8_t output, uint16_t out_first, uint16_t src_first, uint16_t count,
+        uint8_t curve);
+
+// Output slots out_first.. carry nothing and stay at 0
+void patch_unmap(uint8_t output, uint16_t out_first, uint16_t count);
+
+// Fills a user curve slot, outputs already patched through it follow
+bool patch_set_curve(uint8_t curve, const uint8_t lut[256]);
+
+// Linear response scaled down to top out at limit
+void patch_curve_limit(uint8_t lut[256], uint8_t limit);
+
+// Whether commits of the output go through patch_gather
+bool patch_active(uint8_t output);
+
+// dst[slot] = curve[slot](src[channel[slot]]) for every output slot, start
+// code 0, from a source frame src_len long (start code included) that is
+// 0 past its end, as the work buffers are. Returns the frame length
+// written, up to the last slot showing a channel the source sent, so a
+// short frame stays short.
+size_t patch_gather(uint8_t output, uint8_t *restrict dst, const uint8_t *restrict src,
+        size_t src_len);
+
+// dst[slot] = owner[channel[slot]], LTP ownership of the output's slots from
+// that of the received channels
+void patch_gather_owner(uint8_t output, uint8_t *restrict dst, const uint8_t *restrict owner);
@@ -0,0 +1,63 @@
+#include <string.h>
+
+#include "pixel.h"
+
+// In RAM rather than flash, the encoder reads all of it for every frame
+static pixel_item_t pixel_lut[256][8];
+
+void pixel_init(void)
+{
+    for (int value = 0; value < 256; value++)
+    {
+        // Most significant bit first
+        for (int bit = 0; bit < 8; bit++)
+        {
+            pixel_lut[value][bit] = value & (0x80 >> bit) ?
+                PIXEL_ITEM(PIXEL_T1H, PIXEL_T1L) : PIXEL_ITEM(PIXEL_T0H, PIXEL_T0L);
+        }
+    }
+}
+
+size_t pixel_encode(pixel_item_t *items, const uint8_t *rgb, size_t count)
+{
+    pixel_item_t *out = items;
+    for (size_t i = 0; i < count; i++, rgb += 3, out += PIXEL_ITEMS_PER_PIXEL)
+    {
+        memcpy(&out[0], pixel_lut[rgb[1]], sizeof(pixel_lut[0]));
+        memcpy(&out[8], pixel_lut[rgb[0]], sizeof(pixel_lut[0]));
+        memcpy(&out[16], pixel_lut[rgb[2]], sizeof(pixel_lut[0]));
+    }
+    return out - items;
+}
+
+size_t pixel_encode_strip(pixel_item_t *items, size_t pixels, const uint8_t *const *slots,
+        const size_t *counts)
+{
+    static const uint8_t dark[3] = { 0 };
+    pixel_item_t *out = items;
+    for (size_t universe = 0; pixels > 0; universe++)
+    {
+        size_t wanted = pixels < PIXEL_PER_UNIVERSE ? pixels : PIXEL_PER_UNIVERSE;
+        size_t whole = counts[universe] / 3;
+        if (whole > wanted)
+        {
+            whole = wanted;
+        }
+        out += pixel_encode(out, slots[universe], whole);
+
+        // A pixel the frame ends inside of keeps the slots it has
+        if (whole < wanted && counts[universe] % 3 != 0)
+        {
+            uint8_t partial[3] = { 0 };
+            memcpy(partial, &slots[universe][whole * 3], counts[universe] % 3);
+            out += pixel_encode(out, partial, 1);
+            whole++;
+        }
+        for (; whole < wanted; whole++)
+        {
+            out += pixel_encode(out, dark, 1);
+        }
+        pixels -= wanted;
+    }
+    return out - items;
+}
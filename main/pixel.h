@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// WS2812 encoding for the RMT peripheral. Each universe carries 170 RGB
+// pixels in its first 510 slots, and a strip longer than that takes the
+// following universes. Every data bit is one RMT item, a high time then a
+// low time, in the layout of the driver's rmt_item32_t. A table holding
+// the 8 items of every byte value turns slots into items with one copy per
+// byte, so a strip is encoded in a single pass over its universes.
+//
+// No I/O here, pixeltask.c owns the RMT channel.
+
+// Items are counted in 25 ns ticks, the 80 MHz APB clock divided by 2
+#define PIXEL_RMT_CLK_DIV       2
+#define PIXEL_T0H               16      // 0.40 us
+#define PIXEL_T0L               34      // 0.85 us
+#define PIXEL_T1H               32      // 0.80 us
+#define PIXEL_T1L               18      // 0.45 us
+#define PIXEL_ITEM(high, low)   ((uint32_t)(high) | 1u << 15 | (uint32_t)(low) << 16)
+#define PIXEL_ITEM_NS           1250
+
+// The strip latches after the line has been low this long, 280 us for the
+// WS2812B. Ends every frame as one item low in both halves, so the next
+// frame can never follow too soon, whatever the refresh rate.
+#define PIXEL_RESET_US          280
+#define PIXEL_RESET_HALF        (PIXEL_RESET_US * 1000 / 25 / 2)
+#define PIXEL_ITEM_RESET        ((uint32_t)PIXEL_RESET_HALF | (uint32_t)PIXEL_RESET_HALF << 16)
+
+#define PIXEL_PER_UNIVERSE      170
+#define PIXEL_ITEMS_PER_PIXEL   24
+#define PIXEL_ITEMS(pixels)     ((pixels) * PIXEL_ITEMS_PER_PIXEL)
+// With the reset item
+#define PIXEL_FRAME_ITEMS(pixels) (PIXEL_ITEMS(pixels) + 1)
+#define PIXEL_UNIVERSES(pixels) (((pixels) + PIXEL_PER_UNIVERSE - 1) / PIXEL_PER_UNIVERSE)
+
+typedef uint32_t pixel_item_t;
+
+// Builds the byte to item table, before anything is encoded
+void pixel_init(void);
+
+// Encodes count pixels given as RGB slots into items, in the GRB order the
+// strip shifts in. Returns the number of items written.
+size_t pixel_encode(pixel_item_t *items, const uint8_t *rgb, size_t count);
+
+// Encodes a strip of pixels from the slots of its universes, slots[u]
+// being counts[u] long (no start code). Pixels a short frame does not
+// reach are sent dark. Returns the number of items written.
+size_t pixel_encode_strip(pixel_item_t *items, size_t pixels, const uint8_t *const *slots,
+        const size_t *counts);
@@ -0,0 +1,99 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "driver/rmt.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "pixel.h"
+#include "pixeltask.h"
+
+// Built either way, the pixel options only exist with CONFIG_PIXEL_ENABLE
+#if CONFIG_PIXEL_ENABLE
+
+#define PIXEL_COUNT         CONFIG_LED_STRIP_LENGTH
+#define PIXEL_OUTPUTS       PIXEL_UNIVERSES(PIXEL_COUNT)
+#define PIXEL_RMT_CHANNEL   RMT_CHANNEL_0
+// Two blocks of RMT RAM, so the refill interrupt can come late by 64 bits
+// before the strip sees a gap and latches early
+#define PIXEL_RMT_BLOCKS    2
+
+#if CONFIG_PIXEL_FIRST_OUTPUT + PIXEL_OUTPUTS > CONFIG_DMX_OUTPUT_COUNT
+#error "LED_STRIP_LENGTH needs more DMX outputs than DMX_OUTPUT_COUNT from PIXEL_FIRST_OUTPUT on"
+#endif
+#if CONFIG_PIXEL_FIRST_OUTPUT < DMX_PORT_COUNT
+#error "PIXEL_FIRST_OUTPUT is sent by a DMX port"
+#endif
+
+static const char *TAG = "pixel";
+
+// The driver sends from these in place, one is encoded while the other
+// goes out
+static pixel_item_t pixel_items[2][PIXEL_FRAME_ITEMS(PIXEL_COUNT)];
+
+static void pixel_worker(void *pvParameters)
+{
+    TickType_t period = pdMS_TO_TICKS(1000 / CONFIG_PIXEL_REFRESH_HZ);
+    if (period == 0)
+    {
+        period = 1;
+    }
+    TickType_t wake = xTaskGetTickCount();
+    uint8_t back = 0;
+    const uint8_t *slots[PIXEL_OUTPUTS];
+    size_t counts[PIXEL_OUTPUTS];
+
+    while (1)
+    {
+        vTaskDelayUntil(&wake, period);
+        for (int i = 0; i < PIXEL_OUTPUTS; i++)
+        {
+            size_t len;
+            const uint8_t *frame = dmx_buffer_latch(CONFIG_PIXEL_FIRST_OUTPUT + i, &len);
+            slots[i] = &frame[1];
+            counts[i] = len > 0 ? len - 1 : 0;
+        }
+        size_t items = pixel_encode_strip(pixel_items[back], PIXEL_COUNT, slots, counts);
+        pixel_items[back][items++] = PIXEL_ITEM_RESET;
+
+        // The previous frame and its reset are long done at any sensible
+        // refresh rate, the wait only matters for strips too long for it
+        rmt_wait_tx_done(PIXEL_RMT_CHANNEL, portMAX_DELAY);
+        ESP_ERROR_CHECK(rmt_write_items(PIXEL_RMT_CHANNEL, (const rmt_item32_t *)pixel_items[back],
+                items, false));
+        back ^= 1;
+    }
+}
+
+#define STACK_SIZE 2048
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+
+void pixel_task_start(void)
+{
+    _Static_assert(sizeof(pixel_item_t) == sizeof(rmt_item32_t), "RMT item layout");
+    pixel_init();
+
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX(CONFIG_LED_PIN, PIXEL_RMT_CHANNEL);
+    config.clk_div = PIXEL_RMT_CLK_DIV;
+    config.mem_block_num = PIXEL_RMT_BLOCKS;
+    ESP_ERROR_CHECK(rmt_config(&config));
+    ESP_ERROR_CHECK(rmt_driver_install(PIXEL_RMT_CHANNEL, 0, 0));
+
+    xTaskCreateStatic(
+            pixel_worker,
+            "pixel",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY + 1,
+            xStack,
+            &xTaskBuffer
+            );
+    ESP_LOGI(TAG, "%d pixels on GPIO %d from outputs %d-%d at %d Hz", PIXEL_COUNT, CONFIG_LED_PIN,
+            CONFIG_PIXEL_FIRST_OUTPUT, CONFIG_PIXEL_FIRST_OUTPUT + PIXEL_OUTPUTS - 1,
+            CONFIG_PIXEL_REFRESH_HZ);
+}
+#endif
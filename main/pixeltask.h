@@ -0,0 +1,11 @@
+#pragma once
+
+// With CONFIG_PIXEL_ENABLE, drives a WS2812 strip of CONFIG_LED_STRIP_LENGTH
+// pixels on CONFIG_LED_PIN from the outputs starting at
+// CONFIG_PIXEL_FIRST_OUTPUT, 170 pixels to an output (see pixel.h). Those
+// outputs are latched by this task instead of a DMX line, so merging,
+// fades and the patch apply to the pixels as they do to DMX.
+//
+// The strip is encoded into one item buffer while the RMT sends the other,
+// straight from RAM, at CONFIG_PIXEL_REFRESH_HZ.
+void pixel_task_start(void);
@@ -0,0 +1,280 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "playout.h"
+
+#if CONFIG_DMX_PLAYOUT
+
+// Arrivals the frame interval is first measured over, after that it is
+// only trimmed by the schedule error
+#define PLAYOUT_WARMUP 64
+// Silence after which the schedule starts over, and after which another
+// stream can take the output
+#define PLAYOUT_RESYNC_US 1000000
+// Loop gains as shifts: the schedule moves by 1/16 of its error per frame,
+// the interval by 1/1024, and the peak slack decays by 1/64 per frame
+#define PLAYOUT_PHASE_SHIFT 4
+#define PLAYOUT_RATE_SHIFT  10
+#define PLAYOUT_PEAK_SHIFT  6
+
+typedef struct {
+    playout_frame_t ring[PLAYOUT_DEPTH];
+    uint8_t head;
+    uint8_t count;
+
+    atomic_uint delay_us;
+    atomic_bool restart;        // set_delay asked for the queue to be dropped
+    uint32_t key;
+    bool following;
+
+    uint32_t last_arrival_us;
+    uint32_t due_us;            // slot of the newest frame
+    int32_t interval_us;        // sender frame interval estimate
+    uint32_t start_us;          // first arrival since the resync
+    uint32_t frames;            // arrivals since then
+    int32_t peak_slack;         // how early the least delayed frames arrive
+
+    playout_stats_t stats;
+} playout_state_t;
+
+static const char *TAG = "playout";
+
+static playout_state_t playout_state[DMX_OUTPUT_COUNT];
+
+void playout_init(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        memset(&playout_state[output], 0, sizeof(playout_state[output]));
+        atomic_init(&playout_state[output].delay_us, CONFIG_DMX_PLAYOUT_MS * 1000);
+        atomic_init(&playout_state[output].restart, false);
+    }
+}
+
+void playout_set_delay(uint8_t output, uint32_t delay_ms)
+{
+    playout_state_t *play = &playout_state[output];
+    atomic_store(&play->delay_us, delay_ms * 1000);
+    atomic_store(&play->restart, true);
+    ESP_LOGI(TAG, "Output %d playout delay %d ms", output, delay_ms);
+}
+
+// Network task side of playout_set_delay
+static void take_restart(playout_state_t *play)
+{
+    if (atomic_exchange(&play->restart, false))
+    {
+        play->count = 0;
+        play->following = false;
+        play->stats.depth = 0;
+    }
+}
+
+bool playout_enabled(uint8_t output)
+{
+    return atomic_load_explicit(&playout_state[output].delay_us, memory_order_relaxed) != 0;
+}
+
+bool playout_any_enabled(void)
+{
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        if (playout_enabled(output))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Slack is how long before its slot a frame arrives. The least delayed
+// frames should arrive exactly the target delay early, so the peak slack
+// is steered there, a little per frame so the output rate only bends
+// gradually. Whatever error remains trims the interval estimate, which
+// tracks a sender clock running fast or slow.
+static uint32_t schedule(playout_state_t *play, uint32_t now_us)
+{
+    play->frames++;
+    if (play->frames <= PLAYOUT_WARMUP)
+    {
+        play->interval_us = (now_us - play->start_us) / play->frames;
+    }
+    play->due_us += play->interval_us;
+
+    int32_t slack = (int32_t)(play->due_us - now_us);
+    if (slack < 0)
+    {
+        // Too late for its slot, the schedule moves back to make room
+        play->stats.late++;
+        play->due_us = now_us;
+        slack = 0;
+    }
+    if (slack > play->peak_slack)
+    {
+        play->peak_slack = slack;
+    }
+    else
+    {
+        play->peak_slack += (slack - play->peak_slack) >> PLAYOUT_PEAK_SHIFT;
+    }
+
+    int32_t error = (int32_t)atomic_load_explicit(&play->delay_us, memory_order_relaxed) -
+        play->peak_slack;
+    play->due_us += error >> PLAYOUT_PHASE_SHIFT;
+    play->peak_slack += error >> PLAYOUT_PHASE_SHIFT;
+    if (play->frames > PLAYOUT_WARMUP)
+    {
+        play->interval_us += error >> PLAYOUT_RATE_SHIFT;
+    }
+    return play->due_us;
+}
+
+bool playout_push(uint8_t output, uint32_t key, const uint8_t *slots, size_t count,
+        uint32_t rx_us, uint32_t now_us)
+{
+    playout_state_t *play = &playout_state[output];
+    take_restart(play);
+    bool idle = now_us - play->last_arrival_us > PLAYOUT_RESYNC_US;
+
+    if (play->following && key != play->key && !idle)
+    {
+        return false;
+    }
+
+    uint32_t due_us;
+    if (!play->following || key != play->key || idle)
+    {
+        uint32_t delay_us = atomic_load_explicit(&play->delay_us, memory_order_relaxed);
+        play->following = true;
+        play->key = key;
+        play->interval_us = 0;
+        play->due_us = now_us + delay_us;
+        play->start_us = now_us;
+        play->frames = 0;
+        play->peak_slack = delay_us;
+        play->stats.resyncs++;
+        due_us = play->due_us;
+    }
+    else
+    {
+        due_us = schedule(play, now_us);
+    }
+    play->last_arrival_us = now_us;
+    play->stats.interval_us = play->interval_us;
+
+    if (play->count == PLAYOUT_DEPTH)
+    {
+        play->head = (play->head + 1) % PLAYOUT_DEPTH;
+        play->count--;
+        play->stats.overflows++;
+    }
+    playout_frame_t *frame = &play->ring[(play->head + play->count) % PLAYOUT_DEPTH];
+    play->count++;
+
+    frame->key = key;
+    frame->rx_us = rx_us;
+    frame->ingest_us = now_us;
+    frame->due_us = due_us;
+    frame->count = count;
+    memcpy(frame->slots, slots, count);
+
+    play->stats.frames++;
+    play->stats.depth = play->count;
+    if (play->count > play->stats.max_depth)
+    {
+        play->stats.max_depth = play->count;
+    }
+    return true;
+}
+
+const playout_frame_t *playout_pop(uint8_t output, uint32_t now_us)
+{
+    playout_state_t *play = &playout_state[output];
+    take_restart(play);
+    if (play->count == 0)
+    {
+        return NULL;
+    }
+    const playout_frame_t *frame = &play->ring[play->head];
+    if ((int32_t)(now_us - frame->due_us) < 0)
+    {
+        return NULL;
+    }
+    play->head = (play->head + 1) % PLAYOUT_DEPTH;
+    play->count--;
+    play->stats.depth = play->count;
+    return frame;
+}
+
+uint32_t playout_next_due(uint32_t now_us)
+{
+    uint32_t wait_us = UINT32_MAX;
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        playout_state_t *play = &playout_state[output];
+        take_restart(play);
+        if (play->count == 0)
+        {
+            continue;
+        }
+        int32_t remaining = (int32_t)(play->ring[play->head].due_us - now_us);
+        if (remaining <= 0)
+        {
+            return 0;
+        }
+        if ((uint32_t)remaining < wait_us)
+        {
+            wait_us = remaining;
+        }
+    }
+    return wait_us;
+}
+
+void playout_get_stats(uint8_t output, playout_stats_t *stats)
+{
+    *stats = playout_state[output].stats;
+}
+
+#else
+
+void playout_init(void)
+{
+}
+
+bool playout_enabled(uint8_t output)
+{
+    return false;
+}
+
+bool playout_any_enabled(void)
+{
+    return false;
+}
+
+bool playout_push(uint8_t output, uint32_t key, const uint8_t *slots, size_t count,
+        uint32_t rx_us, uint32_t now_us)
+{
+    return false;
+}
+
+const playout_frame_t *playout_pop(uint8_t output, uint32_t now_us)
+{
+    return NULL;
+}
+
+uint32_t playout_next_due(uint32_t now_us)
+{
+    return UINT32_MAX;
+}
+
+void playout_get_stats(uint8_t output, playout_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+// Jitter buffer between the network and the outputs. Wi-Fi delivers frames
+// in clumps, 80 ms of nothing and then four at once, which applied on
+// arrival make the output stutter. Instead each output queues the frames of
+// the stream it follows and releases them on a schedule paced at the
+// sender's estimated frame rate, a target delay behind the least delayed
+// arrivals. Frames arriving after their slot are released at once and
+// counted as late.
+//
+// Only one stream per output is buffered, a second source merging into it
+// is applied as it arrives. Times are on the latency_now_us() clock.
+//
+// Without CONFIG_DMX_PLAYOUT none of it is built, no output is ever
+// enabled and every frame is applied as it arrives.
+
+#if CONFIG_DMX_PLAYOUT
+// Frames held per output before the oldest is dropped
+#define PLAYOUT_DEPTH CONFIG_DMX_PLAYOUT_DEPTH
+#endif
+
+typedef struct {
+    uint32_t key;           // merge source key, see merge.h
+    uint32_t rx_us;         // datagram read
+    uint32_t ingest_us;     // parsed and queued
+    uint32_t due_us;
+    uint16_t count;
+    uint8_t slots[512];
+} playout_frame_t;
+
+typedef struct {
+    uint32_t frames;        // queued
+    uint32_t late;          // arrived after their playout slot
+    uint32_t overflows;     // dropped from a full queue
+    uint32_t resyncs;       // schedule restarted after a pause or new stream
+    uint32_t depth;         // frames queued now
+    uint32_t max_depth;
+    uint32_t interval_us;   // estimated sender frame interval
+} playout_stats_t;
+
+void playout_init(void);
+
+#if CONFIG_DMX_PLAYOUT
+// Target delay, 0 turns buffering off. From any task, the queue is dropped
+// by the network task on its next push or pop.
+void playout_set_delay(uint8_t output, uint32_t delay_ms);
+#endif
+
+bool playout_enabled(uint8_t output);
+
+// True when any output buffers, every frame of a burst is then needed
+bool playout_any_enabled(void);
+
+// Queues a frame received at now_us. Returns false when the output follows
+// another stream and the frame should be applied right away.
+bool playout_push(uint8_t output, uint32_t key, const uint8_t *slots, size_t count,
+        uint32_t rx_us, uint32_t now_us);
+
+// Oldest queued frame when it is due at now_us, otherwise NULL. Valid until
+// the next push to the output.
+const playout_frame_t *playout_pop(uint8_t output, uint32_t now_us);
+
+// Microseconds until the next queued frame of any output is due, UINT32_MAX
+// when nothing is queued
+uint32_t playout_next_due(uint32_t now_us);
+
+void playout_get_stats(uint8_t output, playout_stats_t *stats);
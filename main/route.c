@@ -0,0 +1,95 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "route.h"
+
+#define ROUTE_NET_COUNT  128    // upper 7 bits of the Port-Address
+#define ROUTE_PAGE_SIZE  256    // subnet:universe, lower 8 bits
+
+// Distinct nets that can be routed at the same time
+#define ROUTE_PAGE_COUNT 4
+
+static const char *TAG = "route";
+
+static uint8_t *route_pages[ROUTE_NET_COUNT] = { NULL };
+static uint8_t route_page_pool[ROUTE_PAGE_COUNT][ROUTE_PAGE_SIZE];
+static size_t route_pages_used = 0;
+
+void route_init(void)
+{
+    route_clear();
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+#if CONFIG_DMX_INPUT
+        // Output 0 is the DMX input, its universe goes the other way
+        if (output == 0)
+        {
+            continue;
+        }
+#endif
+        if (!route_add(CONFIG_ARTNET_UNIVERSE + output, output))
+        {
+            ESP_LOGE(TAG, "Unable to route universe %d to output %d",
+                    CONFIG_ARTNET_UNIVERSE + output, output);
+        }
+    }
+}
+
+bool route_add(uint16_t port_address, uint8_t output)
+{
+    if (output >= DMX_OUTPUT_COUNT)
+    {
+        return false;
+    }
+    port_address &= ROUTE_PORT_ADDRESS_MASK;
+
+    uint8_t *page = route_pages[port_address >> 8];
+    if (page == NULL)
+    {
+        if (route_pages_used == ROUTE_PAGE_COUNT)
+        {
+            ESP_LOGW(TAG, "No free route page for net %d", port_address >> 8);
+            return false;
+        }
+        page = route_page_pool[route_pages_used++];
+        memset(page, 0, ROUTE_PAGE_SIZE);
+        route_pages[port_address >> 8] = page;
+    }
+    page[port_address & 0xff] |= 1 << output;
+    return true;
+}
+
+void route_remove(uint16_t port_address, uint8_t output)
+{
+    port_address &= ROUTE_PORT_ADDRESS_MASK;
+
+    // Pages stay allocated, the lookup may be running concurrently
+    uint8_t *page = route_pages[port_address >> 8];
+    if (page != NULL && output < DMX_OUTPUT_COUNT)
+    {
+        page[port_address & 0xff] &= ~(1 << output);
+    }
+}
+
+void route_clear(void)
+{
+    for (size_t net = 0; net < ROUTE_NET_COUNT; net++)
+    {
+        route_pages[net] = NULL;
+    }
+    for (size_t i = 0; i < route_pages_used; i++)
+    {
+        memset(route_page_pool[i], 0, ROUTE_PAGE_SIZE);
+    }
+    route_pages_used = 0;
+}
+
+uint8_t route_lookup(uint16_t port_address)
+{
+    const uint8_t *page = route_pages[(port_address & ROUTE_PORT_ADDRESS_MASK) >> 8];
+    return page == NULL ? 0 : page[port_address & 0xff];
+}
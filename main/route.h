@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maps 15-bit Art-Net Port-Addresses (net:subnet:universe) to a bitmask of
+// local DMX outputs. The table is two-level: one pointer per net, pointing
+// at a 256 entry page of output masks, so a lookup is two loads and nets
+// without any route cost no memory.
+
+#define ROUTE_PORT_ADDRESS_MASK 0x7fff
+
+// Installs the default routes, output n listens to CONFIG_ARTNET_UNIVERSE + n,
+// except output 0 with CONFIG_DMX_INPUT
+void route_init(void);
+
+// Returns false if the page pool is exhausted or the output does not exist
+bool route_add(uint16_t port_address, uint8_t output);
+
+void route_remove(uint16_t port_address, uint8_t output);
+
+void route_clear(void);
+
+// Bitmask of outputs subscribed to port_address, 0 if nobody listens
+uint8_t route_lookup(uint16_t port_address);
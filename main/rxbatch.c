@@ -0,0 +1,229 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "artnet.h"
+#include "ingest.h"
+#include "latency.h"
+#include "playout.h"
+#include "rxbatch.h"
+#include "sacn.h"
+#include "trace.h"
+
+// Marks a slot that is not DMX data and must not be coalesced
+#define KEY_BARRIER 0
+
+// Datagrams read into our own memory, one slot each. Zero-copy receive
+// only copies datagrams lwIP chained over several buffers, one is plenty.
+#if CONFIG_ARTNET_ZERO_COPY
+#define RXBATCH_COPIES 1
+#else
+#define RXBATCH_COPIES RXBATCH_SLOTS
+#endif
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    void (*release)(void *ref);
+    void *ref;
+    uint64_t key;
+    uint32_t source_ip;
+    uint32_t rx_us;
+    uint8_t seq;
+    rxbatch_proto_t proto;
+    bool live;
+} rxbatch_slot_t;
+
+static const char *TAG = "rxbatch";
+
+// Only used by the network task
+static rxbatch_slot_t rx_slots[RXBATCH_SLOTS];
+static size_t rx_used = 0;
+static uint8_t rx_copies[RXBATCH_COPIES][RXBATCH_SLOT_LEN];
+static size_t rx_copies_used = 0;
+// First slot after the last barrier, frames before it are never replaced
+static size_t rx_barrier = 0;
+static uint32_t batch_datagrams = 0;
+static rxbatch_stats_t stats;
+
+// Sender, protocol and universe of DMX data, never KEY_BARRIER. Sets the
+// slot's sequence.
+static uint64_t dmx_key(rxbatch_slot_t *slot)
+{
+    uint16_t universe;
+    bool dmx = slot->proto == RXBATCH_SACN
+        ? sacn_data_universe(slot->data, slot->len, &universe, &slot->seq)
+        : artnet_dmx_universe(slot->data, slot->len, &universe, &slot->seq);
+    if (!dmx)
+    {
+        return KEY_BARRIER;
+    }
+    return 1ull << 63 | (uint64_t)slot->proto << 48 | (uint64_t)universe << 32 | slot->source_ip;
+}
+
+static void flush(void)
+{
+    for (size_t i = 0; i < rx_used; i++)
+    {
+        rxbatch_slot_t *slot = &rx_slots[i];
+        if (!slot->live)
+        {
+            continue;
+        }
+        ingest_set_rx_time(slot->rx_us);
+        if (slot->proto == RXBATCH_SACN)
+        {
+            handle_sacn(slot->data, slot->len);
+        }
+        else
+        {
+            handle_artnet(slot->data, slot->len, slot->source_ip);
+        }
+    }
+    ingest_set_rx_time(0);
+
+    // Coalesced datagrams included, their buffers go back too
+    for (size_t i = 0; i < rx_used; i++)
+    {
+        if (rx_slots[i].release != NULL)
+        {
+            rx_slots[i].release(rx_slots[i].ref);
+        }
+    }
+    rx_used = 0;
+    rx_copies_used = 0;
+    rx_barrier = 0;
+}
+
+void rxbatch_begin(void)
+{
+    batch_datagrams = 0;
+    ingest_batch_begin();
+}
+
+uint8_t *rxbatch_slot(void)
+{
+    if (rx_used == RXBATCH_SLOTS || rx_copies_used == RXBATCH_COPIES)
+    {
+        flush();
+    }
+    return rx_copies[rx_copies_used];
+}
+
+// Whether the frame in slot is newer than the one in older by the
+// protocol's sequence rules, rather than just later to arrive
+static bool follows(const rxbatch_slot_t *slot, const rxbatch_slot_t *older)
+{
+    return slot->proto == RXBATCH_SACN
+        ? sacn_seq_follows(slot->seq, older->seq)
+        : artnet_seq_follows(slot->seq, older->seq);
+}
+
+// False when the datagram was dropped rather than queued
+static bool push(rxbatch_proto_t proto, const uint8_t *data, size_t len, uint32_t source_ip,
+        void (*release)(void *), void *ref)
+{
+    batch_datagrams++;
+    // Never output, and would take the place of the live data it shares
+    // a key with
+    if (proto == RXBATCH_SACN && sacn_data_ignored(data, len))
+    {
+        if (release != NULL)
+        {
+            release(ref);
+        }
+        return false;
+    }
+
+    rxbatch_slot_t *slot = &rx_slots[rx_used];
+    slot->data = data;
+    slot->len = len;
+    slot->release = release;
+    slot->ref = ref;
+    slot->proto = proto;
+    slot->source_ip = source_ip;
+    slot->rx_us = latency_now_us();
+    slot->live = true;
+    slot->key = dmx_key(slot);
+
+    if (slot->key == KEY_BARRIER)
+    {
+        rx_barrier = rx_used + 1;
+    }
+    else if (!playout_any_enabled())
+    {
+        // The jitter buffer paces out every frame of a burst itself, so
+        // nothing is coalesced while it is on
+        for (size_t i = rx_barrier; i < rx_used; i++)
+        {
+            if (rx_slots[i].live && rx_slots[i].key == slot->key)
+            {
+                // A frame overtaken on the way is dropped, not the newer
+                // one it arrived after
+                rxbatch_slot_t *kept = slot;
+                rxbatch_slot_t *dropped = &rx_slots[i];
+                if (!follows(slot, &rx_slots[i]))
+                {
+                    kept = &rx_slots[i];
+                    dropped = slot;
+                }
+                dropped->live = false;
+                stats.coalesced++;
+                // Dropped here rather than lost on the way. A duplicate
+                // leaves no gap to fill.
+                if (slot->proto == RXBATCH_ARTNET && dropped->seq != kept->seq &&
+                        dropped->seq != 0 && kept->seq != 0)
+                {
+                    artnet_seq_coalesced((uint16_t)(slot->key >> 32), slot->source_ip);
+                }
+                break;
+            }
+        }
+    }
+    rx_used++;
+    return true;
+}
+
+void rxbatch_push(rxbatch_proto_t proto, size_t len, uint32_t source_ip)
+{
+    if (push(proto, rx_copies[rx_copies_used], len, source_ip, NULL, NULL))
+    {
+        rx_copies_used++;
+    }
+}
+
+void rxbatch_push_ref(rxbatch_proto_t proto, const uint8_t *data, size_t len,
+        uint32_t source_ip, void (*release)(void *ref), void *ref)
+{
+    if (rx_used == RXBATCH_SLOTS)
+    {
+        flush();
+    }
+    push(proto, data, len, source_ip, release, ref);
+}
+
+void rxbatch_end(void)
+{
+    flush();
+    ingest_batch_end();
+
+    stats.datagrams += batch_datagrams;
+    stats.batches++;
+    if (batch_datagrams > stats.largest_batch)
+    {
+        stats.largest_batch = batch_datagrams;
+    }
+    if (batch_datagrams > 1)
+    {
+        trace_event(TRACE_RX_BATCH, batch_datagrams, stats.coalesced);
+        ESP_LOGD(TAG, "Batch of %d datagrams, %d coalesced so far",
+                batch_datagrams, stats.coalesced);
+    }
+}
+
+void rxbatch_get_stats(rxbatch_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Batches the datagrams drained from the sockets in one go. Within a batch
+// only the newest DMX frame per sender and universe is handed on, by
+// sequence number rather than arrival, older ones are dropped unprocessed,
+// and outputs are committed once at the end. sACN preview data and
+// alternate start codes are dropped before they are queued.
+// Any other packet (ArtSync, ArtPoll) is a barrier frames are not
+// coalesced across, so ArtSync still latches what came before it. With
+// the jitter buffer on (playout.h) frames are not coalesced at all.
+
+#define RXBATCH_SLOTS     16
+// Largest sACN data packet, ArtDmx is 530 bytes
+#define RXBATCH_SLOT_LEN  640
+
+typedef enum {
+    RXBATCH_ARTNET,
+    RXBATCH_SACN,
+} rxbatch_proto_t;
+
+typedef struct {
+    uint32_t datagrams;
+    uint32_t coalesced;     // DMX frames replaced by a newer one
+    uint32_t batches;
+    uint32_t largest_batch; // datagrams
+} rxbatch_stats_t;
+
+void rxbatch_begin(void);
+
+// Buffer of RXBATCH_SLOT_LEN bytes to receive the next datagram into
+uint8_t *rxbatch_slot(void);
+
+// Queues the datagram received into rxbatch_slot(), source_ip in network
+// byte order
+void rxbatch_push(rxbatch_proto_t proto, size_t len, uint32_t source_ip);
+
+// Queues a datagram where it is, for zero-copy receive (see netrx.h). It
+// must stay valid until release(ref), called once the batch is processed.
+void rxbatch_push_ref(rxbatch_proto_t proto, const uint8_t *data, size_t len,
+        uint32_t source_ip, void (*release)(void *ref), void *ref);
+
+// Processes whatever is queued and commits the outputs
+void rxbatch_end(void);
+
+void rxbatch_get_stats(rxbatch_stats_t *stats);
@@ -0,0 +1,350 @@
+
+// E1.31 (sACN) receiver. Packets are read by the Art-Net task next to
+// Art-Net so both protocols share one writer of the DMX buffers.
+//
+
+#include <errno.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "ingest.h"
+#include "merge.h"
+#include "route.h"
+#include "sacn.h"
+#include "trace.h"
+
+#define SACN_ACN_ID         "ASC-E1.17\0\0\0"
+#define SACN_ACN_ID_LEN     12
+
+#define SACN_VECTOR_ROOT_DATA   0x00000004
+#define SACN_VECTOR_FRAMING     0x00000002
+#define SACN_VECTOR_DMP_SET     0x02
+
+#define SACN_OPT_PREVIEW        0x80
+#define SACN_OPT_TERMINATED     0x40
+
+// Offsets into a data packet, the slots start after the start code
+#define SACN_OFS_ROOT_VECTOR    18
+#define SACN_OFS_CID            22
+#define SACN_OFS_FRAME_VECTOR   40
+#define SACN_OFS_PRIORITY       108
+#define SACN_OFS_SEQ            111
+#define SACN_OFS_OPTIONS        112
+#define SACN_OFS_UNIVERSE       113
+#define SACN_OFS_DMP_VECTOR     117
+#define SACN_OFS_ADDR_TYPE      118
+#define SACN_OFS_COUNT          123
+#define SACN_OFS_START_CODE     125
+#define SACN_HEADER_LEN         126
+
+// Network data loss timeout of E1.31, after which a source no longer holds
+// its priority
+#define SACN_SOURCE_TIMEOUT_MS  2500
+
+// Packets this far behind the last one are out of order, anything further
+// back is taken as the source restarting
+#define SACN_SEQ_WINDOW         20
+
+typedef struct {
+    uint32_t key;
+    TickType_t last_seen;
+    uint8_t priority;
+    uint8_t seq;
+    bool live;
+} sacn_source_t;
+
+static const char *TAG = "sACN";
+
+// Only touched by the network task
+static sacn_source_t sacn_sources[DMX_OUTPUT_COUNT][MERGE_SOURCES];
+
+static inline uint32_t read_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+// FNV-1a of the 16 byte CID, never MERGE_KEY_LOCAL
+static uint32_t cid_key(const uint8_t *cid)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 16; i++)
+    {
+        hash = (hash ^ cid[i]) * 16777619u;
+    }
+    return hash == MERGE_KEY_LOCAL ? 1 : hash;
+}
+
+static void forget_source(uint8_t output, sacn_source_t *source)
+{
+    source->live = false;
+    dmx_source_release(output, source->key);
+}
+
+static bool seq_out_of_order(uint8_t seq, uint8_t prev)
+{
+    int8_t delta = (int8_t)(seq - prev);
+    return delta <= 0 && delta > -SACN_SEQ_WINDOW;
+}
+
+// Applies priority and sequence rules for one output, returns whether the
+// packet should be written to it
+static bool accept_packet(uint8_t output, uint32_t key, uint8_t priority, uint8_t seq)
+{
+    sacn_source_t *sources = sacn_sources[output];
+    TickType_t now = xTaskGetTickCount();
+    sacn_source_t *self = NULL;
+    sacn_source_t *free_entry = NULL;
+    uint8_t top = 0;
+
+    for (int i = 0; i < MERGE_SOURCES; i++)
+    {
+        if (sources[i].live &&
+                now - sources[i].last_seen > pdMS_TO_TICKS(SACN_SOURCE_TIMEOUT_MS))
+        {
+            ESP_LOGI(TAG, "Output %d source %08x timed out", output, sources[i].key);
+            forget_source(output, &sources[i]);
+        }
+        if (!sources[i].live)
+        {
+            free_entry = free_entry ? free_entry : &sources[i];
+            continue;
+        }
+        if (sources[i].key == key)
+        {
+            self = &sources[i];
+        }
+        else if (sources[i].priority > top)
+        {
+            top = sources[i].priority;
+        }
+    }
+
+    if (priority < top)
+    {
+        return false;
+    }
+
+    if (self != NULL)
+    {
+        if (seq_out_of_order(seq, self->seq))
+        {
+            trace_event(TRACE_SACN_OUT_OF_ORDER, output, seq);
+            ESP_LOGD(TAG, "Output %d dropped sequence %d after %d", output, seq, self->seq);
+            return false;
+        }
+    }
+
+    // Equal priorities merge, a higher one takes the output over
+    for (int i = 0; i < MERGE_SOURCES; i++)
+    {
+        if (sources[i].live && &sources[i] != self && sources[i].priority < priority)
+        {
+            trace_event(TRACE_SACN_PRIORITY_TAKEOVER, output << 8 | priority, sources[i].key);
+            ESP_LOGI(TAG, "Output %d source %08x overridden by priority %d",
+                    output, sources[i].key, priority);
+            forget_source(output, &sources[i]);
+            free_entry = free_entry ? free_entry : &sources[i];
+        }
+    }
+
+    if (self == NULL)
+    {
+        if (free_entry == NULL)
+        {
+            // Already merging two other sources
+            return false;
+        }
+        self = free_entry;
+        self->key = key;
+        self->live = true;
+    }
+    self->priority = priority;
+    self->seq = seq;
+    self->last_seen = now;
+    return true;
+}
+
+static void terminate(uint8_t outputs, uint32_t key)
+{
+    for (uint8_t output = 0; outputs != 0; output++, outputs >>= 1)
+    {
+        if (!(outputs & 0x01))
+        {
+            continue;
+        }
+        for (int i = 0; i < MERGE_SOURCES; i++)
+        {
+            if (sacn_sources[output][i].live && sacn_sources[output][i].key == key)
+            {
+                forget_source(output, &sacn_sources[output][i]);
+            }
+        }
+    }
+}
+
+// sACN universe to the Art-Net Port-Address the routing table works with,
+// CONFIG_SACN_UNIVERSE lines up with CONFIG_ARTNET_UNIVERSE
+static bool port_address(uint16_t universe, uint16_t *address)
+{
+    int pa = (int)universe - CONFIG_SACN_UNIVERSE + CONFIG_ARTNET_UNIVERSE;
+    if (pa < 0 || pa > 0x7fff)
+    {
+        return false;
+    }
+    *address = pa;
+    return true;
+}
+
+bool sacn_data_universe(const uint8_t *buf, size_t len, uint16_t *universe, uint8_t *seq)
+{
+    if (len < SACN_HEADER_LEN ||
+            read_be32(&buf[SACN_OFS_ROOT_VECTOR]) != SACN_VECTOR_ROOT_DATA ||
+            read_be32(&buf[SACN_OFS_FRAME_VECTOR]) != SACN_VECTOR_FRAMING)
+    {
+        return false;
+    }
+    *universe = buf[SACN_OFS_UNIVERSE] << 8 | buf[SACN_OFS_UNIVERSE + 1];
+    *seq = buf[SACN_OFS_SEQ];
+    return true;
+}
+
+bool sacn_data_ignored(const uint8_t *buf, size_t len)
+{
+    uint16_t universe;
+    uint8_t seq;
+    return sacn_data_universe(buf, len, &universe, &seq) &&
+        (buf[SACN_OFS_OPTIONS] & SACN_OPT_PREVIEW || buf[SACN_OFS_START_CODE] != 0x00);
+}
+
+bool sacn_seq_follows(uint8_t seq, uint8_t prev)
+{
+    return !seq_out_of_order(seq, prev);
+}
+
+bool handle_sacn(const uint8_t *buf, size_t len)
+{
+    if (len < SACN_HEADER_LEN)
+    {
+        TRACE_WARN(TAG, TRACE_SACN_SHORT, len, 0, "packet too short");
+        return false;
+    }
+    if (memcmp(&buf[4], SACN_ACN_ID, SACN_ACN_ID_LEN) != 0)
+    {
+        TRACE_WARN(TAG, TRACE_SACN_BAD_ID, len, 0, "incorrect ACN packet identifier");
+        return false;
+    }
+    if (read_be32(&buf[SACN_OFS_ROOT_VECTOR]) != SACN_VECTOR_ROOT_DATA ||
+            read_be32(&buf[SACN_OFS_FRAME_VECTOR]) != SACN_VECTOR_FRAMING)
+    {
+        // Universe discovery or sync, neither is used
+        ESP_LOGD(TAG, "Ignoring non data packet");
+        return true;
+    }
+    if (buf[SACN_OFS_DMP_VECTOR] != SACN_VECTOR_DMP_SET || buf[SACN_OFS_ADDR_TYPE] != 0xa1)
+    {
+        TRACE_WARN(TAG, TRACE_SACN_BAD_DMP, buf[SACN_OFS_DMP_VECTOR], 0, "malformed DMP layer");
+        return false;
+    }
+
+    // Property value count includes the start code
+    uint16_t count = buf[SACN_OFS_COUNT] << 8 | buf[SACN_OFS_COUNT + 1];
+    if (count < 1 || count > 513 || count != len - SACN_OFS_START_CODE)
+    {
+        TRACE_WARN(TAG, TRACE_SACN_BAD_COUNT, count, len,
+                "property count does not match packet length");
+        return false;
+    }
+
+    uint8_t options = buf[SACN_OFS_OPTIONS];
+    if (options & SACN_OPT_PREVIEW || buf[SACN_OFS_START_CODE] != 0x00)
+    {
+        return true;
+    }
+
+    uint16_t universe = buf[SACN_OFS_UNIVERSE] << 8 | buf[SACN_OFS_UNIVERSE + 1];
+    uint16_t address;
+    uint8_t outputs;
+    if (!port_address(universe, &address) || (outputs = route_lookup(address)) == 0)
+    {
+        // Nobody listens to this universe
+        return true;
+    }
+
+    uint32_t key = cid_key(&buf[SACN_OFS_CID]);
+    if (options & SACN_OPT_TERMINATED)
+    {
+        trace_event(TRACE_SACN_TERMINATED, universe, key);
+        ESP_LOGI(TAG, "Source %08x terminated universe %d", key, universe);
+        terminate(outputs, key);
+        return true;
+    }
+
+    uint8_t priority = buf[SACN_OFS_PRIORITY];
+    uint8_t seq = buf[SACN_OFS_SEQ];
+    uint8_t accepted = 0;
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        if (outputs & (1 << output) && accept_packet(output, key, priority, seq))
+        {
+            accepted |= 1 << output;
+        }
+    }
+
+    ingest_dmx(accepted, key, &buf[SACN_HEADER_LEN], count - 1, false);
+    return true;
+}
+
+uint32_t sacn_group(uint8_t output)
+{
+    // 239.255.<universe hi>.<universe lo>
+    return htonl(0xefff0000 | (uint16_t)(CONFIG_SACN_UNIVERSE + output));
+}
+
+int sacn_socket_open(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return -1;
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SACN_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        ESP_LOGE(TAG, "Socket unable to bind: errno %d", errno);
+        close(sock);
+        return -1;
+    }
+
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT; output++)
+    {
+        uint16_t universe = CONFIG_SACN_UNIVERSE + output;
+        struct ip_mreq mreq = {
+            .imr_multiaddr.s_addr = sacn_group(output),
+            .imr_interface.s_addr = htonl(INADDR_ANY),
+        };
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+        {
+            ESP_LOGW(TAG, "Unable to join universe %d: errno %d", universe, errno);
+        }
+        else
+        {
+            ESP_LOGI(TAG, "Joined universe %d", universe);
+        }
+    }
+    return sock;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Port E1.31 (sACN) data packets arrive on
+#define SACN_PORT 5568
+
+// Multicast group of an output's universe, network byte order
+uint32_t sacn_group(uint8_t output);
+
+// Opens the sACN socket and joins the multicast group of every universe
+// routed to an output, returns the socket or -1
+int sacn_socket_open(void);
+
+// Parses one E1.31 data packet and feeds it to the outputs through the
+// ingest layer. Returns false for malformed packets.
+bool handle_sacn(const uint8_t *buf, size_t len);
+
+// Universe and sequence of an E1.31 data packet, without validating the
+// rest of it
+bool sacn_data_universe(const uint8_t *buf, size_t len, uint16_t *universe, uint8_t *seq);
+
+// Whether an E1.31 data packet is one that is never output: preview data
+// or a start code other than 0
+bool sacn_data_ignored(const uint8_t *buf, size_t len);
+
+// Whether a packet with sequence seq is taken after one with prev from the
+// same source, as the sequence check would take it
+bool sacn_seq_follows(uint8_t seq, uint8_t prev);
@@ -1,4 +1,7 @@
+#include <string.h>
+
 #include "esp_log.h"
+#include "sdkconfig.h"
 
 #include "lwip/err.h"
 #include "lwip/sockets.h"
@@ -8,46 +11,207 @@
 #include "common.h"
 
 #include "dmxtask.h"
+#include "merge.h"
+#include "servertask.h"
+#include "wifitask.h"
+
+// Built either way, the server options only exist with CONFIG_SERVER_ENABLE
+#if CONFIG_SERVER_ENABLE
 
 #define PORT                        CONFIG_SERVER_PORT
 #define KEEPALIVE_IDLE              CONFIG_SERVER_KEEPALIVE_IDLE
 #define KEEPALIVE_INTERVAL          CONFIG_SERVER_KEEPALIVE_INTERVAL
 #define KEEPALIVE_COUNT             CONFIG_SERVER_KEEPALIVE_COUNT
 
+// Length prefix and the type/output header
+#define SERVER_PREFIX_LEN   2
+#define SERVER_HEADER_LEN   2
+// Largest message body, a sparse write of every channel
+#define SERVER_MSG_MAX      (SERVER_HEADER_LEN + 512 * 3)
+
 enum state_ state;
 
 static const char *TAG = "TCP server";
 
-static void handle_client(const int sock)
+typedef struct {
+    int sock;
+    size_t used;
+    uint8_t buf[SERVER_PREFIX_LEN + SERVER_MSG_MAX];
+} server_client_t;
+
+static server_client_t clients[SERVER_MAX_CLIENTS];
+
+// Decoded sparse writes, only the server task uses them
+static uint16_t sparse_channels[512];
+static uint8_t sparse_values[512];
+
+static bool handle_message(const uint8_t *msg, size_t len)
+{
+    if (len < SERVER_HEADER_LEN)
+    {
+        return false;
+    }
+    uint8_t type = msg[0];
+    uint8_t output = msg[1];
+    const uint8_t *payload = &msg[SERVER_HEADER_LEN];
+    size_t payload_len = len - SERVER_HEADER_LEN;
+
+    if (output >= DMX_OUTPUT_COUNT)
+    {
+        ESP_LOGW(TAG, "No output %d", output);
+        return false;
+    }
+
+    size_t first = 0;
+    size_t count = 0;
+    if (type == SERVER_MSG_RANGE)
+    {
+        if (payload_len < 2)
+        {
+            return false;
+        }
+        first = payload[0] << 8 | payload[1];
+        count = payload_len - 2;
+        if (first < 1 || first + count > 513)
+        {
+            ESP_LOGW(TAG, "Range %d+%d outside channels 1-512", first, count);
+            return false;
+        }
+    }
+    else if (type == SERVER_MSG_SPARSE)
+    {
+        if (payload_len % 3 != 0)
+        {
+            return false;
+        }
+        count = payload_len / 3;
+        for (size_t i = 0; i < count; i++)
+        {
+            sparse_channels[i] = payload[3 * i] << 8 | payload[3 * i + 1];
+            sparse_values[i] = payload[3 * i + 2];
+            if (sparse_channels[i] < 1 || sparse_channels[i] > 512)
+            {
+                ESP_LOGW(TAG, "Channel %d outside 1-512", sparse_channels[i]);
+                return false;
+            }
+        }
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Unknown message type %d", type);
+        return false;
+    }
+
+    int source = dmx_source_claim(output, MERGE_KEY_LOCAL);
+    if (source < 0)
+    {
+        // Two network sources already merge on this output
+        return true;
+    }
+    if (type == SERVER_MSG_RANGE)
+    {
+        dmx_output_write(output, source, first, &payload[2], count);
+    }
+    else
+    {
+        dmx_output_write_sparse(output, source, sparse_channels, sparse_values, count);
+    }
+    dmx_output_commit(output, source);
+    return true;
+}
+
+// Reads what the socket has and handles every complete message, returns
+// false when the connection should be closed
+static bool handle_client(server_client_t *client)
 {
-    int len;
-    char rx_buffer[128];
-
-    do {
-        len = recv(sock, rx_buffer, sizeof(rx_buffer) - 1, 0);
-        if (len < 0) {
-            ESP_LOGE(TAG, "Error occurred during receiving: errno %d", errno);
-        } else if (len == 0) {
-            ESP_LOGW(TAG, "Connection closed");
-        } else {
-            ESP_LOGI(TAG, "Got message %d - %d",
-                    rx_buffer[0],
-                    rx_buffer[1]);
-            dmx_write(rx_buffer[0], rx_buffer[1]);
+    int len = recv(client->sock, &client->buf[client->used],
+            sizeof(client->buf) - client->used, 0);
+    if (len < 0) {
+        ESP_LOGE(TAG, "Error occurred during receiving: errno %d", errno);
+        return false;
+    } else if (len == 0) {
+        ESP_LOGI(TAG, "Connection closed");
+        return false;
+    }
+    client->used += len;
+
+    size_t pos = 0;
+    while (client->used - pos >= SERVER_PREFIX_LEN)
+    {
+        size_t msg_len = client->buf[pos] << 8 | client->buf[pos + 1];
+        if (msg_len > SERVER_MSG_MAX)
+        {
+            ESP_LOGW(TAG, "Message of %d bytes too long", msg_len);
+            return false;
         }
-    } while (len > 0);
-    state = STATE_IDLE;
+        if (client->used - pos < SERVER_PREFIX_LEN + msg_len)
+        {
+            break;
+        }
+        if (!handle_message(&client->buf[pos + SERVER_PREFIX_LEN], msg_len))
+        {
+            ESP_LOGW(TAG, "Malformed message, closing connection");
+            return false;
+        }
+        pos += SERVER_PREFIX_LEN + msg_len;
+    }
+
+    // Keep the start of an incomplete message
+    memmove(client->buf, &client->buf[pos], client->used - pos);
+    client->used -= pos;
+    return true;
 }
 
-static void server_worker(void *pvParameters)
+static void accept_client(int listen_sock)
 {
     char addr_str[128];
-    int addr_family = AF_INET;
-    int ip_protocol = 0;
     int keepAlive = 1;
     int keepIdle = KEEPALIVE_IDLE;
     int keepInterval = KEEPALIVE_INTERVAL;
     int keepCount = KEEPALIVE_COUNT;
+
+    struct sockaddr_storage source_addr;
+    socklen_t addr_len = sizeof(source_addr);
+    int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+        return;
+    }
+
+    server_client_t *client = NULL;
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        if (clients[i].sock < 0) {
+            client = &clients[i];
+            break;
+        }
+    }
+    if (client == NULL) {
+        ESP_LOGW(TAG, "Already serving %d clients, connection refused", SERVER_MAX_CLIENTS);
+        close(sock);
+        return;
+    }
+
+    setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepIdle, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepInterval, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepCount, sizeof(int));
+
+    if (source_addr.ss_family == PF_INET) {
+        inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+    }
+
+    ESP_LOGI(TAG, "Socket accepted ip address: %s", addr_str);
+
+    client->sock = sock;
+    client->used = 0;
+}
+
+static void server_worker(void *pvParameters)
+{
+    wifi_wait_connected();
+
+    int addr_family = AF_INET;
+    int ip_protocol = 0;
     struct sockaddr_storage dest_addr;
 
     struct sockaddr_in *dest_addr_ip4 = (struct sockaddr_in *)&dest_addr;
@@ -56,6 +220,10 @@ static void server_worker(void *pvParameters)
     dest_addr_ip4->sin_port = htons(PORT);
     ip_protocol = IPPROTO_IP;
 
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        clients[i].sock = -1;
+    }
+
     int listen_sock = socket(addr_family, SOCK_STREAM, ip_protocol);
     if (listen_sock < 0) {
         ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
@@ -77,42 +245,43 @@ static void server_worker(void *pvParameters)
     }
     ESP_LOGI(TAG, "Socket bound, port %d", PORT);
 
-    err = listen(listen_sock, 1);
+    err = listen(listen_sock, SERVER_MAX_CLIENTS);
     if (err != 0) {
         ESP_LOGE(TAG, "Error occurred during listen: errno %d", errno);
         state = STATE_ERROR;
         goto CLEAN_UP;
     }
+    ESP_LOGI(TAG, "Socket listening");
 
     while (1) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listen_sock, &readable);
+        int max_sock = listen_sock;
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            if (clients[i].sock >= 0) {
+                FD_SET(clients[i].sock, &readable);
+                max_sock = clients[i].sock > max_sock ? clients[i].sock : max_sock;
+            }
+        }
 
-        ESP_LOGI(TAG, "Socket listening");
-
-        assert(state == STATE_IDLE);
-
-        struct sockaddr_storage source_addr;
-        socklen_t addr_len = sizeof(source_addr);
-        int sock = accept(listen_sock, (struct sockaddr *)&source_addr, &addr_len);
-        if (sock < 0) {
-            ESP_LOGE(TAG, "Unable to accept connection: errno %d", errno);
+        if (select(max_sock + 1, &readable, NULL, NULL, NULL) < 0) {
+            ESP_LOGE(TAG, "select failed: errno %d", errno);
             break;
         }
 
-        setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepAlive, sizeof(int));
-        setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepIdle, sizeof(int));
-        setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepInterval, sizeof(int));
-        setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepCount, sizeof(int));
-
-        if (source_addr.ss_family == PF_INET) {
-            inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            server_client_t *client = &clients[i];
+            if (client->sock >= 0 && FD_ISSET(client->sock, &readable) && !handle_client(client)) {
+                shutdown(client->sock, 0);
+                close(client->sock);
+                client->sock = -1;
+            }
         }
 
-        ESP_LOGI(TAG, "Socket accepted ip address: %s", addr_str);
-
-        handle_client(sock);
-
-        shutdown(sock, 0);
-        close(sock);
+        if (FD_ISSET(listen_sock, &readable)) {
+            accept_client(listen_sock);
+        }
     }
 
 CLEAN_UP:
@@ -127,11 +296,6 @@ static TaskHandle_t task_handle = NULL;
 
 void server_task_start(void)
 {
-    while(state != STATE_IDLE) {
-        /* Wait for wifi task to connect to a network */
-        vTaskDelay(pdMS_TO_TICKS(100));
-    }
-
     task_handle = xTaskCreateStatic(
             server_worker,
             "server",
@@ -141,3 +305,4 @@ void server_task_start(void)
             xStack,
             &xTaskBuffer);
 }
+#endif
@@ -1,3 +1,25 @@
 #pragma once
 
+// With CONFIG_SERVER_ENABLE, a binary control protocol on TCP port
+// CONFIG_SERVER_PORT, any number of messages per connection and up to
+// SERVER_MAX_CLIENTS connections at once.
+// Every message is
+//
+//   length  u16 big endian, bytes that follow
+//   type    u8
+//   output  u8
+//   payload
+//
+// and its writes reach the output together, as one buffer commit:
+//
+//   SERVER_MSG_RANGE   first channel u16 BE, then one value per channel
+//   SERVER_MSG_SPARSE  (channel u16 BE, value u8) pairs
+//
+// Channels are 1-512. A malformed message closes the connection.
+
+#define SERVER_MSG_RANGE  0x01
+#define SERVER_MSG_SPARSE 0x02
+
+#define SERVER_MAX_CLIENTS 4
+
 void server_task_start(void);
@@ -0,0 +1,280 @@
+#include <string.h>
+
+#include "show.h"
+
+#define TAG_KEYFRAME    0x40
+#define TAG_END         0x80
+#define TAG_ERASED      0xff
+#define TAG_UNIVERSE    0x3f
+
+#define RUN_END         0x00
+#define RUN_LITERAL     0x80
+#define SKIP_MAX        0x7f
+#define LITERAL_MAX     128
+// Zero runs shorter than this cost less inside a literal than split out
+#define SKIP_MIN        3
+
+static size_t put_varint(uint8_t *out, uint32_t value)
+{
+    size_t len = 0;
+    while (value >= 0x80)
+    {
+        out[len++] = value | 0x80;
+        value >>= 7;
+    }
+    out[len++] = value;
+    return len;
+}
+
+static bool get_varint(const show_decoder_t *dec, size_t *pos, uint32_t *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (*pos >= dec->len)
+        {
+            return false;
+        }
+        uint8_t byte = dec->data[(*pos)++];
+        *value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t zero_run(const uint8_t *diff, size_t from, size_t count)
+{
+    size_t end = from;
+    while (end < count && diff[end] == 0)
+    {
+        end++;
+    }
+    return end - from;
+}
+
+// Run length codes diff, the XOR of the frame and its reference
+static size_t put_runs(uint8_t *out, const uint8_t *diff, size_t count)
+{
+    size_t len = 0;
+    size_t i = 0;
+    while (i < count)
+    {
+        size_t zeros = zero_run(diff, i, count);
+        if (i + zeros == count)
+        {
+            out[len++] = RUN_END;
+            break;
+        }
+        i += zeros;
+        while (zeros > 0)
+        {
+            uint8_t skip = zeros > SKIP_MAX ? SKIP_MAX : zeros;
+            out[len++] = skip;
+            zeros -= skip;
+        }
+
+        // Short zero runs stay in the literal, a skip would cost as much
+        size_t start = i;
+        while (i < count && i - start < LITERAL_MAX)
+        {
+            if (diff[i] == 0)
+            {
+                size_t run = zero_run(diff, i, count);
+                if (run >= SKIP_MIN || i + run == count)
+                {
+                    break;
+                }
+            }
+            i++;
+        }
+        out[len++] = RUN_LITERAL | (i - start - 1);
+        memcpy(&out[len], &diff[start], i - start);
+        len += i - start;
+    }
+    return len;
+}
+
+size_t show_encoder_init(show_encoder_t *enc, uint32_t keyframe_ms, uint8_t *out)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->keyframe_interval_us = keyframe_ms * 1000;
+
+    memcpy(out, SHOW_MAGIC, 4);
+    out[4] = SHOW_VERSION;
+    out[5] = 0;
+    out[6] = keyframe_ms & 0xff;
+    out[7] = keyframe_ms >> 8;
+    return SHOW_HEADER_LEN;
+}
+
+size_t show_encode_frame(show_encoder_t *enc, uint8_t *out, uint8_t universe,
+        const uint8_t *slots, size_t count, uint32_t t_us)
+{
+    uint8_t diff[512];
+    uint8_t *prev = enc->prev[universe];
+    bool keyframe = enc->count[universe] != count ||
+        t_us - enc->keyframe_us[universe] >= enc->keyframe_interval_us;
+
+    if (keyframe)
+    {
+        memcpy(diff, slots, count);
+    }
+    else
+    {
+        uint8_t changed = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            diff[i] = slots[i] ^ prev[i];
+            changed |= diff[i];
+        }
+        if (changed == 0)
+        {
+            return 0;
+        }
+    }
+
+    size_t len = 0;
+    out[len++] = (keyframe ? TAG_KEYFRAME : 0) | universe;
+    len += put_varint(&out[len], t_us - enc->t_us);
+    if (keyframe)
+    {
+        len += put_varint(&out[len], count);
+        enc->count[universe] = count;
+        enc->keyframe_us[universe] = t_us;
+    }
+    len += put_runs(&out[len], diff, count);
+
+    memcpy(prev, slots, count);
+    enc->t_us = t_us;
+    return len;
+}
+
+size_t show_encode_end(show_encoder_t *enc, uint8_t *out, uint32_t t_us)
+{
+    size_t len = 0;
+    out[len++] = TAG_END;
+    len += put_varint(&out[len], t_us - enc->t_us);
+    enc->t_us = t_us;
+    return len;
+}
+
+bool show_decoder_init(show_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    if (len < SHOW_HEADER_LEN || memcmp(data, SHOW_MAGIC, 4) != 0 || data[4] != SHOW_VERSION)
+    {
+        return false;
+    }
+    dec->data = data;
+    dec->len = len;
+    show_decoder_rewind(dec);
+    return true;
+}
+
+void show_decoder_rewind(show_decoder_t *dec)
+{
+    dec->pos = SHOW_HEADER_LEN;
+    dec->t_us = 0;
+    memset(dec->count, 0, sizeof(dec->count));
+}
+
+bool show_next_time(const show_decoder_t *dec, uint32_t *t_us)
+{
+    size_t pos = dec->pos;
+    uint32_t delta;
+    if (pos >= dec->len || dec->data[pos] == TAG_ERASED)
+    {
+        return false;
+    }
+    pos++;
+    if (!get_varint(dec, &pos, &delta))
+    {
+        return false;
+    }
+    *t_us = dec->t_us + delta;
+    return true;
+}
+
+static bool apply_runs(show_decoder_t *dec, uint8_t *frame, size_t count)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        if (dec->pos >= dec->len)
+        {
+            return false;
+        }
+        uint8_t run = dec->data[dec->pos++];
+        if (run == RUN_END)
+        {
+            return true;
+        }
+        if (!(run & RUN_LITERAL))
+        {
+            i += run;
+            continue;
+        }
+        size_t literal = (run & ~RUN_LITERAL) + 1;
+        if (i + literal > count || dec->pos + literal > dec->len)
+        {
+            return false;
+        }
+        const uint8_t *src = &dec->data[dec->pos];
+        for (size_t j = 0; j < literal; j++)
+        {
+            frame[i + j] ^= src[j];
+        }
+        i += literal;
+        dec->pos += literal;
+    }
+    return i == count;
+}
+
+show_status_t show_decode_next(show_decoder_t *dec, uint8_t *universe)
+{
+    if (dec->pos >= dec->len || dec->data[dec->pos] == TAG_ERASED)
+    {
+        return SHOW_END;
+    }
+    uint8_t tag = dec->data[dec->pos++];
+    uint32_t delta;
+    if (!get_varint(dec, &dec->pos, &delta))
+    {
+        return SHOW_ERROR;
+    }
+    dec->t_us += delta;
+    if (tag == TAG_END)
+    {
+        return SHOW_END;
+    }
+    if (tag & ~(TAG_KEYFRAME | TAG_UNIVERSE) || (tag & TAG_UNIVERSE) >= SHOW_UNIVERSES)
+    {
+        return SHOW_ERROR;
+    }
+
+    uint8_t u = tag & TAG_UNIVERSE;
+    uint8_t *frame = dec->frame[u];
+    if (tag & TAG_KEYFRAME)
+    {
+        uint32_t count;
+        if (!get_varint(dec, &dec->pos, &count) || count > 512)
+        {
+            return SHOW_ERROR;
+        }
+        dec->count[u] = count;
+        memset(frame, 0, count);
+    }
+    else if (dec->count[u] == 0)
+    {
+        // Delta without its keyframe
+        return SHOW_ERROR;
+    }
+    if (!apply_runs(dec, frame, dec->count[u]))
+    {
+        return SHOW_ERROR;
+    }
+    *universe = u;
+    return SHOW_FRAME;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream format for recorded shows. An 8 byte header ("DMXS", version,
+// reserved, keyframe interval in ms, little endian) is followed by records:
+//
+//   tag     0x00 | universe   delta against the universe's previous frame
+//           0x40 | universe   keyframe, against an all zero frame
+//           0x80              end of show
+//           0xff              erased flash, the recording was cut short
+//   varint  microseconds since the previous record
+//   varint  slot count, keyframes only
+//   runs    frame XOR reference, run length coded:
+//           0x00              rest unchanged
+//           0x01-0x7f         that many unchanged slots
+//           0x80-0xff         (c & 0x7f) + 1 literal XOR bytes follow
+//
+// Frames that did not change are not recorded at all, and a keyframe per
+// universe every keyframe interval lets a damaged stream recover. The
+// timestamps wrap after 71 minutes, only their differences matter.
+
+#define SHOW_MAGIC          "DMXS"
+#define SHOW_VERSION        1
+#define SHOW_HEADER_LEN     8
+#define SHOW_UNIVERSES      8
+// Largest record: tag, two varints and 512 literal bytes in four runs
+#define SHOW_RECORD_MAX     528
+
+typedef struct {
+    uint8_t prev[SHOW_UNIVERSES][512];
+    uint16_t count[SHOW_UNIVERSES];     // 0 before the first keyframe
+    uint32_t keyframe_us[SHOW_UNIVERSES];
+    uint32_t keyframe_interval_us;
+    uint32_t t_us;                      // time of the last record
+} show_encoder_t;
+
+typedef enum {
+    SHOW_FRAME,
+    SHOW_END,
+    SHOW_ERROR,
+} show_status_t;
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    uint32_t t_us;                      // time of the last record decoded
+    uint8_t frame[SHOW_UNIVERSES][512];
+    uint16_t count[SHOW_UNIVERSES];
+} show_decoder_t;
+
+// Writes the header to out and returns its length
+size_t show_encoder_init(show_encoder_t *enc, uint32_t keyframe_ms, uint8_t *out);
+
+// Encodes the frame of universe seen at t_us into out, at most
+// SHOW_RECORD_MAX bytes. Returns 0 when it is unchanged and no keyframe is
+// due, nothing needs to be stored then.
+size_t show_encode_frame(show_encoder_t *enc, uint8_t *out, uint8_t universe,
+        const uint8_t *slots, size_t count, uint32_t t_us);
+
+// End record at t_us, which is where a looped show starts over
+size_t show_encode_end(show_encoder_t *enc, uint8_t *out, uint32_t t_us);
+
+// False when data does not start with a show header
+bool show_decoder_init(show_decoder_t *dec, const uint8_t *data, size_t len);
+
+// Back to the first record, for looping
+void show_decoder_rewind(show_decoder_t *dec);
+
+// Time of the next record without decoding it, false at the end of the show
+bool show_next_time(const show_decoder_t *dec, uint32_t *t_us);
+
+// Decodes the next record. For SHOW_FRAME, *universe has changed and its
+// frame is in dec->frame, dec->count slots long. For SHOW_END dec->t_us is
+// the length of the show.
+show_status_t show_decode_next(show_decoder_t *dec, uint8_t *universe);
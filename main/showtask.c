@@ -0,0 +1,374 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "dmxtask.h"
+#include "latency.h"
+#include "show.h"
+#include "showtask.h"
+
+// Built either way, the show options only exist with CONFIG_SHOW_ENABLE
+#if CONFIG_SHOW_ENABLE
+
+#define SHOW_PARTITION_SUBTYPE 0x40
+// How often requests are looked at while nothing plays
+#define SHOW_POLL_MS 100
+// How often the outputs are sampled while recording, about the DMX rate
+#define SHOW_SAMPLE_MS 25
+// Sector write queued to the flash task, ERASE_ONLY just prepares one
+#define SHOW_ERASE_ONLY 0xff
+#define SHOW_SECTOR SPI_FLASH_SEC_SIZE
+
+typedef enum {
+    SHOW_IDLE,
+    SHOW_RECORDING,
+    SHOW_PLAYING,
+} show_mode_t;
+
+typedef struct {
+    uint8_t buffer;
+    uint32_t sector;
+} show_write_t;
+
+static const char *TAG = "show";
+
+static const esp_partition_t *show_partition = NULL;
+static const uint8_t *show_map = NULL;
+static spi_flash_mmap_handle_t show_map_handle;
+
+static atomic_int show_pending = SHOW_CMD_NONE;
+
+// Owned by the player task
+static show_mode_t show_mode = SHOW_IDLE;
+static uint32_t show_start_us;
+static uint32_t show_sample_us;
+
+// Recording: records are packed into one sector buffer while the flash
+// task writes out the other
+static show_encoder_t show_encoder;
+static uint8_t show_record[SHOW_RECORD_MAX];
+static uint8_t show_snapshot[DMX_FRAME_STRIDE];
+static uint8_t show_sectors[2][SHOW_SECTOR];
+static atomic_bool show_sector_busy[2];
+static uint8_t show_fill_buffer;
+static size_t show_fill;
+static uint32_t show_sector;
+
+static QueueHandle_t show_writes = NULL;
+static StaticQueue_t show_writes_buffer;
+static uint8_t show_writes_storage[3 * sizeof(show_write_t)];
+
+// Playback
+static show_decoder_t show_decoder;
+
+static void show_writer(void *pvParameters)
+{
+    show_write_t write;
+    while (1)
+    {
+        if (xQueueReceive(show_writes, &write, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        size_t offset = write.sector * SHOW_SECTOR;
+        esp_err_t err = ESP_OK;
+        if (write.buffer == SHOW_ERASE_ONLY)
+        {
+            err = esp_partition_erase_range(show_partition, offset, SHOW_SECTOR);
+        }
+        else
+        {
+            err = esp_partition_write(show_partition, offset, show_sectors[write.buffer], SHOW_SECTOR);
+            // Erasing one sector ahead keeps the byte after the recording
+            // erased, so a recording cut short by a power cut still ends
+            if (err == ESP_OK && offset + 2 * SHOW_SECTOR <= show_partition->size)
+            {
+                err = esp_partition_erase_range(show_partition, offset + SHOW_SECTOR, SHOW_SECTOR);
+            }
+            atomic_store(&show_sector_busy[write.buffer], false);
+        }
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Flash write at %u failed: %s", (unsigned)offset, esp_err_to_name(err));
+        }
+    }
+}
+
+// Hands the filled sector to the flash task and moves to the other buffer,
+// false when the flash task has fallen behind
+static bool queue_sector(void)
+{
+    show_write_t write = { .buffer = show_fill_buffer, .sector = show_sector };
+    atomic_store(&show_sector_busy[show_fill_buffer], true);
+    xQueueSend(show_writes, &write, portMAX_DELAY);
+
+    show_fill_buffer ^= 1;
+    show_fill = 0;
+    show_sector++;
+    return !atomic_load(&show_sector_busy[show_fill_buffer]);
+}
+
+static bool append(const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t room = SHOW_SECTOR - show_fill;
+        size_t chunk = len < room ? len : room;
+        memcpy(&show_sectors[show_fill_buffer][show_fill], data, chunk);
+        show_fill += chunk;
+        data += chunk;
+        len -= chunk;
+        if (show_fill == SHOW_SECTOR && !queue_sector())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void stop_recording(bool ok)
+{
+    show_mode = SHOW_IDLE;
+    if (!ok)
+    {
+        // Whatever reached flash still ends cleanly at an erased sector
+        ESP_LOGE(TAG, "Flash writes fell behind, recording stopped");
+        return;
+    }
+    uint32_t t_us = latency_now_us() - show_start_us;
+    size_t len = show_encode_end(&show_encoder, show_record, t_us);
+    if (append(show_record, len) && show_fill > 0)
+    {
+        memset(&show_sectors[show_fill_buffer][show_fill], 0xff, SHOW_SECTOR - show_fill);
+        queue_sector();
+    }
+    ESP_LOGI(TAG, "Recorded %u s in %u KB", (unsigned)(t_us / 1000000),
+            (unsigned)((show_sector * SHOW_SECTOR + show_fill) / 1024));
+}
+
+static void start_recording(void)
+{
+    show_write_t erase = { .buffer = SHOW_ERASE_ONLY, .sector = 0 };
+    xQueueSend(show_writes, &erase, portMAX_DELAY);
+
+    show_fill_buffer = 0;
+    show_fill = show_encoder_init(&show_encoder, CONFIG_SHOW_KEYFRAME_MS, show_sectors[0]);
+    show_sector = 0;
+    show_start_us = latency_now_us();
+    show_sample_us = 0;
+    show_mode = SHOW_RECORDING;
+    ESP_LOGI(TAG, "Recording, %u KB available", (unsigned)(show_partition->size / 1024));
+}
+
+static void record_frame(uint8_t output, const uint8_t *slots, size_t count, uint32_t t_us)
+{
+    // Room for this record and the end record after it
+    if (show_sector * SHOW_SECTOR + show_fill + 2 * SHOW_RECORD_MAX > show_partition->size)
+    {
+        ESP_LOGW(TAG, "Show partition full");
+        stop_recording(true);
+        return;
+    }
+    size_t len = show_encode_frame(&show_encoder, show_record, output, slots, count, t_us);
+    if (len > 0 && !append(show_record, len))
+    {
+        stop_recording(false);
+    }
+}
+
+// Records what each output puts on the wire, both merge sources merged,
+// rather than every source's packets, which would play back as one
+// overwriting the other. Returns the microseconds until the next sample.
+static uint32_t record(void)
+{
+    uint32_t elapsed = latency_now_us() - show_start_us;
+    if ((int32_t)(show_sample_us - elapsed) > 0)
+    {
+        return show_sample_us - elapsed;
+    }
+    for (uint8_t output = 0; output < DMX_OUTPUT_COUNT && output < SHOW_UNIVERSES &&
+            show_mode == SHOW_RECORDING; output++)
+    {
+        size_t len = dmx_output_snapshot(output, show_snapshot);
+        if (len > 1)
+        {
+            record_frame(output, &show_snapshot[1], len - 1, elapsed);
+        }
+    }
+    // Falls behind rather than sampling in a burst after a stall
+    show_sample_us = elapsed + SHOW_SAMPLE_MS * 1000;
+    return SHOW_SAMPLE_MS * 1000;
+}
+
+static void start_playing(void)
+{
+    if (!show_decoder_init(&show_decoder, show_map, show_partition->size))
+    {
+        ESP_LOGW(TAG, "No show recorded");
+        return;
+    }
+    show_start_us = latency_now_us();
+    show_mode = SHOW_PLAYING;
+    ESP_LOGI(TAG, "Playing");
+}
+
+// Starts the show over, the next pass begins where this one ended so the
+// loop keeps the recorded timing
+static bool loop_show(void)
+{
+    if (show_decoder.t_us == 0)
+    {
+        ESP_LOGW(TAG, "Recorded show is empty");
+        show_mode = SHOW_IDLE;
+        return false;
+    }
+    show_start_us += show_decoder.t_us;
+    show_decoder_rewind(&show_decoder);
+    return true;
+}
+
+static uint32_t play(void)
+{
+    while (show_mode == SHOW_PLAYING)
+    {
+        uint32_t elapsed = latency_now_us() - show_start_us;
+        uint32_t next_us;
+        if (!show_next_time(&show_decoder, &next_us))
+        {
+            // Recording cut short, loop from its last frame
+            loop_show();
+            continue;
+        }
+        if ((int32_t)(next_us - elapsed) > 0)
+        {
+            return next_us - elapsed;
+        }
+
+        uint8_t universe;
+        show_status_t status = show_decode_next(&show_decoder, &universe);
+        if (status == SHOW_FRAME && universe < DMX_OUTPUT_COUNT)
+        {
+            int source = dmx_source_claim(universe, SHOW_SOURCE_KEY);
+            if (source >= 0)
+            {
+                dmx_output_write_frame(universe, source, show_decoder.frame[universe],
+                        show_decoder.count[universe]);
+                dmx_output_commit(universe, source);
+            }
+        }
+        else if (status == SHOW_END)
+        {
+            loop_show();
+        }
+        else if (status == SHOW_ERROR)
+        {
+            ESP_LOGE(TAG, "Recorded show is damaged at byte %u", (unsigned)show_decoder.pos);
+            show_mode = SHOW_IDLE;
+        }
+    }
+    return SHOW_POLL_MS * 1000;
+}
+
+void show_request(show_cmd_t cmd)
+{
+    atomic_store(&show_pending, cmd);
+}
+
+// Carries out requests and plays or records, returns the microseconds
+// until something is next due
+static uint32_t service(void)
+{
+    show_cmd_t cmd = atomic_exchange(&show_pending, SHOW_CMD_NONE);
+    if (cmd != SHOW_CMD_NONE && show_mode == SHOW_RECORDING)
+    {
+        stop_recording(true);
+    }
+    if (cmd != SHOW_CMD_NONE && show_mode == SHOW_PLAYING)
+    {
+        show_mode = SHOW_IDLE;
+        ESP_LOGI(TAG, "Stopped");
+    }
+    if (cmd == SHOW_CMD_RECORD)
+    {
+        start_recording();
+    }
+    else if (cmd == SHOW_CMD_PLAY)
+    {
+        start_playing();
+    }
+
+    if (show_mode == SHOW_PLAYING)
+    {
+        return play();
+    }
+    return show_mode == SHOW_RECORDING ? record() : SHOW_POLL_MS * 1000;
+}
+
+static void show_player(void *pvParameters)
+{
+    while (1)
+    {
+        uint32_t wait_us = service();
+        TickType_t ticks = wait_us / (portTICK_PERIOD_MS * 1000);
+        vTaskDelay(ticks > 0 ? ticks : 1);
+    }
+}
+
+#define STACK_SIZE 3000
+static StaticTask_t xTaskBuffer;
+static StackType_t xStack[ STACK_SIZE ];
+static StaticTask_t xPlayerTaskBuffer;
+static StackType_t xPlayerStack[ STACK_SIZE ];
+
+void show_task_start(void)
+{
+    show_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+            SHOW_PARTITION_SUBTYPE, "show");
+    if (show_partition == NULL)
+    {
+        ESP_LOGW(TAG, "No show partition, recording disabled");
+        return;
+    }
+    esp_err_t err = esp_partition_mmap(show_partition, 0, show_partition->size,
+            SPI_FLASH_MMAP_DATA, (const void **)&show_map, &show_map_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Unable to map the show partition: %s", esp_err_to_name(err));
+        show_partition = NULL;
+        return;
+    }
+
+    show_writes = xQueueCreateStatic(3, sizeof(show_write_t), show_writes_storage,
+            &show_writes_buffer);
+    xTaskCreateStatic(
+            show_writer,
+            "show",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY,
+            xStack,
+            &xTaskBuffer
+            );
+    xTaskCreateStatic(
+            show_player,
+            "showplay",
+            STACK_SIZE,
+            (void*) 0,
+            tskIDLE_PRIORITY + 1,
+            xPlayerStack,
+            &xPlayerTaskBuffer
+            );
+
+#if CONFIG_SHOW_AUTOPLAY
+    show_request(SHOW_CMD_PLAY);
+#endif
+}
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Records what the outputs send to the "show" flash partition, in the
+// format of show.h, and loops it back with no controller attached. A player
+// task of its own samples the outputs while recording and applies the
+// frames while playing, so a show plays without the network, and another
+// task does the slow sector erases and writes.
+//
+// Playback feeds each output as one more merge source, a live controller
+// still merges with it.
+
+#define SHOW_SOURCE_KEY 0xffffffff
+
+typedef enum {
+    SHOW_CMD_NONE,
+    SHOW_CMD_RECORD,
+    SHOW_CMD_PLAY,
+    SHOW_CMD_STOP,
+} show_cmd_t;
+
+// Maps the partition and starts the flash writer, and with
+// CONFIG_SHOW_AUTOPLAY starts looping the stored show
+void show_task_start(void);
+
+// From any task, carried out by the player task within SHOW_POLL_MS
+void show_request(show_cmd_t cmd);
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "latency.h"
+#include "trace.h"
+
+#define TRACE_RECORDS   (1u << CONFIG_TRACE_RING_BITS)
+#define TRACE_MASK      (TRACE_RECORDS - 1)
+
+#define TRACE_LOG_INTERVAL_MS 1000
+
+static trace_record_t trace_ring[TRACE_RECORDS];
+static atomic_uint trace_head;
+
+// Rate limiting is only a guard for the console, races just let an extra
+// line through
+static TickType_t trace_last_log[TRACE_EVENT_COUNT];
+static uint32_t trace_suppressed[TRACE_EVENT_COUNT];
+static bool trace_logged[TRACE_EVENT_COUNT];
+
+static const char *const trace_names[TRACE_EVENT_COUNT] = {
+#define TRACE_NAME(name) [TRACE_##name] = #name,
+    TRACE_EVENTS(TRACE_NAME)
+#undef TRACE_NAME
+};
+
+void trace_event(trace_event_t event, uint16_t arg0, uint32_t arg1)
+{
+    uint32_t index = atomic_fetch_add_explicit(&trace_head, 1, memory_order_relaxed);
+    trace_record_t *record = &trace_ring[index & TRACE_MASK];
+
+    // Readers skip the record until seq shows it complete
+    atomic_store_explicit(&record->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    record->ts_us = latency_now_us();
+    record->event = event;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+    atomic_store_explicit(&record->seq, index + 1, memory_order_release);
+}
+
+const char *trace_event_name(trace_event_t event)
+{
+    return event < TRACE_EVENT_COUNT ? trace_names[event] : "?";
+}
+
+bool trace_log_allowed(trace_event_t event, uint32_t *suppressed)
+{
+    TickType_t now = xTaskGetTickCount();
+    if (trace_logged[event] &&
+            now - trace_last_log[event] < pdMS_TO_TICKS(TRACE_LOG_INTERVAL_MS))
+    {
+        trace_suppressed[event]++;
+        return false;
+    }
+    trace_logged[event] = true;
+    trace_last_log[event] = now;
+    *suppressed = trace_suppressed[event];
+    trace_suppressed[event] = 0;
+    return true;
+}
+
+void trace_dump(void)
+{
+    uint32_t head = atomic_load_explicit(&trace_head, memory_order_acquire);
+    uint32_t first = head > TRACE_RECORDS ? head - TRACE_RECORDS : 0;
+
+    printf("TRACE BEGIN %u\n", (unsigned)(head - first));
+    for (uint32_t index = first; index != head; index++)
+    {
+        trace_record_t *record = &trace_ring[index & TRACE_MASK];
+        uint32_t seq = atomic_load_explicit(&record->seq, memory_order_acquire);
+        uint8_t raw[TRACE_RECORD_LEN];
+        uint32_t ts_us = record->ts_us;
+        uint16_t event = record->event;
+        uint16_t arg0 = record->arg0;
+        uint32_t arg1 = record->arg1;
+        atomic_thread_fence(memory_order_acquire);
+        if (seq != index + 1 || atomic_load_explicit(&record->seq, memory_order_relaxed) != seq)
+        {
+            // Being written or already overwritten
+            continue;
+        }
+
+        memcpy(&raw[0], &seq, 4);
+        memcpy(&raw[4], &ts_us, 4);
+        memcpy(&raw[8], &event, 2);
+        memcpy(&raw[10], &arg0, 2);
+        memcpy(&raw[12], &arg1, 4);
+        printf("TRACE ");
+        for (int i = 0; i < TRACE_RECORD_LEN; i++)
+        {
+            printf("%02x", raw[i]);
+        }
+        printf("\n");
+    }
+    printf("TRACE END\n");
+}
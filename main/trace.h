@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_log.h"
+
+// Fixed size ring of binary trace records, cheap enough for the packet path
+// and the DMX interrupts: recording is one atomic add and four stores, no
+// formatting. The ring is dumped as hex by the console "trace" command and
+// turned into a timeline on the host by host/tools/trace_decode. Text logs
+// of the same events go through TRACE_WARN, which rate limits them.
+
+#define TRACE_EVENTS(X)             \
+    X(ARTNET_SHORT)                 \
+    X(ARTNET_BAD_MAGIC)             \
+    X(ARTNET_BAD_VERSION)           \
+    X(ARTDMX_TRUNCATED)             \
+    X(ARTDMX_LEN_MISMATCH)          \
+    X(ARTDMX_TOO_LONG)              \
+    X(ARTDMX_OUT_OF_ORDER)          \
+    X(ARTSYNC_TRUNCATED)            \
+    X(ARTSYNC_FOREIGN)              \
+    X(ARTSYNC_ENTER)                \
+    X(ARTSYNC_LEAVE)                \
+    X(ARTPOLL_TRUNCATED)            \
+    X(ARTPOLL_REPLY)                \
+    X(SACN_SHORT)                   \
+    X(SACN_BAD_ID)                  \
+    X(SACN_BAD_DMP)                 \
+    X(SACN_BAD_COUNT)               \
+    X(SACN_OUT_OF_ORDER)            \
+    X(SACN_PRIORITY_TAKEOVER)       \
+    X(SACN_TERMINATED)              \
+    X(MERGE_TIMEOUT)                \
+    X(RX_BATCH)                     \
+    X(DMX_LATE_FRAME)               \
+    X(WIFI_CONNECTING)              \
+    X(WIFI_CONNECTED)               \
+    X(WIFI_DISCONNECTED)            \
+    X(WIFI_GOT_IP)                  \
+    X(ARTNET_TRUNCATED)             \
+    X(ARTNET_BAD_LENGTH)
+
+typedef enum {
+#define TRACE_ENUM(name) TRACE_##name,
+    TRACE_EVENTS(TRACE_ENUM)
+#undef TRACE_ENUM
+    TRACE_EVENT_COUNT,
+} trace_event_t;
+
+// 16 bytes, dumped as is in little endian
+typedef struct {
+    atomic_uint seq;        // position in the trace + 1, 0 while being written
+    uint32_t ts_us;         // esp_timer clock, see latency.h
+    uint16_t event;
+    uint16_t arg0;
+    uint32_t arg1;
+} trace_record_t;
+
+#define TRACE_RECORD_LEN 16
+
+void trace_event(trace_event_t event, uint16_t arg0, uint32_t arg1);
+
+const char *trace_event_name(trace_event_t event);
+
+// True at most once per second for each event. *suppressed is the number
+// of calls refused since the last time it was true.
+bool trace_log_allowed(trace_event_t event, uint32_t *suppressed);
+
+// Records event and logs a warning unless one was logged for it recently
+#define TRACE_WARN(tag, event, arg0, arg1, fmt, ...) do {                   \
+        uint32_t trace_suppressed_;                                         \
+        trace_event(event, arg0, arg1);                                     \
+        if (trace_log_allowed(event, &trace_suppressed_)) {                 \
+            ESP_LOGW(tag, fmt, ##__VA_ARGS__);                              \
+            if (trace_suppressed_ > 0) {                                    \
+                ESP_LOGW(tag, "%u more suppressed", (unsigned)trace_suppressed_); \
+            }                                                               \
+        }                                                                   \
+    } while (0)
+
+// Prints the ring oldest first as "TRACE <32 hex digits>" lines between a
+// "TRACE BEGIN" and a "TRACE END" line
+void trace_dump(void);
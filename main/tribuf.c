@@ -0,0 +1,32 @@
+#include "tribuf.h"
+
+#define TRIBUF_FRESH 0x04
+#define TRIBUF_INDEX 0x03
+
+void tribuf_init(tribuf_t *tribuf)
+{
+    tribuf->front = 0;
+    atomic_init(&tribuf->middle, 1);
+    tribuf->back = 2;
+}
+
+uint8_t tribuf_publish(tribuf_t *tribuf)
+{
+    uint_fast8_t old = atomic_exchange_explicit(&tribuf->middle,
+            tribuf->back | TRIBUF_FRESH, memory_order_acq_rel);
+    tribuf->back = old & TRIBUF_INDEX;
+    return tribuf->back;
+}
+
+bool tribuf_acquire(tribuf_t *tribuf)
+{
+    if (!(atomic_load_explicit(&tribuf->middle, memory_order_relaxed) & TRIBUF_FRESH))
+    {
+        return false;
+    }
+    // Only the reader clears the fresh flag, so it is still set here
+    uint_fast8_t old = atomic_exchange_explicit(&tribuf->middle,
+            tribuf->front, memory_order_acq_rel);
+    tribuf->front = old & TRIBUF_INDEX;
+    return true;
+}
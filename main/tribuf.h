@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Wait-free triple buffer index for one writer and one reader. The caller
+// owns the three buffers, this only tracks which one each side may touch:
+// the writer fills 'back' and publishes it, the reader transmits 'front' and
+// swaps in the newest published buffer when there is one. Neither side ever
+// waits for the other, a publish or acquire is a single atomic exchange.
+typedef struct {
+    atomic_uint_fast8_t middle;     // shared buffer index | TRIBUF_FRESH
+    uint8_t back;                   // writer owned
+    uint8_t front;                  // reader owned
+} tribuf_t;
+
+void tribuf_init(tribuf_t *tribuf);
+
+// Writer: hands the back buffer to the reader, returns the new back buffer
+uint8_t tribuf_publish(tribuf_t *tribuf);
+
+// Reader: makes the newest published buffer the front one, returns false
+// (and keeps the current front) if nothing was published since last time
+bool tribuf_acquire(tribuf_t *tribuf);
@@ -12,7 +12,9 @@
 #include "lwip/err.h"
 #include "lwip/sys.h"
 
+#include "artpoll.h"
 #include "common.h"
+#include "trace.h"
 
 static const char *TAG = "wifi task";
 
@@ -28,6 +30,8 @@ static EventGroupHandle_t s_wifi_event_group;
  * - we failed to connect after the maximum amount of retries */
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
+// Set for as long as we have an IP, the network tasks wait on it to start
+#define WIFI_UP_BIT        BIT2
 
 
 static int s_retry_num = 0;
@@ -46,11 +50,15 @@ static void event_handler(void* arg, esp_event_base_t event_base,
             ESP_LOGI(TAG, "AP started");
         } else {
             ESP_LOGI(TAG, "connecting");
+            trace_event(TRACE_WIFI_CONNECTING, 0, 0);
             state = STATE_CONNECTING;
             esp_wifi_connect();
         }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED
             && connected) {
+        xEventGroupClearBits(s_wifi_event_group, WIFI_UP_BIT);
+        trace_event(TRACE_WIFI_DISCONNECTED, s_retry_num,
+                ((wifi_event_sta_disconnected_t *)event_data)->reason);
         if (s_retry_num < WIFI_CONN_MAXIMUM_RETRY) {
             esp_wifi_connect();
             s_retry_num++;
@@ -63,16 +71,24 @@ static void event_handler(void* arg, esp_event_base_t event_base,
         ESP_LOGI(TAG,"failed to connect");
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
         ESP_LOGI(TAG, "connected, fetching ip");
+        trace_event(TRACE_WIFI_CONNECTED, 0, 0);
         connected = true;
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "got ip: " IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
+        artpoll_set_ip(event->ip_info.ip.addr);
+        trace_event(TRACE_WIFI_GOT_IP, 0, event->ip_info.ip.addr);
         state = STATE_IDLE;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_UP_BIT);
     }
 }
 
+void wifi_wait_connected(void)
+{
+    xEventGroupWaitBits(s_wifi_event_group, WIFI_UP_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
 void wifi_restart(void);
 
 
@@ -2,4 +2,8 @@
 
 void wifi_task_start(void);
 
+// Blocks until the station has an IP address, returns at once while it has
+// one. Only after wifi_task_start.
+void wifi_wait_connected(void);
+
 void wifi_restart(void);